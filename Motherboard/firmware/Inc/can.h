@@ -30,7 +30,7 @@
 
 void can_init(void);
 
-void can_send_electric(uint32_t voltage, int32_t current);
+void can_send_electric(uint32_t voltage, int32_t current, uint16_t faults);
 void can_send_motion(uint32_t tot_pulses);
 void can_send_temp(int32_t moto_t, int32_t drv_t, int32_t batt_t);
 
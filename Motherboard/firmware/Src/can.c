@@ -70,7 +70,7 @@ void can_init(void)
     can_header.TransmitGlobalTime = DISABLE;
 }
 
-void can_send_electric(uint32_t voltage, int32_t current)
+void can_send_electric(uint32_t voltage, int32_t current, uint16_t faults)
 {
     uint8_t data[8];
     
@@ -81,7 +81,7 @@ void can_send_electric(uint32_t voltage, int32_t current)
     el->timestamp = HAL_GetTick() % MAX_TIMESTAMP;
     el->voltage = voltage;
     el->current = convert_to_14bit(current);
-    el->faults = 0;
+    el->faults = faults & BCP_FAULT_MASK;
     el->seq_id = electric_seq_id++;
 
     _send_can(data);
@@ -33,6 +33,7 @@
 #include <lrr_math.h>
 #include <lrr_utils.h>
 #include <lrr_kty8x.h>
+#include <bike_can_protocol.h>
 
 #include <string.h>
 
@@ -180,6 +181,34 @@ void int_conv_dma(DMA_HandleTypeDef *hdma)
     }
 }
 
+// what the UI gets in every electric message
+static uint16_t _faults(void)
+{
+    uint16_t faults = 0;
+
+    if (calibration.test & AMP_SENS_TEST_FAILED) {
+        faults |= BCP_FAULT_AMP_SENS;
+    }
+
+    // only one of the motor sensors is fitted
+    if ((calibration.test & MOTO_KTY83_FAILED)
+        && (calibration.test & MOTO_NTC_FAILED)) {
+        faults |= BCP_FAULT_MOTO_T_SENS;
+    } else if (calibration.state == CAL_STATUS_FINE
+        && last_convertion.moto_t == BAD_TEMP) {
+        faults |= BCP_FAULT_MOTO_T_SENS;
+    }
+
+    if (calibration.test & BATT_T_SENS_FAILED) {
+        faults |= BCP_FAULT_BATT_T_SENS;
+    }
+    if (calibration.test & DRV_T_SENS_FAILED) {
+        faults |= BCP_FAULT_DRV_T_SENS;
+    }
+
+    return faults;
+}
+
 static void _read_all_adc(void)
 {
     uint16_t rawValues[6];
@@ -198,6 +227,18 @@ static void _read_all_adc(void)
     last_convertion.drv_t = _conv_temp_KTY81(rawValues[2]);
     last_convertion.voltage = _conv_voltage(rawValues[3]);
 
+    // these come and go with the connector
+    if (last_convertion.batt_t == BAD_TEMP) {
+        calibration.test |= BATT_T_SENS_FAILED;
+    } else {
+        calibration.test &= ~BATT_T_SENS_FAILED;
+    }
+    if (last_convertion.drv_t == BAD_TEMP) {
+        calibration.test |= DRV_T_SENS_FAILED;
+    } else {
+        calibration.test &= ~DRV_T_SENS_FAILED;
+    }
+
     if (calibration.state == CAL_STATUS_FINE) {
         // check which sensor is available
         if (!(calibration.test & MOTO_KTY83_FAILED)) {
@@ -247,7 +288,8 @@ void logic_update(void)
     if (__timer_update(&tim50ms, now_ms)) {
         // measure electric units
         _read_all_adc();
-        can_send_electric(last_convertion.voltage, last_convertion.current);
+        can_send_electric(last_convertion.voltage, last_convertion.current,
+            _faults());
     }
 
     if (__timer_update(&tim05s, now_ms)) {
@@ -178,4 +178,32 @@ BOOST_AUTO_TEST_CASE(logic_moto_temp_cal, * utf::tolerance(0.01))
 
     auto moto_temp = convert_from_9bit(blk.moto_t);
     BOOST_TEST(moto_temp == 25);
+}
+
+BOOST_AUTO_TEST_CASE(logic_faults_test)
+{
+    HAL_Tick = 0;
+    hdma_adc1.State = 0;
+    logic_init();
+    
+    FillAdcWithDefaultVals();
+    // battery temperature sensor disconnected
+    adcRawValues[1] = 0;
+
+    for (int i = 0; i < 3; ++i) {
+        auto job = std::async(std::launch::async, []() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(CONV_KICK_OFF_DELAY));
+            hdma_adc1.State = HAL_DMA_STATE_READY;
+            int_conv_dma(&hdma_adc1);
+        });
+        logic_update();
+        job.get();
+
+        HAL_Tick += 500;
+    }
+
+    bcp_msg_electric el;
+    BOOST_REQUIRE(GetLatestEl(el));
+    // the motor has its NTC, only the battery sensor is missing
+    BOOST_TEST((unsigned)el.faults == BCP_FAULT_BATT_T_SENS);
 }
\ No newline at end of file
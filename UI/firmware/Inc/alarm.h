@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#ifndef __ALARM_H__
+#define __ALARM_H__
+
+#include "state.h"
+#include "ui.h"
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    Temperature alarms, evaluated at every sensor frame.
+
+    Every sensor is a row of the table in alarm.c: the vehicle_gauges
+    member it reads, the vehicle_conf member holding its limit (0 turns
+    the row off), the hysteresis, how far ahead the slope is projected
+    and the fault bit it is logged under.
+
+    The reading goes through a first order filter, the slope is the
+    filtered change of it per second, filtered again. A row is
+        ALARM_HOT   from the limit on, until hyst_c below it,
+        ALARM_WARN  while the reading projected horizon_s ahead on the
+                    slope reaches the limit, until hyst_c below it,
+        ALARM_OK    otherwise.
+    Readings below ALARM_MIN_C are failed sensors, see the fault log,
+    and leave the row as it is.
+*/
+
+#define ALARM_ROWS      3
+#define ALARM_MIN_C     -60
+// time constant of the filters
+#define ALARM_TAU_MS    8000
+// fault bits of the rows, above the motherboard ones
+#define ALARM_FAULT_BIT 12
+
+enum alarm_level
+{
+    ALARM_OK,
+    ALARM_WARN,
+    ALARM_HOT,
+};
+
+struct alarm_row
+{
+    uint8_t level;
+    uint8_t primed;
+    // filtered reading in 0.001 C and its slope in 0.001 C/s
+    int32_t temp_mc;
+    int32_t slope_mcs;
+    uint32_t prev_ms;
+};
+
+struct alarm
+{
+    struct alarm_row rows[ALARM_ROWS];
+};
+
+void alarm_init(struct alarm* al);
+// at every sensor frame; returns the rows whose level went up, a bit each
+uint8_t alarm_update(struct alarm* al, const struct vehicle_gauges* vg,
+    const struct vehicle_conf* vc, uint32_t now_ms);
+// the row of the highest level, the first one of equals; -1 if all ok
+int8_t alarm_worst(const struct alarm* al);
+// ALARM_HOT rows as fault bits, for faultlog_update()
+uint16_t alarm_faults(const struct alarm* al);
+uint16_t alarm_fault_mask(void);
+
+// for the display: the reading, the limit and the slope in C/min
+int16_t alarm_temp(const struct vehicle_gauges* vg, uint8_t row);
+uint8_t alarm_limit(const struct vehicle_conf* vc, uint8_t row);
+int16_t alarm_slope_cmin(const struct alarm* al, uint8_t row);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __ALARM_H__
\ No newline at end of file
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+#include "main.h"
+#include <stdint.h>
+
+#ifdef DWT
+// Cortex-M3 cycle counter
+static inline void bench_init(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+static inline uint32_t bench_cycles(void)
+{
+    return DWT->CYCCNT;
+}
+
+static inline uint32_t bench_us_to_cycles(uint32_t us)
+{
+    return us * (SystemCoreClock / 1000000);
+}
+
+static inline uint32_t bench_cycles_to_us(uint32_t cycles)
+{
+    return cycles / (SystemCoreClock / 1000000);
+}
+#else
+// no cycle counter (host build), every read advances a virtual 1us clock
+// so that the wait loops terminate
+static inline void bench_init(void)
+{
+}
+
+static inline uint32_t bench_cycles(void)
+{
+    static uint32_t virtual_cycles = 0;
+    return ++virtual_cycles;
+}
+
+static inline uint32_t bench_us_to_cycles(uint32_t us)
+{
+    return us;
+}
+
+static inline uint32_t bench_cycles_to_us(uint32_t cycles)
+{
+    return cycles;
+}
+#endif
+
+static inline void bench_delay_us(uint32_t us)
+{
+    uint32_t start = bench_cycles();
+    uint32_t cycles = bench_us_to_cycles(us);
+    while (bench_cycles() - start < cycles);
+}
+
+#endif // __BENCH_H__
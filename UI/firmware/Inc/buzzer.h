@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#ifndef __BUZZER_H__
+#define __BUZZER_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    Buzzer patterns played from the 20 ms tick, the main loop never
+    waits for a beep. A pattern is a table of on/off durations in ticks;
+    a higher pattern replaces a lower one, a lower one does not start
+    while a higher one plays.
+*/
+
+#define BUZZER_TICK_MS      20
+
+// in the order of priority
+enum buzzer_pattern
+{
+    BUZ_NONE,
+    // the parked reminder, one long beep
+    BUZ_REMINDER,
+    // a limit is near, two short beeps
+    BUZ_WARN,
+    // a limit is crossed, repeated until stopped
+    BUZ_ALARM,
+    BUZ_LIMIT,
+};
+
+void buzzer_init(void);
+void buzzer_play(enum buzzer_pattern p);
+// stops `p` if it plays
+void buzzer_stop(enum buzzer_pattern p);
+// every BUZZER_TICK_MS
+void buzzer_tick(void);
+enum buzzer_pattern buzzer_playing(void);
+// 1 while a pattern sounds
+uint8_t buzzer_on(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __BUZZER_H__
\ No newline at end of file
@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#ifndef __CHARGE_H__
+#define __CHARGE_H__
+
+#include "state.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    Charging sessions.
+
+    A stationary bike cannot regenerate, so current flowing into the pack
+    at speed 0 is the charger's. After CHARGE_START_MS of it a session
+    starts; it ends after CHARGE_END_MS without it, or when the bike
+    moves. The frames of the charger are reported to the caller, which
+    keeps their energy out of the regeneration totals; they are
+    integrated here instead (V * I, and I alone for the throughput).
+    The pending frames are claimed as well; if they turn out not to be
+    the charger's their energy is handed back for the regeneration.
+
+    With the current sensor on the motor side the charger is invisible
+    to it. Then the voltage trend tells: CHARGE_TREND_RISES windows of
+    CHARGE_TREND_S in a row, each rising by CHARGE_RISE_DV at least at
+    standstill and no current, start a session, a window that does not
+    rise ends it. The pack relaxing after a ride rises too, but fast
+    first and then less and less, it does not keep up for that long.
+    Such a session has no energy, only the voltages and the duration.
+
+    The time to full follows the charge left to the smoothed charger
+    current, or the voltage left to the last rise. Both are O(1) once a
+    second.
+
+    A closed session is numbered on from the last one, adds to its
+    totals and sets `closed` until the caller has stored it.
+*/
+
+// charger current, 0.1 A
+#define CHARGE_MIN_DA       5
+#define CHARGE_START_MS     10000
+#define CHARGE_END_MS       30000
+#define CHARGE_TREND_S      300
+#define CHARGE_RISE_DV      1
+#define CHARGE_TREND_RISES  3
+#define CHARGE_AVG_TAU_MS   30000
+
+enum charge_state
+{
+    CHARGE_IDLE,
+    // charger current, not long enough yet
+    CHARGE_PENDING,
+    CHARGE_ON,
+};
+
+struct charge
+{
+    uint8_t state;
+    // the session was seen on the current sensor
+    uint8_t by_current;
+    // pending or on for
+    uint32_t state_ms;
+    uint32_t quiet_ms;
+    // 0.01 mWs and 0.1 mAs
+    uint64_t e_in;
+    uint64_t q_in;
+    // charger current, Q16 0.1 A
+    int32_t avg_da;
+    uint16_t start_dv;
+
+    // the last frame
+    uint16_t dv;
+    uint8_t moving;
+    uint8_t quiet;
+
+    // the voltage at the start of the trend window
+    uint16_t trend_dv;
+    uint16_t trend_s;
+    uint8_t rises;
+    uint16_t rise_start_dv;
+    // the rise of the last window
+    uint16_t rise_dv;
+
+    // the newest session, `closed` while it is not stored
+    struct charge_session last;
+    uint8_t closed;
+    // claimed by pending starts which were none
+    uint64_t returned_mWs;
+};
+
+void charge_init(struct charge* c, const struct charge_session* last);
+
+// every electric frame, 1 when it is the charger's
+uint8_t charge_sample(struct charge* c, uint16_t speed_dkmh,
+    uint16_t batt_dv, int16_t amper_da, uint32_t dt_ms);
+// once a second
+void charge_tick(struct charge* c);
+// the energy of claimed frames which were not the charger's after all,
+// taken once
+uint64_t charge_take_returned_mWs(struct charge* c);
+
+// of the running session, 0.1 Wh
+uint32_t charge_dWh(const struct charge* c);
+// 0.1 A, 0 when not seen
+uint16_t charge_current_da(const struct charge* c);
+// 0 when unknown or not charging
+uint16_t charge_minutes_to_full(const struct charge* c,
+    uint32_t remaining_mah, uint16_t full_dv);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __CHARGE_H__
\ No newline at end of file
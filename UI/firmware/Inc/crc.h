@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#ifndef __CRC_H__
+#define __CRC_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// CRC-16/CCITT-FALSE: poly 0x1021, no reflection
+#define CRC16_INIT  0xffff
+
+// continues `crc` over `len` bytes, start with CRC16_INIT
+uint16_t crc16(uint16_t crc, const uint8_t* d, uint16_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __CRC_H__
\ No newline at end of file
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#ifndef __DISTANCE_H__
+#define __DISTANCE_H__
+
+#include "state.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    Odometer and trip counters fed with pulse deltas.
+
+    Each counter keeps whole millimetres in 64 bits plus the remainder of
+    the pulses -> mm division, so the sum of the increments is exactly
+    pulses * dist_p_rev_mm / pulse_p_rev with no drift and no overflow.
+    All counters advance in one pass with a single division per update.
+*/
+
+#define DIST_TOTAL          0
+#define DIST_TRIP1          1
+#define DIST_TRIP2          2
+#define DIST_COUNTERS       3
+
+struct dist_counter
+{
+    uint64_t mm;
+    // in 1/pulse_p_rev mm
+    uint32_t rem;
+};
+
+struct distance
+{
+    uint16_t mm_p_rev;
+    uint16_t ppr;
+    struct dist_counter c[DIST_COUNTERS];
+};
+
+void distance_init(struct distance* d, const struct vehicle_conf* vc);
+
+// sets a counter to the distance of `pulses`
+void distance_set(struct distance* d, uint8_t counter, uint32_t pulses);
+
+void distance_add(struct distance* d, uint32_t delta_pulses);
+
+uint64_t distance_mm(const struct distance* d, uint8_t counter);
+uint32_t distance_m(const struct distance* d, uint8_t counter);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __DISTANCE_H__
\ No newline at end of file
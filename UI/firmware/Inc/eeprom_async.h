@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#ifndef __EEPROM_ASYNC_H__
+#define __EEPROM_ASYNC_H__
+
+#include "stm32f1xx_hal.h"
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    Non-blocking access to the 24LC256.
+
+    Requests are queued and executed by eeprom_async_poll() from the main
+    loop; the bus transfers themselves run on the I2C interrupt. Writes
+    are split on the 64 byte write pages of the device. After every page
+    the device is busy with its write cycle (up to 5 ms) and does not ACK
+    its address; the engine probes it once per poll and starts the next
+    transfer as soon as it ACKs, instead of waiting the datasheet maximum.
+
+    The callback runs from eeprom_async_poll(), never from the interrupt.
+    Buffers must stay untouched until the callback. The blocking l_rr
+    driver must not be used while requests are pending, it shares the bus.
+*/
+
+#define EEPROM_ASYNC_QUEUE      8
+#define EEPROM_ASYNC_PAGE       64
+// twice the datasheet write cycle, the device is gone after that
+#define EEPROM_ASYNC_CYCLE_MS   10
+
+// err == 0 on success
+typedef void (*eeprom_async_cb)(void* ctx, int err);
+
+void eeprom_async_init(void);
+
+// 0 == queued, 1 == queue full
+int eeprom_async_write(uint16_t addr, const uint8_t* d, uint16_t s,
+    eeprom_async_cb cb, void* ctx);
+int eeprom_async_read(uint16_t addr, uint8_t* d, uint16_t s,
+    eeprom_async_cb cb, void* ctx);
+
+void eeprom_async_poll(void);
+// stops starting transfers, for a write that bypasses the queue;
+// eeprom_async_init() fails what is left through the callbacks and resumes
+void eeprom_async_halt(void);
+uint8_t eeprom_async_idle(void);
+
+// called by the port from the transfer complete/error interrupts
+void eeprom_async_xfer_done(uint8_t ok);
+
+// the bus, eeprom_port.c on the target and a fake in the tests;
+// the transfers complete with eeprom_async_xfer_done()
+HAL_StatusTypeDef eeprom_port_write(uint16_t addr, const uint8_t* d,
+    uint16_t s);
+HAL_StatusTypeDef eeprom_port_read(uint16_t addr, uint8_t* d, uint16_t s);
+// 1 when the device ACKs its address, i.e. no write cycle in progress
+uint8_t eeprom_port_ready(void);
+// blocking, usable from an interrupt: cuts a transfer in progress short,
+// waits out the write cycle and writes one page
+HAL_StatusTypeDef eeprom_port_write_now(uint16_t addr, const uint8_t* d,
+    uint16_t s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __EEPROM_ASYNC_H__
\ No newline at end of file
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#ifndef __ENERGY_H__
+#define __ENERGY_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    Battery energy integrated from consecutive (V, I, dt) samples.
+
+    Power is integrated with the trapezoidal rule between two samples,
+    an interval where the current changes direction is split at the
+    interpolated zero crossing so consumed and recovered energy stay
+    apart. Totals are 64-bit milliwatt-seconds with the sub-mWs part
+    carried, so nothing is lost however long the ride.
+
+    Samples further apart than ENERGY_MAX_GAP_MS are not connected, the
+    gap is only accounted in gap_ms.
+*/
+
+#define ENERGY_MAX_GAP_MS   1000
+
+// 0.1 Wh
+#define ENERGY_MWS_P_DWH    360000
+
+struct energy_acc
+{
+    uint64_t mWs;
+    // in 1/2000 mWs
+    uint32_t rem;
+};
+
+struct energy
+{
+    struct energy_acc consumed;
+    struct energy_acc recovered;
+    // previous sample in mW
+    int32_t prev_mw;
+    uint8_t has_prev;
+    uint32_t gap_ms;
+};
+
+void energy_init(struct energy* e);
+
+// battery voltage in 0.1 V, current in 0.1 A (< 0 when recovering),
+// dt_ms since the previous sample
+void energy_sample(struct energy* e, uint16_t batt_dv, int16_t amper_da,
+    uint32_t dt_ms);
+
+// drops the previous sample, the next one starts a new segment
+void energy_break(struct energy* e);
+
+uint64_t energy_consumed_mWs(const struct energy* e);
+uint64_t energy_recovered_mWs(const struct energy* e);
+// recovered energy integrated elsewhere
+void energy_add_recovered(struct energy* e, uint64_t mWs);
+
+// rounded to 0.1 Wh
+uint32_t energy_to_dWh(uint64_t mWs);
+// net energy over a distance in 0.1 Wh/km, 0 when recovering
+uint16_t energy_dWh_km(int64_t mWs, uint32_t m);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __ENERGY_H__
\ No newline at end of file
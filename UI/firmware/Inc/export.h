@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#ifndef __EXPORT_H__
+#define __EXPORT_H__
+
+#include "stm32f1xx_hal.h"
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    Bulk data out of the USART1, one frame at a time so that the main
+    loop keeps running while a frame is on the wire:
+
+        0xa5 0x5a | type (u8) | idx (u16 LE) | len (u8) | payload
+        | crc16 (LE, over type..payload)
+
+    A dump is a run of frames of one type with idx counting up, closed
+    by a frame of len 0 whose idx is the number of data frames. The host
+    drops frames failing the CRC and asks again.
+
+    A single byte received on the USART1 is a command, see logic.c.
+*/
+
+#define EXPORT_SYNC_1       0xa5
+#define EXPORT_SYNC_2       0x5a
+#define EXPORT_HEADER       6
+#define EXPORT_MAX_PAYLOAD  64
+#define EXPORT_MAX_FRAME    (EXPORT_HEADER + EXPORT_MAX_PAYLOAD + 2)
+
+// frame types
+#define EXPORT_RIDE_LOG     'L'
+#define EXPORT_TRIPS        'T'
+#define EXPORT_PROFILE      'P'
+
+// 0 == the frame is going out, 1 == the previous one still is
+int export_frame(uint8_t type, uint16_t idx, const uint8_t* d, uint8_t len);
+uint8_t export_busy(void);
+
+// the USART1, export_port.c on the target and a fake in the tests;
+// the data must stay untouched while export_port_busy()
+HAL_StatusTypeDef export_port_send(const uint8_t* d, uint16_t s);
+uint8_t export_port_busy(void);
+// 1 when a command byte was received
+uint8_t export_port_getc(uint8_t* c);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __EXPORT_H__
\ No newline at end of file
@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#ifndef __FAULTLOG_H__
+#define __FAULTLOG_H__
+
+#include "eeprom_async.h"
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    Fault and alarm events in the EEPROM_FAULTS page.
+
+    The fault word has a bit per fault: bits 0-10 are the motherboard's
+    BCP_FAULT_* bits of every electric message, the upper ones are
+    raised by the UI itself. A bit has to hold its new level over
+    FAULTLOG_DEBOUNCE updates before it counts, a flickering bit is not
+    logged at all. Every debounced change is an event, an onset or a
+    clear, stamped with the odometer and the seconds since the boot:
+
+        seq (u32 LE) | bit (u8) | onset (u8) | count (u16 LE)
+        | odo_hm (u32 LE) | uptime_s (u16 LE) | crc16 (LE)
+
+    The page is a ring of 64 such records, record `seq` in slot
+    seq % 64; count is the lifetime number of onsets of the bit, so the
+    counts survive as long as the bit has a record left in the ring.
+
+    Events wait in RAM and go out together, FAULTLOG_BATCH records in a
+    page write, or after FAULTLOG_HOLD_MS, or at a ride stop.
+
+    At the boot the ring is read through the EEPROM queue, a page per
+    request, and gives back the counts, the last onsets and the faults
+    active at the power-off: these are not logged again if they are
+    still there.
+*/
+
+#define FAULT_BITS          16
+// UI side faults
+#define FAULT_OFFLINE       11
+#define FAULT_MB_MASK       0x07ff
+
+#define FAULTLOG_RECORD     16
+#define FAULTLOG_SLOTS      64
+#define FAULTLOG_DEBOUNCE   3
+#define FAULTLOG_BATCH      4
+#define FAULTLOG_PENDING    8
+#define FAULTLOG_HOLD_MS    10000
+
+struct faultlog_stat
+{
+    // onsets over the lifetime
+    uint16_t count;
+    // odometer at the last onset, 0 == never
+    uint32_t last_hm;
+};
+
+struct faultlog
+{
+    uint16_t base;
+    // seq of the next record
+    uint32_t next_seq;
+    uint8_t opened;
+
+    // debounced fault word, updates against it so far
+    uint16_t active;
+    uint8_t deb[FAULT_BITS];
+    struct faultlog_stat stat[FAULT_BITS];
+
+    // records not yet written, since pending_ms
+    uint8_t pending[FAULTLOG_PENDING][FAULTLOG_RECORD];
+    uint8_t npending;
+    uint8_t holding;
+    uint32_t pending_ms;
+    uint8_t flush;
+    // what the queue is writing
+    uint8_t wbuf[FAULTLOG_BATCH * FAULTLOG_RECORD];
+    uint8_t writing;
+
+    // the boot scan, a write page at a time
+    uint8_t scan_page;
+    uint8_t scanning;
+    uint8_t scan_buf[EEPROM_ASYNC_PAGE];
+    // seq + 1 of the newest record of every bit
+    uint32_t newest[FAULT_BITS];
+
+    uint16_t events;
+    uint16_t writes;
+    uint16_t lost;
+};
+
+void faultlog_init(struct faultlog* fl, uint16_t base);
+// queues the boot scan, updates are ignored until it is done
+int faultlog_open(struct faultlog* fl);
+
+// `bits` of the source owning `mask`, at every report of it
+void faultlog_update(struct faultlog* fl, uint16_t bits, uint16_t mask,
+    uint32_t odo_hm, uint32_t uptime_s);
+// from the main loop, starts the batched writes
+void faultlog_poll(struct faultlog* fl, uint32_t now_ms);
+// writes the pending events at the next poll
+void faultlog_flush(struct faultlog* fl);
+
+static inline uint8_t faultlog_active(const struct faultlog* fl, uint8_t bit)
+{
+    return (fl->active >> bit) & 1;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __FAULTLOG_H__
\ No newline at end of file
@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#ifndef __FMT_H__
+#define __FMT_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    Integer only formatting straight into the LCD line buffer,
+    no printf involved.
+
+    Fixed point values are passed as integers scaled by 10^dp,
+    e.g. 84.1V with dp = 1 is 841. Rounding is half to even so the output
+    matches what "%.1f" used to print.
+*/
+
+// left aligned writers, return number of characters written
+uint8_t fmt_uint(char* dst, uint32_t v);
+uint8_t fmt_int(char* dst, int32_t v);
+uint8_t fmt_str(char* dst, const char* s);
+// v / 10^dp with exactly prec decimal places
+uint8_t fmt_fixed(char* dst, uint32_t v, uint8_t dp, uint8_t prec);
+
+// right aligned writers, the last character goes to line[last]
+void fmt_uint_r(char* line, int last, uint32_t v);
+void fmt_fixed_r(char* line, int last, uint32_t v, uint8_t dp, uint8_t prec);
+
+// gauge with unit, at most 4 characters + unit, the unit goes to
+// line[unit_col]:
+//   "0", "8.4", "84.0", "840", "8.4k", "67k"
+void fmt_unit(char* line, int unit_col, uint32_t v, uint8_t dp, char unit);
+void fmt_unit_int(char* line, int unit_col, uint32_t v, char unit);
+
+uint32_t fmt_div_round(uint32_t n, uint32_t d);
+// drops digits of v / 10^dp beyond prec decimal places
+uint32_t fmt_trunc(uint32_t v, uint8_t dp, uint8_t prec);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __FMT_H__
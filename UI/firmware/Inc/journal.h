@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#ifndef __JOURNAL_H__
+#define __JOURNAL_H__
+
+#include "eeprom_async.h"
+#include "stm32f1xx_hal.h"
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    Log-structured store of one small struct (the image) on the EEPROM.
+
+    The area is a ring of JOURNAL_SLOT byte slots; every save appends a
+    record to the next slot instead of rewriting a fixed address, so the
+    wear is spread over the whole ring. A record is
+
+        seq (u32 LE) | type (u8) | len (u8) | payload | crc16 (LE)
+
+    and record `seq` always lives in slot seq % slots. The sequence
+    numbers along the ring are therefore ascending up to the newest
+    record and drop after it, which lets the boot find the newest valid
+    record by a binary search over O(log slots) headers. A torn write
+    only ever hits the slot being appended, fails its CRC and the
+    previous record is used instead. The search steps over single slot
+    gaps, which a record sealed past a pending append can leave.
+
+    FULL records carry the whole image, DELTA records only the changed
+    byte runs as (offset u8, len u8, bytes). A FULL record is written at
+    least every JOURNAL_FULL_EVERY saves, so the image is rebuilt from the
+    latest FULL record plus the deltas after it, all still in the ring.
+
+    Slot writes are derived from the sequence numbers, so the per-slot
+    wear survives reboots without being stored anywhere.
+*/
+
+#define JOURNAL_SLOT        64
+// write page of the 24LC256, a write must not cross it; a record fits
+// one when the slot does
+#define JOURNAL_HW_PAGE     64
+#define JOURNAL_HEADER      6
+#define JOURNAL_MAX_PAYLOAD (JOURNAL_SLOT - JOURNAL_HEADER - 2)
+#define JOURNAL_MAX_IMAGE   JOURNAL_MAX_PAYLOAD
+#define JOURNAL_FULL_EVERY  16
+// unchanged bytes a delta run rather spans than starts a new run
+#define JOURNAL_RUN_GAP     2
+
+#define JOURNAL_FULL        1
+#define JOURNAL_DELTA       2
+
+typedef HAL_StatusTypeDef (*journal_read_fn)(uint16_t addr, uint8_t* d,
+    uint16_t s);
+typedef HAL_StatusTypeDef (*journal_write_fn)(uint16_t addr,
+    const uint8_t* d, uint16_t s);
+
+struct journal
+{
+    uint16_t base;
+    uint8_t slots;
+    uint8_t image_size;
+    journal_read_fn read;
+    journal_write_fn write;
+    // seq of the next record, 0 == empty ring
+    uint32_t next_seq;
+    // records since the last FULL one
+    uint8_t since_full;
+    // what the ring holds, the base of the next delta
+    uint8_t image[JOURNAL_MAX_IMAGE];
+    uint8_t has_image;
+    // an asynchronous append in progress
+    uint8_t pending;
+    uint8_t rec[JOURNAL_SLOT];
+    uint8_t pending_image[JOURNAL_MAX_IMAGE];
+    eeprom_async_cb cb;
+    void* cb_ctx;
+    // since journal_open()
+    uint16_t full_writes;
+    uint16_t delta_writes;
+    uint32_t bytes_written;
+};
+
+// slots must be > JOURNAL_FULL_EVERY, image_size <= JOURNAL_MAX_IMAGE
+void journal_init(struct journal* j, uint16_t base, uint8_t slots,
+    uint8_t image_size, journal_read_fn read, journal_write_fn write);
+
+// locates the newest record and rebuilds the image from the ring,
+// returns 0 when `image` was filled, 1 for an empty or corrupted ring,
+// 2 when a read failed (nothing can be told about the ring then)
+int journal_open(struct journal* j, void* image);
+
+// appends the image if it differs from the stored one, 0 == success
+int journal_append(struct journal* j, const void* image);
+// the same through the EEPROM queue, `image` is copied; 1 when the
+// previous append is still pending or the queue is full
+int journal_append_async(struct journal* j, const void* image,
+    eeprom_async_cb cb, void* ctx);
+
+// a FULL record of `image` for the slot after any pending append, for
+// writing it out from an interrupt (brown-out) with the queue bypassed;
+// the journal itself is only read, journal_open() catches up later
+uint8_t journal_seal(const struct journal* j, const void* image,
+    uint8_t* rec, uint16_t* addr);
+
+// record writes the slot has seen over the ring lifetime
+uint32_t journal_slot_writes(const struct journal* j, uint8_t slot);
+uint32_t journal_max_slot_writes(const struct journal* j);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __JOURNAL_H__
\ No newline at end of file
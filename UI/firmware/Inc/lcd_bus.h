@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#ifndef __LCD_BUS_H__
+#define __LCD_BUS_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    Raw HD44780 access working next to lrr_hd44780 (4 bit bus, pins from
+    lrr_hd44780.def).
+
+    Instead of waiting the datasheet worst case after every command the
+    busy flag is polled: D4-D7 are switched to inputs, RW is raised and
+    D7 is read until the controller reports ready. If the flag does not
+    clear within the worst case time the command is considered done anyway,
+    after LCD_BUS_MAX_TIMEOUTS consecutive timeouts busy flag polling is
+    switched off and fixed delays are used from then on (e.g. RW tied low).
+
+    D4-D7 are pulled up while read, so an undriven bus reads busy and
+    times out rather than ready. With RW tied low the controller takes
+    every read as a write: E is pulsed twice per read with RS low, i.e. a
+    0xff command (DDRAM address 0x7f) until the fallback kicks in. What
+    went out meanwhile is lost, the UI redraws everything once the flag
+    is off.
+
+    NOTE: D4-D7 are read directly, so the display must run from 3.3V
+    (PA3-PA6 are not 5V tolerant), see LCD_USE_BUSY_FLAG.
+*/
+
+#define LCD_CMD_CLEAR           0x01
+#define LCD_CMD_HOME            0x02
+#define LCD_CMD_CGRAM_ADDR      0x40
+#define LCD_CMD_DDRAM_ADDR      0x80
+// DDRAM address of the second row
+#define LCD_ROW1_ADDR           0x40
+
+// datasheet execution times
+#define LCD_CLEAR_HOME_US       1520
+#define LCD_CMD_US              37
+#define LCD_DATA_US             41
+
+#define LCD_BUS_MAX_TIMEOUTS    8
+
+// uncomment to log actual vs assumed command latency every 30s
+// #define LCD_BUS_MEASURE
+
+struct lcd_bus_stats
+{
+    uint32_t commands;
+    uint32_t timeouts;
+    // summed up busy times
+    uint32_t actual_us;
+    uint32_t assumed_us;
+    uint16_t max_actual_us;
+};
+
+void lcd_bus_init(void);
+
+void lcd_bus_use_busy_flag(uint8_t enable);
+uint8_t lcd_bus_busy_flag_used(void);
+
+void lcd_bus_cmd(uint8_t cmd);
+void lcd_bus_data(uint8_t data);
+
+// waits until the controller is ready, returns 0 if the busy flag
+// has not been observed clear (fixed delay has been applied then)
+uint8_t lcd_bus_wait_ready(uint16_t assumed_us);
+
+const struct lcd_bus_stats* lcd_bus_get_stats(void);
+void lcd_bus_reset_stats(void);
+void lcd_bus_log_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __LCD_BUS_H__
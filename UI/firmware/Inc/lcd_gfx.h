@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#ifndef __LCD_GFX_H__
+#define __LCD_GFX_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    Simple graphics on top of the 8 user definable HD44780 glyphs (CGRAM).
+
+    Glyphs are allocated per frame: gfx_begin_frame() releases all slots,
+    gfx_glyph() returns a character code for a bitmap. A slot which already
+    holds the same bitmap is reused as is, otherwise a free slot is
+    rewritten. CGRAM writes are as slow as DDRAM writes so only bitmaps
+    which changed since the last frame are uploaded.
+
+    Slots released in a frame may be overwritten, so every cell showing
+    a glyph has to be redrawn in each frame.
+*/
+
+#define GFX_GLYPHS          8
+#define GFX_GLYPH_ROWS      8
+#define GFX_GLYPH_COLS      5
+
+// built-in characters of the A00 ROM
+#define GFX_FULL_BLOCK      ((char)0xFF)
+#define GFX_EMPTY           ' '
+// returned when all glyph slots are taken in the current frame
+#define GFX_NO_GLYPH        '#'
+
+#define GFX_SPARK_LEN       16
+
+struct gfx_spark
+{
+    uint16_t samples[GFX_SPARK_LEN];
+    uint8_t head;
+    uint8_t count;
+};
+
+void gfx_init(void);
+
+void gfx_begin_frame(void);
+
+char gfx_glyph(const uint8_t bitmap[GFX_GLYPH_ROWS]);
+
+// horizontal bar with 1/5 character resolution
+void gfx_bar(char* dst, uint8_t width, uint32_t value, uint32_t full_scale);
+
+void gfx_spark_push(struct gfx_spark* s, uint16_t v);
+// the newest sample is drawn in the rightmost column, autoscaled
+void gfx_spark(char* dst, uint8_t width, const struct gfx_spark* s);
+
+uint32_t gfx_glyph_uploads(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __LCD_GFX_H__
@@ -33,9 +33,20 @@
 extern "C" {
 #endif
 
+// a stop saves the runtime if the last save is older than this
+#define STOP_SAVE_PERIOD_MS (10 * 60 * 1000)
+// and always once parked that long
+#define PARKED_SAVE_S       60
+// a motion frame never counts more than this speed (150 km/h) since the last
+#define MOTION_MAX_MM_S     41667
+
 void logic_init(void);
 void logic_update(void);
 
+// HAL tick of the first frame with gauges after the reset,
+// UINT32_MAX until it is drawn
+uint32_t logic_first_gauge_ms(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#ifndef __PERSIST_H__
+#define __PERSIST_H__
+
+#include "state.h"
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    On-EEPROM format of the persisted state.
+
+    Every type is written field by field, little-endian and without
+    padding, so the stored bytes no longer depend on the struct layout
+    the compiler picked. An image starts with its format version; the
+    ones stored at a fixed address end with a CRC-16 (the runtime lives
+    in the journal, which has its own). All of them fit one 64 byte
+    EEPROM page, i.e. a single write cycle.
+
+    Decoding goes from the read buffer straight into the struct. Every
+    format version ever written keeps its decoder: a newer version may
+    only append fields, which older images leave at their init_*()
+    defaults. Images of the firmwares before the versioning were the raw
+    structs as laid out by arm-none-eabi-gcc (vehicle_conf and
+    vehicle_runtime only); they are recognised by their size or a first
+    byte no version uses and decoded from those offsets. An image of a
+    known version failing its CRC is rejected, never taken for a raw one.
+
+    eeprom_constants keeps its layout: a u32 magic followed by chars was
+    never padded and its magic already tells the format.
+*/
+
+#define PERSIST_CONF_VERSION    1
+#define PERSIST_RUNTIME_VERSION 1
+#define PERSIST_RINT_VERSION    1
+#define PERSIST_TRIP_VERSION    1
+#define PERSIST_RAINFLOW_VERSION 1
+#define PERSIST_CHARGE_VERSION  1
+
+#define PERSIST_CONF_SIZE       19
+#define PERSIST_RUNTIME_SIZE    55
+#define PERSIST_RINT_SIZE       36
+#define PERSIST_TRIP_SIZE       33
+// the histogram and the stack of a rainflow, an image each
+#define PERSIST_CYCLES_SIZE     59
+#define PERSIST_REVERSALS_SIZE  60
+#define PERSIST_CHARGE_SIZE     31
+
+// sizes of the raw structs of the earlier firmwares
+#define PERSIST_LEGACY_CONF_SIZE    18
+#define PERSIST_LEGACY_RUNTIME_SIZE 56
+
+// buffers for any format of the type, the largest one
+#define PERSIST_CONF_BUF        PERSIST_CONF_SIZE
+#define PERSIST_RUNTIME_BUF     PERSIST_LEGACY_RUNTIME_SIZE
+#define PERSIST_RINT_BUF        PERSIST_RINT_SIZE
+
+// encoders return the image size
+uint8_t persist_encode_conf(const struct vehicle_conf* vc, uint8_t* b);
+uint8_t persist_encode_runtime(const struct vehicle_runtime* vr, uint8_t* b);
+uint8_t persist_encode_rint(const struct rint_history* rh, uint8_t* b);
+uint8_t persist_encode_trip(const struct trip_summary* ts, uint8_t* b);
+uint8_t persist_encode_cycles(const struct rainflow* rf, uint8_t* b);
+uint8_t persist_encode_reversals(const struct rainflow* rf, uint8_t* b);
+uint8_t persist_encode_charge(const struct charge_session* cs, uint8_t* b);
+
+// 0 == decoded, 1 == no known format in the `len` bytes
+int persist_decode_conf(struct vehicle_conf* vc, const uint8_t* b,
+    uint8_t len);
+int persist_decode_runtime(struct vehicle_runtime* vr, const uint8_t* b,
+    uint8_t len);
+int persist_decode_rint(struct rint_history* rh, const uint8_t* b,
+    uint8_t len);
+int persist_decode_trip(struct trip_summary* ts, const uint8_t* b,
+    uint8_t len);
+int persist_decode_cycles(struct rainflow* rf, const uint8_t* b,
+    uint8_t len);
+int persist_decode_reversals(struct rainflow* rf, const uint8_t* b,
+    uint8_t len);
+int persist_decode_charge(struct charge_session* cs, const uint8_t* b,
+    uint8_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __PERSIST_H__
\ No newline at end of file
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#ifndef __PRESENT_H__
+#define __PRESENT_H__
+
+#include "ui.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    Presentation layer between the raw vehicle_gauges and what is rendered.
+
+    Every UI tick each configured gauge goes through a fixed point filter:
+    - PF_EMA       first order low pass
+    - PF_CRITICAL  two first order stages, critically damped (no overshoot)
+    The time constant is roughly UI_TICK_MS * 2^shift per stage.
+
+    The presented value moves only if the filtered one got at least
+    `threshold` (minus a quarter of a digit) away from it, so the last digit
+    does not flicker. Changes bigger than `snap` skip the filter to keep
+    the latency low on real steps.
+*/
+
+#define PF_NONE             0
+#define PF_EMA              1
+#define PF_CRITICAL         2
+
+struct present_conf
+{
+    uint8_t src;
+    uint8_t src_type;
+    uint8_t kind;
+    uint8_t shift;
+    uint16_t threshold;
+    uint16_t snap;
+};
+
+void present_init(void);
+
+// raw -> presented, gauges without a filter are copied as they are
+void present_update(const struct vehicle_gauges* raw,
+    struct vehicle_gauges* presented);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __PRESENT_H__
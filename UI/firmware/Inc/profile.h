@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#ifndef __PROFILE_H__
+#define __PROFILE_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    Load profile: fixed histograms of how the bike is ridden.
+
+        speed        x  net energy (mWs), distance (mm), time (ms)
+        current      x  time (ms)
+        motor temp   x  battery temp  time (ms)
+
+    Every electric frame adds its energy, distance and duration to the
+    bins it falls in, a single add per table and no search: the bins
+    are equally wide and the last one is open. Parked frames (no speed,
+    no current) are left out. The bins are 64-bit, none of them wraps
+    in the life of the bike.
+
+    The tables live across rides in the EEPROM (state.c) as the
+    profile_encode() image. They are dumped over the USART1 as
+    EXPORT_PROFILE frames, one per table row:
+
+        table (u8) | row (u8) | the row's bins (u64/i64 LE)
+
+    table 0 is the speed, a row per bin with its energy, distance and
+    time; table 1 the current, PROFILE_CURRENT_ROW bins a row; table 2
+    the temperatures, a row per motor band with a bin per battery band.
+*/
+
+// 5 km/h
+#define PROFILE_SPEEDS          10
+#define PROFILE_SPEED_DKMH      50
+// 5 A from -20 A
+#define PROFILE_CURRENTS        16
+#define PROFILE_CURRENT_DA      50
+#define PROFILE_CURRENT_MIN_DA  (-200)
+#define PROFILE_CURRENT_ROW     4
+// 20 C motor, 10 C battery, from 0 C
+#define PROFILE_MOTO_BANDS      6
+#define PROFILE_MOTO_C          20
+#define PROFILE_BATT_BANDS      6
+#define PROFILE_BATT_C          10
+// quieter than that the bike is parked, 0.1 A
+#define PROFILE_IDLE_DA         5
+
+#define PROFILE_SIZE (1 + 8 * (3 * PROFILE_SPEEDS + PROFILE_CURRENTS \
+    + PROFILE_MOTO_BANDS * PROFILE_BATT_BANDS) + 2)
+
+struct profile
+{
+    int64_t speed_mWs[PROFILE_SPEEDS];
+    uint64_t speed_mm[PROFILE_SPEEDS];
+    uint64_t speed_ms[PROFILE_SPEEDS];
+    uint64_t current_ms[PROFILE_CURRENTS];
+    uint64_t temp_ms[PROFILE_MOTO_BANDS][PROFILE_BATT_BANDS];
+    // changed since the last save
+    uint8_t dirty;
+};
+
+void profile_init(struct profile* p);
+
+// every electric frame: the energy drawn since the previous one (< 0
+// when recovered) and its dt_ms
+void profile_sample(struct profile* p, uint16_t speed_dkmh,
+    int16_t amper_da, int16_t moto_c, int16_t batt_c, int32_t mWs,
+    uint32_t dt_ms);
+
+// consumption of a speed bin, 0.1 Wh/km, 0 below 100 m
+int16_t profile_dWh_km(const struct profile* p, uint8_t speed_bin);
+
+// returns the image size
+uint16_t profile_encode(const struct profile* p, uint8_t* b);
+// 0 == decoded
+int profile_decode(struct profile* p, const uint8_t* b, uint16_t len);
+
+// 1 while an export runs
+int profile_export_start(void);
+// from the main loop
+void profile_export_poll(const struct profile* p);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __PROFILE_H__
\ No newline at end of file
@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#ifndef __PVD_H__
+#define __PVD_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    Programmable voltage detector: when VDD falls below 2.9 V the
+    runtime prepared by the logic is committed to the EEPROM in the
+    hold-up time of the supply, see commit_vehicle_runtime(). The
+    EEPROM works down to 2.5 V, the commit is one page: ~6 ms on the
+    100 kHz bus plus the 5 ms write cycle.
+*/
+
+void pvd_init(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __PVD_H__
\ No newline at end of file
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#ifndef __RAINFLOW_H__
+#define __RAINFLOW_H__
+
+#include "state.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    Battery cycles by rainflow counting of the state of charge.
+
+    The signal is reduced to its reversals on the fly: the last point of
+    the stack follows the charge while it keeps its direction, and a
+    move of RAINFLOW_GATE the other way confirms it and starts a new
+    one. Smaller wiggles (regeneration, rounding) are not cycles.
+
+    Each confirmed reversal runs the four point rule on the last four of
+    them: when the inner range is within both outer ones it is a closed
+    cycle, counted into the depth x mean histogram and removed. Every
+    point is pushed and popped at most once, O(1) amortised per sample.
+    What stays on the stack is the residue, ranges still open; it is
+    persisted with the histogram, so the overnight charge closes the
+    cycle of the ride before it.
+
+    The charge range bounds the residue, in practice well below
+    RAINFLOW_STACK. Should it get there, its oldest range is counted as a
+    half cycle and dropped.
+*/
+
+// permille of the charge
+#define RAINFLOW_GATE       10
+
+// once a second or slower, 0 - 1000
+void rainflow_sample(struct rainflow* rf, uint16_t permille);
+
+uint8_t rainflow_depth_bin(uint16_t depth);
+uint8_t rainflow_mean_bin(uint16_t mean);
+// the lower edge of a depth bin, permille
+uint16_t rainflow_depth_edge(uint8_t bin);
+
+// closed cycles at least min_depth deep (a bin edge), halves rounded down
+uint32_t rainflow_cycles(const struct rainflow* rf, uint16_t min_depth);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __RAINFLOW_H__
\ No newline at end of file
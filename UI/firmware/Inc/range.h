@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#ifndef __RANGE_H__
+#define __RANGE_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    Remaining range = remaining usable energy / expected consumption.
+
+    The expected consumption blends the recent (rolling 5 km), this
+    ride's and the long-term Wh/km, the recent one weighted the most;
+    missing figures drop out of the blend. The result is damped with a
+    RANGE_TAU_MS time constant so single hills do not swing it.
+    Every update is a handful of integer operations, it runs on each
+    electric and motion frame.
+*/
+
+#define RANGE_TAU_MS        20000
+// used until anything was measured, 0.1 Wh/km
+#define RANGE_DEFAULT_DWH_KM 200
+
+#define RANGE_W_RECENT      2
+#define RANGE_W_RIDE        1
+#define RANGE_W_LONG        1
+
+struct range
+{
+    // in m, Q8
+    int64_t range;
+    uint32_t last_ms;
+    uint8_t started;
+};
+
+void range_init(struct range* r);
+
+// 0.1 Wh/km, 0 == unknown
+uint16_t range_blend(uint16_t recent, uint16_t ride, uint16_t long_term);
+
+void range_update(struct range* r, uint32_t remaining_mWh, uint16_t dWh_km,
+    uint32_t now_ms);
+
+uint32_t range_m(const struct range* r);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __RANGE_H__
\ No newline at end of file
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#ifndef __RESUME_H__
+#define __RESUME_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    Fast boot. The backup domain registers keep their content over a
+    reset as long as VDD (or VBAT) stays up, so the logic mirrors there
+    what the first frame needs: the display mode and the last gauges.
+    A warm boot finds a valid snapshot and draws the gauges right away,
+    before the welcome screens and the EEPROM. A power-on clears the
+    backup domain and the CRC does not match, i.e. a cold boot.
+
+    10 registers of 16 bit on the STM32F103:
+        crc16 | version | mode | batt % | ambient | batt_dv
+        | total_m | trip1_m | trip2_m
+*/
+
+#define RESUME_REGS     10
+#define RESUME_VERSION  1
+
+struct resume
+{
+    uint8_t display_mode;
+    uint8_t batt_perc;
+    int8_t ambient_temp;
+    // in 0.1 V
+    uint16_t batt_dv;
+    // in meters
+    uint32_t total_m;
+    uint32_t trip1_m;
+    uint32_t trip2_m;
+};
+
+void resume_init(void);
+void resume_store(const struct resume* r);
+// 0 == warm boot, r is filled; 1 == nothing valid to resume from
+int resume_load(struct resume* r);
+
+// the backup registers, bkp.c on the target and a fake in the tests
+void bkp_init(void);
+uint16_t bkp_read(uint8_t reg);
+void bkp_write(uint8_t reg, uint16_t v);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __RESUME_H__
\ No newline at end of file
@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#ifndef __RIDELOG_H__
+#define __RIDELOG_H__
+
+#include "eeprom_async.h"
+#include "stm32f1xx_hal.h"
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    Ride logger: a 1 Hz time series in a ring of 64 byte blocks on the
+    EEPROM, one block per write page. A block is
+
+        seq (u32 LE) | t_s (u32 LE) | n (u8) | bit stream | crc16 (LE)
+
+    and block `seq` lives in page seq % pages, found at the boot by a
+    binary search like the journal's. t_s is the second of the first
+    sample since the boot, so a block starting below the end of the
+    previous one starts a new ride.
+
+    Every sample is coded against the previous one, the first of a block
+    against zeros so that any block decodes on its own. A sample is a
+    single 0 bit when nothing changed, else a 1 bit followed by the
+    zigzagged delta of each field in a prefix code:
+
+        0                   0
+        10   + 2 bits       < 4
+        110  + 5 bits       < 32
+        1110 + 10 bits      < 1024
+        11110 + 16 bits     < 65536
+        11111 + 32 bits
+
+    Riding takes ~3 bytes a second, parked 1 bit.
+
+    Full blocks and the partial one at ride stops are written through the
+    EEPROM queue, a page at a time. The export streams the whole ring
+    over the USART1 in EXPORT_RIDE_LOG frames, one block per frame; the
+    host sorts the blocks by seq and decodes them with
+    ridelog_block_decode().
+*/
+
+#define RIDELOG_BLOCK       64
+#define RIDELOG_HEADER      9
+#define RIDELOG_STREAM      (RIDELOG_BLOCK - RIDELOG_HEADER - 2)
+// n is a byte, 4 minutes parked fill a block
+#define RIDELOG_MAX_SAMPLES 255
+
+struct ridelog_sample
+{
+    uint8_t speed_kmh;
+    // < 0 when recovering
+    int16_t amper_a;
+    // in 0.1 V
+    uint16_t batt_dv;
+    int8_t moto_temp;
+    int8_t driver_temp;
+    int8_t batt_temp;
+    int8_t ambient_temp;
+    // in Wh since the boot
+    uint32_t consumed_wh;
+};
+
+typedef HAL_StatusTypeDef (*ridelog_read_fn)(uint16_t addr, uint8_t* d,
+    uint16_t s);
+
+struct ridelog
+{
+    uint16_t base;
+    uint16_t pages;
+    ridelog_read_fn read;
+    // seq of the next block
+    uint32_t next_seq;
+    // seconds since the boot
+    uint32_t t_s;
+
+    // the block being filled and the one being written
+    uint8_t blk[2][RIDELOG_BLOCK];
+    uint8_t cur;
+    uint8_t writing;
+    uint16_t bits;
+    uint8_t n;
+    struct ridelog_sample prev;
+
+    // the export, page by page
+    uint8_t exporting;
+    uint8_t exp_reading;
+    uint8_t exp_ready;
+    uint16_t exp_page;
+    uint8_t exp_buf[RIDELOG_BLOCK];
+
+    // since ridelog_init()
+    uint32_t samples;
+    uint32_t blocks_written;
+    uint16_t blocks_dropped;
+};
+
+// base page aligned, pages > 1
+void ridelog_init(struct ridelog* rl, uint16_t base, uint16_t pages,
+    ridelog_read_fn read);
+// blocking, finds where the ring continues; 1 for an empty ring
+int ridelog_open(struct ridelog* rl);
+
+// once a second
+void ridelog_sample(struct ridelog* rl, const struct ridelog_sample* s);
+// queues the partial block, the next sample starts a new one
+void ridelog_flush(struct ridelog* rl);
+
+// 1 when an export is already running
+int ridelog_export_start(struct ridelog* rl);
+// drives the export from the main loop
+void ridelog_poll(struct ridelog* rl);
+
+// checks and decodes a block, returns the number of samples or -1
+int ridelog_block_decode(const uint8_t* blk, uint32_t* seq, uint32_t* t_s,
+    struct ridelog_sample* out, uint16_t max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __RIDELOG_H__
\ No newline at end of file
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#ifndef __RINT_H__
+#define __RINT_H__
+
+#include "state.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    Pack internal resistance from the (V, I) pairs of the electric frames.
+
+    Fits V = OCV - R * I by least squares with exponential forgetting.
+    The recursion is kept in its sufficient statistics form: exponentially
+    weighted means of I, V, I^2 and I*V (weight 2^-RINT_FORGET_SHIFT for
+    the newest sample), from which OCV and R are solved in closed form.
+    That is O(1) per frame and plain integer math; means rather than sums
+    keep the magnitudes independent of the window length.
+
+    A sample is only accepted when the current moved by at least
+    RINT_MIN_DI since the last accepted one; steady current carries no
+    information about R and would just wash the history out.
+*/
+
+// forgetting factor 1 - 1/256
+#define RINT_FORGET_SHIFT   8
+// fractional bits of the means
+#define RINT_Q              16
+// accepted samples before R is reported
+#define RINT_MIN_SAMPLES    32
+// 0.1 A
+#define RINT_MIN_DI         10
+// minimal current spread (0.1 A) before R is reported
+#define RINT_MIN_SPREAD_DA  20
+
+struct rint
+{
+    int64_t mi;
+    int64_t mv;
+    int64_t mii;
+    int64_t miv;
+    uint16_t samples;
+    int16_t last_da;
+    uint8_t has_last;
+    // last solution
+    uint16_t mohm;
+    uint16_t ocv_dv;
+    uint8_t valid;
+};
+
+void rint_init(struct rint* r);
+
+// battery voltage in 0.1 V, current in 0.1 A
+void rint_sample(struct rint* r, uint16_t batt_dv, int16_t amper_da);
+
+uint8_t rint_valid(const struct rint* r);
+uint16_t rint_mohm(const struct rint* r);
+// the voltage without the I * R sag, in 0.1 V
+uint16_t rint_compensate_dv(const struct rint* r, uint16_t batt_dv,
+    int16_t amper_da);
+
+// stores R of the current ride, a new ride appends an entry
+void rint_history_put(struct rint_history* h, uint16_t mohm, uint8_t new_ride);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __RINT_H__
\ No newline at end of file
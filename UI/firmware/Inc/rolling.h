@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#ifndef __ROLLING_H__
+#define __ROLLING_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    Consumption over the recent past instead of the whole odometer.
+
+    Net energy is binned into 100 m distance buckets and 10 s time
+    buckets (which also record the distance). Each window keeps a running
+    sum, a closed bucket is added and the one leaving the window is
+    subtracted, so an update is O(1) whatever the window size.
+    Only closed buckets count, the values move once per bucket.
+*/
+
+#define ROLL_DIST_BUCKET_MM 100000
+#define ROLL_DIST_BUCKETS   50
+#define ROLL_TIME_BUCKET_MS 10000
+#define ROLL_TIME_BUCKETS   60
+
+// windows
+#define ROLL_1KM            0
+#define ROLL_5KM            1
+#define ROLL_10MIN          2
+
+struct rolling
+{
+    // closed buckets
+    int32_t dist_mWs[ROLL_DIST_BUCKETS];
+    uint8_t dist_head;
+    uint8_t dist_count;
+    int64_t sum_1km_mWs;
+    int64_t sum_5km_mWs;
+
+    int32_t time_mWs[ROLL_TIME_BUCKETS];
+    uint32_t time_mm[ROLL_TIME_BUCKETS];
+    uint8_t time_head;
+    uint8_t time_count;
+    int64_t sum_10min_mWs;
+    uint32_t sum_10min_mm;
+
+    // open buckets
+    uint64_t dist_edge_mm;
+    int32_t dist_open_mWs;
+    uint32_t time_edge_ms;
+    int32_t time_open_mWs;
+    uint32_t time_open_mm;
+
+    // totals at the previous update
+    uint64_t last_mm;
+    int64_t last_mWs;
+    uint8_t started;
+};
+
+void rolling_init(struct rolling* r);
+
+// odometer in mm, net (consumed - recovered) energy in mWs
+void rolling_update(struct rolling* r, uint64_t total_mm, int64_t net_mWs,
+    uint32_t now_ms);
+
+// 0.1 Wh/km over one of the windows
+uint16_t rolling_dWh_km(const struct rolling* r, uint8_t window);
+// 0.1 km/h over the last 10 minutes
+uint16_t rolling_avg_dkmh(const struct rolling* r);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __ROLLING_H__
\ No newline at end of file
@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#ifndef __SOC_H__
+#define __SOC_H__
+
+#include "state.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    Battery state of charge by coulomb counting.
+
+    The charge drawn since "full" is integrated from the current samples
+    (trapezoidal, like energy.c) against the pack capacity
+    cell_cap_mah * batt_p. The loaded voltage is not used while riding,
+    it sags with the current.
+
+    The count is re-anchored to the open circuit voltage of a cell when
+    the pack is at rest: on the first quiet sample after power up (the
+    bike was off) and after SOC_REST_MS of quiet current. The OCV curve
+    is the one of a Li-ion (NMC) cell with its ends moved to the
+    configured cell_mv_min/cell_mv_max; a configured range not spanning
+    the inner points of that curve (e.g. LiFePO4) is taken as linear.
+
+    The drawn charge and the equivalent full cycles live in
+    vehicle_runtime across power cycles.
+*/
+
+// below this the pack is resting, 0.1 A
+#define SOC_REST_DA         5
+// quiet time needed to re-anchor while powered
+#define SOC_REST_MS         600000
+// samples further apart are not connected
+#define SOC_MAX_GAP_MS      1000
+
+struct soc
+{
+    // in uAs (mA * ms)
+    int64_t capacity;
+    // drawn since full
+    int64_t used;
+    // discharged towards the next equivalent full cycle
+    int64_t cycle;
+    uint16_t cycles;
+    uint8_t batt_s;
+    // cell_cap_mah * batt_p * batt_s
+    uint32_t mah_cells;
+    // ends of the OCV curve
+    uint16_t cell_mv_min;
+    uint16_t cell_mv_max;
+    uint8_t ocv_linear;
+
+    int16_t prev_da;
+    uint8_t has_prev;
+    uint8_t anchored;
+    uint32_t rest_ms;
+};
+
+void soc_init(struct soc* s, const struct vehicle_conf* vc);
+
+void soc_restore(struct soc* s, const struct vehicle_runtime* vr);
+void soc_store(const struct soc* s, struct vehicle_runtime* vr);
+
+// battery voltage in 0.1 V, current in 0.1 A (< 0 when charging)
+void soc_sample(struct soc* s, uint16_t batt_dv, int16_t amper_da,
+    uint32_t dt_ms);
+
+// drops the previous sample, the next one starts a new segment
+void soc_break(struct soc* s);
+
+// 0 - 1000
+uint16_t soc_permille(const struct soc* s);
+uint8_t soc_percent(const struct soc* s);
+
+// open circuit voltage of a single cell -> 0 - 1000
+uint16_t soc_ocv_permille(const struct soc* s, uint16_t cell_mv);
+
+// energy left in the pack down to 0 %, following the OCV curve
+uint32_t soc_remaining_mWh(const struct soc* s);
+
+// equivalent full cycles of the discharged charge, in 0.1
+uint32_t soc_cycles_dc(const struct soc* s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __SOC_H__
\ No newline at end of file
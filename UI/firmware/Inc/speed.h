@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#ifndef __SPEED_H__
+#define __SPEED_H__
+
+#include "state.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    Speed and acceleration estimate from the motherboard's pulse counter.
+
+    Every BCP_MSG_MOTION carries the total pulse count and its timestamp.
+    The pulses of one window give the average speed in the middle of the
+    window; an alpha-beta filter tracks speed and acceleration so the
+    estimate is reported at the time of the message, not half a window
+    late, and the +-1 pulse quantization is smoothed out.
+
+    A window without pulses bounds the speed by one pulse per idle time,
+    after SPEED_STOP_MS without pulses the vehicle is stopped.
+
+    All math is fixed point, speeds in mm/s Q8.
+*/
+
+#define SPEED_Q             8
+// no pulses for this long => stopped
+#define SPEED_STOP_MS       1500
+// windows longer than this (lost messages) restart the filter
+#define SPEED_MAX_WINDOW_MS 2000
+
+struct speed_est
+{
+    // mm per pulse, Q16, precomputed from vehicle_conf
+    uint32_t mm_pp;
+    uint32_t pulses;
+    // time since the last window with pulses
+    uint32_t idle_ms;
+    // mm/s Q8
+    int32_t v;
+    // mm/s^2 Q8
+    int32_t a;
+    // 0 - 100 %
+    uint8_t confidence;
+    uint8_t started;
+};
+
+void speed_init(struct speed_est* se, const struct vehicle_conf* vc);
+
+// total pulse counter after dt_ms since the previous call
+void speed_update(struct speed_est* se, uint32_t tot_pulses, uint32_t dt_ms);
+
+// in 0.1 km/h
+uint16_t speed_dkmh(const struct speed_est* se);
+// in 0.01 m/s^2
+int16_t speed_accel(const struct speed_est* se);
+// how much the estimate can be trusted, 0 - 100 %
+uint8_t speed_confidence(const struct speed_est* se);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __SPEED_H__
\ No newline at end of file
@@ -26,8 +26,19 @@
 #ifndef __STATE_H__
 #define __STATE_H__
 
+#include "eeprom_async.h"
+
 #include <stdint.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct journal;
+struct ridelog;
+struct faultlog;
+struct profile;
+
 struct eeprom_constants
 {
     uint32_t magic;
@@ -71,19 +82,96 @@ struct trip_runtime
 struct vehicle_runtime
 {
     uint16_t last_batt_mv;
-    uint16_t pow_consumed_mah;
+    uint32_t pow_consumed_mah;
     uint16_t full_batt_charge_cycles;
     uint8_t current_display_mode;
     struct trip_runtime total;
     struct trip_runtime trip1;
     struct trip_runtime trip2;
+    // discharged towards the next full_batt_charge_cycles
+    uint32_t cycle_mah;
+    // long-term consumption, 0.1 Wh/km
+    uint16_t avg_dWh_km;
 };
 
-struct faults
+// a trip, kept up to date while it runs and archived at its reset
+struct trip_summary
+{
+    // archive order, 0 while running
+    uint32_t seq;
+    // 1 or 2
+    uint8_t trip;
+    // odometer at the reset, in meters
+    uint32_t end_m;
+    uint32_t dist_m;
+    uint32_t moving_s;
+    // in 0.1 km/h
+    uint16_t max_dkmh;
+    // in 0.1 Wh
+    uint32_t consumed_dWh;
+    uint32_t recovered_dWh;
+    int8_t max_moto_temp;
+    int8_t max_driver_temp;
+    int8_t max_batt_temp;
+};
+
+#define TRIP_ARCHIVE 14
+
+// the last reset trips, oldest first
+struct trip_archive
 {
-    uint16_t faults[16];
+    struct trip_summary trips[TRIP_ARCHIVE];
+    uint8_t count;
+    uint32_t next_seq;
 };
 
+// a charge of the pack, with the totals of all of them up to it
+struct charge_session
+{
+    // 1 for the first one, 0 == none yet
+    uint32_t seq;
+    // in 0.1 V
+    uint16_t start_dv;
+    uint16_t end_dv;
+    uint32_t duration_s;
+    // 0 when the current sensor did not see the charger
+    uint32_t dWh_in;
+    uint32_t mAh_in;
+    uint32_t total_dWh;
+    uint32_t total_mAh;
+};
+
+#define RINT_HISTORY 16
+
+// pack internal resistance of the last rides, oldest first
+struct rint_history
+{
+    uint16_t mohm[RINT_HISTORY];
+    uint8_t count;
+};
+
+// rainflow.c: depth bins by their lower edge in permille of the charge,
+// mean bins of 250 permille each
+#define RAINFLOW_DEPTHS 7
+#define RAINFLOW_MEANS  4
+#define RAINFLOW_STACK  28
+
+// battery cycles counted from the state of charge
+struct rainflow
+{
+    // half cycles, a closed cycle counts 2
+    uint16_t half[RAINFLOW_DEPTHS][RAINFLOW_MEANS];
+    // reversals not closed yet in permille, oldest first; the last one
+    // still follows the signal
+    uint16_t stack[RAINFLOW_STACK];
+    uint8_t count;
+};
+
+// The blocking load/save functions are for the boot, before
+// eeprom_async_init(). The *_async ones go through the EEPROM queue,
+// copy the data and return 1 while the previous save of the same data is
+// still pending.
+
 void init_eeprom_constants(struct eeprom_constants* ec);
 int check_eeprom_constants(const struct eeprom_constants* ec);
 int load_eeprom_constants(struct eeprom_constants* ec);
@@ -92,10 +180,65 @@ int save_eeprom_constants(const struct eeprom_constants* ec);
 void init_vehicle_conf(struct vehicle_conf* vc);
 int load_vehicle_conf(struct vehicle_conf* vc);
 int save_vehicle_conf(const struct vehicle_conf* vc);
+int save_vehicle_conf_async(const struct vehicle_conf* vc,
+    eeprom_async_cb cb, void* ctx);
 
 void init_vehicle_runtime(struct vehicle_runtime* vr);
 int load_vehicle_runtime(struct vehicle_runtime* vr);
 int save_vehicle_runtime(const struct vehicle_runtime* vr);
+int save_vehicle_runtime_async(const struct vehicle_runtime* vr,
+    eeprom_async_cb cb, void* ctx);
+// Brown-out commit: the main loop keeps a prepared copy of the runtime,
+// the PVD interrupt writes it as a single page bypassing the queue.
+// If the supply comes back the main loop has to recover, the queue and
+// the runtime journal are reopened once the EEPROM answers again;
+// vehicle_runtime_committed() stays set until then.
+void prepare_vehicle_runtime_commit(const struct vehicle_runtime* vr);
+int commit_vehicle_runtime(void);
+uint8_t vehicle_runtime_committed(void);
+void recover_vehicle_runtime_commit(void);
+// the store behind the runtime, for its wear statistics
+const struct journal* vehicle_runtime_journal(void);
+
+void init_rint_history(struct rint_history* rh);
+int load_rint_history(struct rint_history* rh);
+int save_rint_history(const struct rint_history* rh);
+int save_rint_history_async(const struct rint_history* rh,
+    eeprom_async_cb cb, void* ctx);
+
+void init_rainflow(struct rainflow* rf);
+int load_rainflow(struct rainflow* rf);
+// the histogram and the open reversals
+int save_rainflow_async(const struct rainflow* rf,
+    eeprom_async_cb cb, void* ctx);
+
+// the newest of the charge sessions, 1 when there is none
+int load_charge_last(struct charge_session* cs);
+int save_charge_async(const struct charge_session* cs,
+    eeprom_async_cb cb, void* ctx);
+
+// the load profile histograms, 1 when not stored yet
+int load_profile(struct profile* p);
+int save_profile_async(const struct profile* p,
+    eeprom_async_cb cb, void* ctx);
+
+// the running trips 1 and 2, 1 when not stored yet
+int load_trip_live(struct trip_summary* live);
+int save_trip_live_async(const struct trip_summary* live,
+    eeprom_async_cb cb, void* ctx);
+void init_trip_archive(struct trip_archive* ta);
+int load_trip_archive(struct trip_archive* ta);
+// writes the newest trip of the archive
+int save_trip_async(const struct trip_archive* ta,
+    eeprom_async_cb cb, void* ctx);
+
+// the ride log ring in the spare EEPROM, 1 when empty
+int open_ride_log(struct ridelog* rl);
+// queues the scan of the fault events page
+int open_fault_log(struct faultlog* fl);
 
+#ifdef __cplusplus
+}
+#endif
 
 #endif // __STATE_H__
\ No newline at end of file
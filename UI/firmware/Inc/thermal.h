@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#ifndef __THERMAL_H__
+#define __THERMAL_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    Motor winding temperature, estimated.
+
+    The sensor sits on the case, reports every 5 s and lags the
+    windings by minutes under load. The model has two first order
+    nodes:
+
+        winding:  dTw/dt = g * I^2 - (Tw - Ta) / THERMAL_TAU_W_S
+        sensor:   dTs/dt = (Tw - Ts) / THERMAL_TAU_S_S
+
+    I^2 is integrated from every current sample and the model steps once
+    a second. Every reading of the sensor corrects both nodes by its
+    error against Ts (an observer, gains THERMAL_L_*). The heating gain g
+    follows the error too, weighted by how much Ts would have moved with
+    g (the sensitivity, run through the same two nodes), so that a
+    climb teaches g and a state error after a rest does not.
+
+    The time to a limit assumes the load of the last THERMAL_LOAD_TAU_MS
+    stays: Tw heads for Ta + g * I^2 * THERMAL_TAU_W_S exponentially.
+
+    Temperatures are Q16 C, g is Q24 C/s per A^2.
+*/
+
+#define THERMAL_TAU_W_S         900
+#define THERMAL_TAU_S_S         180
+// 7.5e-5 C/s per A^2, 60 C over ambient at 30 A
+#define THERMAL_G_DEF           1258
+#define THERMAL_G_MIN           (THERMAL_G_DEF / 4)
+#define THERMAL_G_MAX           (THERMAL_G_DEF * 4)
+// observer gains in 1/256
+#define THERMAL_L_S             77
+#define THERMAL_L_W             77
+// g follows 1/4 of the error a reading explains
+#define THERMAL_CAL_SHIFT       2
+// the load below which readings tell little about g, A^2
+#define THERMAL_CAL_MIN_A2      400
+#define THERMAL_LOAD_TAU_MS     16000
+#define THERMAL_NEVER           UINT16_MAX
+
+struct thermal
+{
+    int32_t tw;
+    int32_t ts;
+    int32_t ta;
+    int32_t g;
+    // I^2 since the last step, A^2 ms
+    uint32_t acc_a2ms;
+    // recent load, Q8 A^2
+    int32_t load;
+    // d(Tw)/dg and d(Ts)/dg, Q4 A^2 s
+    int32_t sw;
+    int32_t ss;
+    uint8_t primed;
+};
+
+void thermal_init(struct thermal* th, int16_t ambient_c);
+// every current sample, 0.1 A over dt_ms
+void thermal_current(struct thermal* th, int16_t amper_da, uint32_t dt_ms);
+void thermal_ambient(struct thermal* th, int16_t ambient_c);
+// once a second
+void thermal_step(struct thermal* th, uint32_t dt_ms);
+// every valid sensor reading
+void thermal_measure(struct thermal* th, int16_t moto_c);
+
+int16_t thermal_winding_c(const struct thermal* th);
+// seconds until the winding reaches limit_c at the recent load, 0 when
+// there, THERMAL_NEVER when it stays below
+uint16_t thermal_time_to(const struct thermal* th, int16_t limit_c);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __THERMAL_H__
\ No newline at end of file
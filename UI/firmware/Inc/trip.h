@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#ifndef __TRIP_H__
+#define __TRIP_H__
+
+#include "state.h"
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    Trip summaries.
+
+    Trips 1 and 2 each keep a running summary, updated from every frame
+    of the logic in constant time: the distance is the trip counter,
+    the moving time adds up while the speed is not 0, the energy adds
+    the deltas of the energy counters, the maxima only compare. What is
+    below a unit of the summary is carried over to the next frame.
+
+    A trip reset closes the summary into the archive, the last
+    TRIP_ARCHIVE trips. The archive is stored a write page per trip, see
+    state.c, and exported over the USART1 oldest first, a frame per trip
+    with the persist_encode_trip() image.
+*/
+
+struct trip_frame
+{
+    // trip counter
+    uint32_t dist_m;
+    uint16_t speed_dkmh;
+    int16_t amper_da;
+    // since the previous frame
+    uint32_t dt_ms;
+    uint32_t consumed_mWs;
+    uint32_t recovered_mWs;
+    int16_t moto_temp;
+    int16_t driver_temp;
+    int16_t batt_temp;
+};
+
+struct trip
+{
+    struct trip_summary s;
+    // for the vehicle runtime, the charge drawn
+    uint32_t consumed_mah;
+    // remainders below the units
+    uint32_t moving_ms;
+    uint32_t consumed_mWs;
+    uint32_t recovered_mWs;
+    uint32_t consumed_dAms;
+};
+
+void trip_start(struct trip* t, uint8_t which);
+void trip_resume(struct trip* t, const struct trip_summary* s,
+    uint32_t consumed_mah);
+void trip_update(struct trip* t, const struct trip_frame* f);
+// over the moving time, 0.1 km/h
+uint16_t trip_avg_dkmh(const struct trip_summary* s);
+
+// closes `t` into the archive and starts it again
+void trip_archive_put(struct trip_archive* ta, struct trip* t,
+    uint32_t end_m);
+// k == 0 is the newest, NULL past the oldest
+const struct trip_summary* trip_archive_get(const struct trip_archive* ta,
+    uint8_t k);
+
+// 1 while an export runs
+int trip_export_start(void);
+// from the main loop
+void trip_export_poll(const struct trip_archive* ta);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __TRIP_H__
\ No newline at end of file
@@ -28,6 +28,19 @@
 
 #include "state.h"
 
+// uncomment to log cycles spent in ui_update() every 30s
+// #define UI_BENCH
+
+// ui_update() call period
+#define UI_TICK_MS 100
+// a sparkline point averages the power over that long, GFX_SPARK_LEN of
+// them span half a minute
+#define UI_SPARK_MS 2000
+// each welcome screen is held that long, the first one beeps on top
+#define UI_WELCOME_SCREEN_MS    700
+#define UI_WELCOME_BEEP_MS      100
+#define UI_WELCOME_MS (2 * UI_WELCOME_SCREEN_MS + UI_WELCOME_BEEP_MS)
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -50,31 +63,136 @@ enum display_mode
     // "+4208W 108W/km  "
     // "84.1V 100% +80A "
     DM_POWER2,
+    // battery bar, power
+    // "######=   + 840W"
+    // "84.1V 100% +80A "
+    DM_BAR,
+    // power sparkline, power
+    // "  _.-=#=-.  840W"
+    // "84.1V 100% +80A "
+    DM_SPARK,
+    // Wh/km over the last 1 km and 5 km
+    // "1k 63.7  5k 58.2"
+    // "84.1V 100% +80A "
+    DM_ROLL_DIST,
+    // Wh/km and average speed over the last 10 minutes
+    // "10m 61.2  25km/h"
+    // "84.1V 100% +80A "
+    DM_ROLL_TIME,
+    // pack internal resistance, sag compensated voltage
+    // "  85mOhm 83.1Voc"
+    // "84.1V 100% +80A "
+    DM_BATT,
+    // predicted remaining range
+    // "Range     42.3km"
+    // "84.1V 100% +80A "
+    DM_RANGE,
+    // logged faults in turn, onsets and the km of the last one
+    // "Batt Tsens   x3 "
+    // "ON      1234.5km"
+    DM_FAULTS,
+    // archived trips, newest first: distance, moving time,
+    // average/max speed, energy
+    // "#1   12.3km  83m"
+    // "25/45km/h 12.3Wh"
+    DM_TRIPS,
+    // estimated motor winding temperature, minutes to the motor limit
+    // at the present load
+    // "Wind 112C  12min"
+    // "84.1V 100% +80A "
+    DM_MOTOR,
+    // equivalent full cycles, rainflow cycles of 60 % and more
+    // "Cycles     123.4"
+    // "deep>60%      12"
+    DM_CYCLES,
     DM_LIMIT,
 };
 
 struct vehicle_gauges
 {
     uint8_t motherboard_offline;
-    float batt_v;
+    // in 0.1 V
+    uint16_t batt_dv;
+    // batt_dv without the internal resistance sag, in 0.1 V
+    uint16_t batt_ocv_dv;
+    // pack internal resistance in mOhm, 0 until known
+    uint16_t rint_mohm;
     uint8_t batt_perc;
-    float amper;
+    // in 0.1 A
+    int16_t amper_da;
+    // in 0.01 W, < 0 when recovering energy
+    int32_t power_cw;
 
     // in meters
     uint32_t total_m;
     uint32_t trip1_m;
     uint32_t trip2_m;
 
-    uint8_t speed_kmh;
+    // in 0.1 km/h
+    uint16_t speed_dkmh;
+    // trust in speed_dkmh, 0 - 100 %
+    uint8_t speed_conf;
     
     int16_t ambient_temp;
     int16_t moto_temp;
     int16_t driver_temp;
     int16_t batt_temp;
 
-    float consumed_Wh;
-    float brake_Wh;
-    float Wh_km;
+    // in 0.1 Wh
+    uint32_t consumed_dWh;
+    uint32_t brake_dWh;
+    // in 0.1 Wh/km
+    uint16_t dWh_km;
+    // in 0.1 Wh/km over the last 1 km, 5 km and 10 minutes
+    uint16_t dWh_km_1km;
+    uint16_t dWh_km_5km;
+    uint16_t dWh_km_10min;
+    // in 0.1 km/h over the last 10 minutes
+    uint16_t avg_dkmh_10min;
+    // predicted remaining range in meters
+    uint32_t range_m;
+
+    // the fault shown, bit + 1, 0 == none logged
+    uint8_t fault_name;
+    // its onsets so far
+    uint16_t fault_count;
+    // 0 == none, 1 == cleared, 2 == active
+    uint8_t fault_state;
+    // odometer at the last onset in meters
+    uint32_t fault_last_m;
+
+    // the archived trip shown, 1 == the newest, 0 == none
+    uint8_t trip_no;
+    uint32_t trip_dist_m;
+    // in 0.1 km/h
+    uint16_t trip_avg_dkmh;
+    uint16_t trip_max_dkmh;
+    uint16_t trip_moving_min;
+    // in 0.1 Wh
+    uint32_t trip_dWh;
+
+    // the alarm on the override screen, row + 1, and its enum alarm_level
+    uint8_t alarm_name;
+    uint8_t alarm_level;
+    int16_t alarm_temp;
+    uint8_t alarm_limit;
+    // in C/min
+    int16_t alarm_slope;
+
+    // estimated motor winding temperature
+    int16_t moto_wind_temp;
+    // to moto_t_alarm_c at the present load, 0 == not reached
+    uint16_t moto_limit_min;
+
+    // in 0.1
+    uint32_t batt_cycles_dc;
+    uint16_t batt_deep_cycles;
+
+    // the running charge session: 0.1 Wh in, charger 0.1 A, minutes to
+    // full, 0 == unknown
+    uint32_t charge_dWh;
+    uint16_t charge_da;
+    uint16_t charge_min;
 };
 
 void ui_init(void);
@@ -83,6 +201,16 @@ void ui_set_display_mode(enum display_mode dm);
 
 void ui_disable_amp_gauges(void);
 
+// the alarm screen over any display mode, while on
+// "Motor   HOT! 95C"
+// "max 90C   2C/min"
+void ui_set_alarm(uint8_t on);
+
+// the charge screen over any display mode, under the alarm
+// "CHG 82.1V 125min"
+// "   123.4Wh  4.2A"
+void ui_set_charging(uint8_t on);
+
 void ui_update(const struct vehicle_gauges* vg);
 
 void ui_welcome_screen_blk_1(void);
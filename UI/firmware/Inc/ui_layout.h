@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#ifndef __UI_LAYOUT_H__
+#define __UI_LAYOUT_H__
+
+#include "ui.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+    Screens are described by constant tables of fields, each field says
+    where it goes (row, column, width), what it shows (a member of
+    struct vehicle_gauges) and how (format, unit, refresh period).
+
+    Fields are declared with the UI_* macros below, these check at compile
+    time that the field fits into the display and take the source type
+    from the vehicle_gauges member itself.
+*/
+
+#define UI_COLS             16
+#define UI_ROWS             2
+#define UI_MAX_FIELDS       8
+
+// field formats
+#define UF_TEXT             0
+// number with suffix, decimals dropped if it does not fit
+#define UF_NUM              1
+// auto ranged gauge "0", "8.4", "84.0", "840", "8.4k", "67k" + unit
+#define UF_GAUGE            2
+#define UF_BAR              3
+#define UF_SPARK            4
+// entry of a table of names, the value is the index
+#define UF_NAME             5
+
+// field flags
+#define UF_LEFT             0x01
+// truncate instead of rounding (distances)
+#define UF_TRUNC            0x02
+// negative values shown as 0
+#define UF_CLAMP0           0x04
+// absolute value, '+' in the first column if negative (regeneration)
+#define UF_REGEN_PLUS       0x08
+// nothing shown for 0
+#define UF_BLANK0           0x10
+
+// source type, size in bytes + signedness
+#define GT_SIZE_MASK        0x0F
+#define GT_SIGNED           0x80
+
+// refresh period in UI ticks, 0 means static (redrawn when dirty only)
+#define UI_STATIC           0
+#define UI_REFRESH(ms)      (((ms) < UI_TICK_MS) ? 1 : (ms) / UI_TICK_MS)
+
+struct ui_field
+{
+    uint8_t row;
+    uint8_t col;
+    uint8_t width;
+    uint8_t fmt;
+    uint8_t flags;
+    // offsetof in struct vehicle_gauges and type of the member
+    uint8_t src;
+    uint8_t src_type;
+    // decimal places of the source and decimal places shown
+    uint8_t dp;
+    uint8_t prec;
+    char prefix;
+    uint8_t refresh;
+    // full scale of bars, entries of name tables
+    uint16_t scale;
+    // unit/suffix text, the sparkline or the name table
+    const void* arg;
+};
+
+struct ui_screen
+{
+    const struct ui_field* fields;
+    uint8_t count;
+    // shares the status row (voltage, percentage, current)
+    uint8_t status_row;
+};
+
+// compile time checks, evaluate to 0
+#define UI_ASSERT(cond)     (0 * sizeof(char[(cond) ? 1 : -1]))
+#define UI_FITS(r, c, w)    UI_ASSERT((r) < UI_ROWS && (c) + (w) <= UI_COLS)
+
+#define UI_MEMBER(m)        (((struct vehicle_gauges*)0)->m)
+#define UI_SRC(m) \
+    .src = offsetof(struct vehicle_gauges, m), \
+    .src_type = (sizeof(UI_MEMBER(m)) \
+        | ((((__typeof__(UI_MEMBER(m)))-1) < 1) ? GT_SIGNED : 0)) \
+        + UI_ASSERT(sizeof(UI_MEMBER(m)) == 1 || sizeof(UI_MEMBER(m)) == 2 \
+            || sizeof(UI_MEMBER(m)) == 4)
+
+#define UI_POS(r, c, w) \
+    .row = (r), .col = (c), .width = (w) + UI_FITS(r, c, w)
+
+#define UI_TEXT(r, c, s) \
+    { UI_POS(r, c, sizeof(s) - 1), .fmt = UF_TEXT, .arg = s, \
+      .refresh = UI_STATIC }
+
+#define UI_NUM(r, c, w, m, dp_, prec_, pre, suffix, flags_, ms) \
+    { UI_POS(r, c, w), .fmt = UF_NUM, UI_SRC(m), .dp = (dp_), \
+      .prec = (prec_), .prefix = (pre), .arg = suffix, .flags = (flags_), \
+      .refresh = UI_REFRESH(ms) }
+
+// 4 characters + unit text (+ sign column with UF_REGEN_PLUS)
+#define UI_GAUGE(r, c, m, dp_, unit, flags_, ms) \
+    { UI_POS(r, c, 4 + sizeof(unit) - 1 + (((flags_) & UF_REGEN_PLUS) ? 1 : 0)), \
+      .fmt = UF_GAUGE, UI_SRC(m), .dp = (dp_), .arg = unit, \
+      .flags = (flags_), .refresh = UI_REFRESH(ms) }
+
+#define UI_BAR(r, c, w, m, full) \
+    { UI_POS(r, c, w), .fmt = UF_BAR, UI_SRC(m), .scale = (full), \
+      .refresh = 1 }
+
+#define UI_SPARK(r, c, w, spark) \
+    { UI_POS(r, c, w), .fmt = UF_SPARK, .arg = (spark), .refresh = 1 }
+
+// names: const char* const[], larger values show as the last one
+#define UI_NAME(r, c, w, m, names, flags_) \
+    { UI_POS(r, c, w), .fmt = UF_NAME, UI_SRC(m), .arg = (names), \
+      .scale = sizeof(names) / sizeof(names[0]), .flags = (flags_), \
+      .refresh = 1 }
+
+#define UI_SCREEN(f, status) \
+    { f, sizeof(f) / sizeof(f[0]) \
+        + UI_ASSERT(sizeof(f) / sizeof(f[0]) <= UI_MAX_FIELDS), status }
+
+// access to a vehicle_gauges member described by UI_SRC()
+static inline int32_t ui_gauge_get(const struct vehicle_gauges* vg,
+    uint8_t src, uint8_t src_type)
+{
+    const uint8_t* p = (const uint8_t*)vg + src;
+
+    switch (src_type) {
+    case 1:
+        return *(const uint8_t*)p;
+    case 1 | GT_SIGNED:
+        return *(const int8_t*)p;
+    case 2:
+        return *(const uint16_t*)p;
+    case 2 | GT_SIGNED:
+        return *(const int16_t*)p;
+    case 4 | GT_SIGNED:
+        return *(const int32_t*)p;
+    case 4:
+    default:
+        return *(const uint32_t*)p;
+    }
+}
+
+static inline void ui_gauge_set(struct vehicle_gauges* vg,
+    uint8_t src, uint8_t src_type, int32_t v)
+{
+    uint8_t* p = (uint8_t*)vg + src;
+
+    switch (src_type & GT_SIZE_MASK) {
+    case 1:
+        *(uint8_t*)p = v;
+        break;
+    case 2:
+        *(uint16_t*)p = v;
+        break;
+    case 4:
+    default:
+        *(uint32_t*)p = v;
+        break;
+    }
+}
+
+#endif // __UI_LAYOUT_H__
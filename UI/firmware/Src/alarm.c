@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#include "alarm.h"
+
+#include <stddef.h>
+#include <string.h>
+
+struct alarm_def
+{
+    // int16_t in vehicle_gauges, uint8_t in vehicle_conf
+    uint8_t temp;
+    uint8_t limit;
+    uint8_t hyst_c;
+    uint16_t horizon_s;
+};
+
+#define ALARM_TYPE_OK(s, m, t) \
+    (sizeof(((struct s*)0)->m) == sizeof(t))
+#define ALARM_DEF(t, l, hyst, horizon) \
+    { offsetof(struct vehicle_gauges, t) \
+        + 0 * sizeof(char[ALARM_TYPE_OK(vehicle_gauges, t, int16_t) ? 1 : -1]), \
+      offsetof(struct vehicle_conf, l) \
+        + 0 * sizeof(char[ALARM_TYPE_OK(vehicle_conf, l, uint8_t) ? 1 : -1]), \
+      hyst, horizon }
+
+// the motor and the driver heat up within a minute, the pack slowly
+static const struct alarm_def defs[] = {
+    ALARM_DEF(moto_temp, moto_t_alarm_c, 5, 60),
+    ALARM_DEF(driver_temp, drv_t_alarm_c, 5, 60),
+    ALARM_DEF(batt_temp, batt_t_alarm_c, 3, 300),
+};
+
+typedef char alarm_rows_check[
+    (sizeof(defs) / sizeof(defs[0]) == ALARM_ROWS) ? 1 : -1];
+
+static int16_t _reading(const struct vehicle_gauges* vg, uint8_t row)
+{
+    return *(const int16_t*)((const uint8_t*)vg + defs[row].temp);
+}
+
+// one step of the first order filter over dt_ms
+static int32_t _filter(int32_t s, int32_t v, uint32_t dt_ms)
+{
+    return s + (int32_t)((int64_t)(v - s) * dt_ms / (ALARM_TAU_MS + dt_ms));
+}
+
+void alarm_init(struct alarm* al)
+{
+    memset(al, 0, sizeof(struct alarm));
+}
+
+static void _track(struct alarm_row* r, int16_t t, uint32_t now_ms)
+{
+    int32_t t_mc = (int32_t)t * 1000;
+
+    if (!r->primed) {
+        r->primed = 1;
+        r->temp_mc = t_mc;
+        r->slope_mcs = 0;
+        r->prev_ms = now_ms;
+        return;
+    }
+
+    uint32_t dt_ms = now_ms - r->prev_ms;
+    if (dt_ms == 0) {
+        return;
+    }
+    r->prev_ms = now_ms;
+
+    int32_t prev = r->temp_mc;
+    r->temp_mc = _filter(prev, t_mc, dt_ms);
+    r->slope_mcs = _filter(r->slope_mcs,
+        (int32_t)((int64_t)(r->temp_mc - prev) * 1000 / dt_ms), dt_ms);
+}
+
+uint8_t alarm_update(struct alarm* al, const struct vehicle_gauges* vg,
+    const struct vehicle_conf* vc, uint32_t now_ms)
+{
+    uint8_t rose = 0;
+
+    for (uint8_t i = 0; i < ALARM_ROWS; ++i) {
+        const struct alarm_def* d = &defs[i];
+        struct alarm_row* r = &al->rows[i];
+        int16_t t = _reading(vg, i);
+        int32_t limit = alarm_limit(vc, i);
+
+        if (t < ALARM_MIN_C) {
+            continue;
+        }
+        _track(r, t, now_ms);
+
+        uint8_t level = ALARM_OK;
+        if (limit) {
+            // the reading itself, the filtered one lags
+            int32_t ahead_mc = (int32_t)t * 1000
+                + (r->slope_mcs > 0 ? r->slope_mcs * d->horizon_s : 0);
+            int32_t clear = limit - d->hyst_c;
+
+            if (t >= limit || (r->level == ALARM_HOT && t > clear)) {
+                level = ALARM_HOT;
+            } else if (ahead_mc >= limit * 1000 || (r->level >= ALARM_WARN
+                    && ahead_mc > clear * 1000)) {
+                level = ALARM_WARN;
+            }
+        }
+
+        if (level > r->level) {
+            rose |= 1 << i;
+        }
+        r->level = level;
+    }
+
+    return rose;
+}
+
+int8_t alarm_worst(const struct alarm* al)
+{
+    int8_t worst = -1;
+
+    for (uint8_t i = 0; i < ALARM_ROWS; ++i) {
+        if (al->rows[i].level != ALARM_OK && (worst < 0
+                || al->rows[i].level > al->rows[worst].level)) {
+            worst = i;
+        }
+    }
+    return worst;
+}
+
+uint16_t alarm_faults(const struct alarm* al)
+{
+    uint16_t bits = 0;
+
+    for (uint8_t i = 0; i < ALARM_ROWS; ++i) {
+        if (al->rows[i].level == ALARM_HOT) {
+            bits |= 1 << (ALARM_FAULT_BIT + i);
+        }
+    }
+    return bits;
+}
+
+uint16_t alarm_fault_mask(void)
+{
+    return ((1 << ALARM_ROWS) - 1) << ALARM_FAULT_BIT;
+}
+
+int16_t alarm_temp(const struct vehicle_gauges* vg, uint8_t row)
+{
+    return _reading(vg, row);
+}
+
+uint8_t alarm_limit(const struct vehicle_conf* vc, uint8_t row)
+{
+    return *((const uint8_t*)vc + defs[row].limit);
+}
+
+int16_t alarm_slope_cmin(const struct alarm* al, uint8_t row)
+{
+    int32_t s = al->rows[row].slope_mcs * 60 / 1000;
+
+    return (s > INT16_MAX) ? INT16_MAX : (s < INT16_MIN) ? INT16_MIN : s;
+}
\ No newline at end of file
@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#include "buzzer.h"
+#include "system.h"
+
+#include <stddef.h>
+
+#define TICKS(ms)   ((ms) / BUZZER_TICK_MS)
+
+struct buzzer_def
+{
+    // on, off, on, off... in ticks
+    const uint8_t* steps;
+    uint8_t count;
+    // starts over after the last step
+    uint8_t loop;
+};
+
+static const uint8_t steps_reminder[] = { TICKS(1180) };
+static const uint8_t steps_warn[] = {
+    TICKS(100), TICKS(100), TICKS(100)
+};
+static const uint8_t steps_alarm[] = {
+    TICKS(300), TICKS(200), TICKS(300), TICKS(1200)
+};
+
+#define BUZZER_DEF(s, l)    { s, sizeof(s) / sizeof(s[0]), l }
+
+static const struct buzzer_def defs[BUZ_LIMIT] = {
+    [BUZ_NONE] = { NULL, 0, 0 },
+    [BUZ_REMINDER] = BUZZER_DEF(steps_reminder, 0),
+    [BUZ_WARN] = BUZZER_DEF(steps_warn, 0),
+    [BUZ_ALARM] = BUZZER_DEF(steps_alarm, 1),
+};
+
+static enum buzzer_pattern playing;
+static uint8_t step;
+static uint8_t left;
+
+static void _start(uint8_t s)
+{
+    step = s;
+    left = defs[playing].steps[s];
+    // even steps sound
+    if (s % 2 == 0) {
+        beep_on();
+    } else {
+        beep_off();
+    }
+}
+
+void buzzer_init(void)
+{
+    playing = BUZ_NONE;
+    beep_off();
+}
+
+void buzzer_play(enum buzzer_pattern p)
+{
+    if (p >= BUZ_LIMIT || p < playing || p == BUZ_NONE) {
+        return;
+    }
+    playing = p;
+    _start(0);
+}
+
+void buzzer_stop(enum buzzer_pattern p)
+{
+    if (playing == p) {
+        buzzer_init();
+    }
+}
+
+void buzzer_tick(void)
+{
+    if (playing == BUZ_NONE || --left > 0) {
+        return;
+    }
+
+    const struct buzzer_def* d = &defs[playing];
+    if (step + 1 < d->count) {
+        _start(step + 1);
+    } else if (d->loop) {
+        _start(0);
+    } else {
+        buzzer_init();
+    }
+}
+
+enum buzzer_pattern buzzer_playing(void)
+{
+    return playing;
+}
+
+uint8_t buzzer_on(void)
+{
+    return playing != BUZ_NONE && step % 2 == 0;
+}
\ No newline at end of file
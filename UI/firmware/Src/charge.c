@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#include "charge.h"
+#include "energy.h"
+
+#include <string.h>
+
+// 0.1 V * 0.1 A * ms in 0.1 Wh, 0.1 A * ms in mAh
+#define E_P_DWH     ((uint64_t)ENERGY_MWS_P_DWH * 100)
+#define Q_P_MAH     36000
+#define E_P_MWS     100
+
+static void _abandon(struct charge* c)
+{
+    // a blip, or the regeneration of the stop
+    c->returned_mWs += c->e_in / E_P_MWS;
+    c->state = CHARGE_IDLE;
+}
+
+static void _close(struct charge* c)
+{
+    if (c->state == CHARGE_ON) {
+        struct charge_session* s = &c->last;
+        uint32_t dWh = c->e_in / E_P_DWH;
+        uint32_t mAh = c->q_in / Q_P_MAH;
+
+        ++s->seq;
+        s->start_dv = c->start_dv;
+        s->end_dv = c->dv;
+        s->duration_s = c->state_ms / 1000;
+        s->dWh_in = dWh;
+        s->mAh_in = mAh;
+        s->total_dWh += dWh;
+        s->total_mAh += mAh;
+        c->closed = 1;
+    } else if (c->state == CHARGE_PENDING) {
+        _abandon(c);
+    }
+    c->state = CHARGE_IDLE;
+    c->rises = 0;
+}
+
+static void _start(struct charge* c, uint8_t state, uint16_t start_dv)
+{
+    c->state = state;
+    c->by_current = (state == CHARGE_PENDING);
+    c->state_ms = 0;
+    c->quiet_ms = 0;
+    c->e_in = 0;
+    c->q_in = 0;
+    c->avg_da = 0;
+    c->start_dv = start_dv;
+}
+
+void charge_init(struct charge* c, const struct charge_session* last)
+{
+    memset(c, 0, sizeof(struct charge));
+    c->last = *last;
+}
+
+uint8_t charge_sample(struct charge* c, uint16_t speed_dkmh,
+    uint16_t batt_dv, int16_t amper_da, uint32_t dt_ms)
+{
+    uint8_t in = amper_da <= -CHARGE_MIN_DA;
+
+    c->dv = batt_dv;
+    c->moving = speed_dkmh > 0;
+    c->quiet = !in && amper_da < CHARGE_MIN_DA;
+
+    if (c->moving) {
+        _close(c);
+        return 0;
+    }
+
+    if (c->state == CHARGE_ON) {
+        c->state_ms += dt_ms;
+    }
+    if (!in) {
+        if (c->state == CHARGE_PENDING) {
+            _abandon(c);
+        } else if (c->state == CHARGE_ON && c->by_current) {
+            c->quiet_ms += dt_ms;
+            if (c->quiet_ms >= CHARGE_END_MS) {
+                _close(c);
+            }
+        }
+        return 0;
+    }
+
+    if (c->state == CHARGE_IDLE) {
+        _start(c, CHARGE_PENDING, batt_dv);
+    } else if (c->state == CHARGE_PENDING) {
+        c->state_ms += dt_ms;
+        if (c->state_ms >= CHARGE_START_MS) {
+            c->state = CHARGE_ON;
+        }
+    }
+    // the sensor sees the charger now, if it did not
+    c->by_current = 1;
+    c->quiet_ms = 0;
+
+    uint32_t da = -amper_da;
+    c->e_in += (uint64_t)batt_dv * da * dt_ms;
+    c->q_in += (uint64_t)da * dt_ms;
+    c->avg_da += ((int64_t)(da << 16) - c->avg_da) * (int32_t)dt_ms
+        / (int32_t)(CHARGE_AVG_TAU_MS + dt_ms);
+    return 1;
+}
+
+void charge_tick(struct charge* c)
+{
+    if (++c->trend_s < CHARGE_TREND_S) {
+        return;
+    }
+
+    // no reference before the first window
+    uint8_t rose = c->trend_dv && !c->moving && c->quiet
+        && c->dv >= c->trend_dv + CHARGE_RISE_DV;
+
+    if (rose) {
+        if (c->rises == 0) {
+            c->rise_start_dv = c->trend_dv;
+        }
+        c->rises += (c->rises < UINT8_MAX);
+        c->rise_dv = c->dv - c->trend_dv;
+    } else {
+        c->rises = 0;
+        c->rise_dv = 0;
+    }
+    c->trend_dv = c->dv;
+    c->trend_s = 0;
+
+    if (c->state == CHARGE_IDLE && c->rises >= CHARGE_TREND_RISES) {
+        _start(c, CHARGE_ON, c->rise_start_dv);
+        c->state_ms = (uint32_t)CHARGE_TREND_RISES * CHARGE_TREND_S * 1000;
+    } else if (c->state == CHARGE_ON && !c->by_current && !rose) {
+        _close(c);
+    }
+}
+
+uint64_t charge_take_returned_mWs(struct charge* c)
+{
+    uint64_t mWs = c->returned_mWs;
+
+    c->returned_mWs = 0;
+    return mWs;
+}
+
+uint32_t charge_dWh(const struct charge* c)
+{
+    return (c->state == CHARGE_ON) ? c->e_in / E_P_DWH : 0;
+}
+
+uint16_t charge_current_da(const struct charge* c)
+{
+    return (c->state == CHARGE_ON) ? (c->avg_da + (1 << 15)) >> 16 : 0;
+}
+
+uint16_t charge_minutes_to_full(const struct charge* c,
+    uint32_t remaining_mah, uint16_t full_dv)
+{
+    uint32_t min;
+
+    if (c->state != CHARGE_ON) {
+        return 0;
+    }
+    if (c->by_current && c->avg_da >= (CHARGE_MIN_DA << 16)) {
+        // mAh over mA, the constant voltage tail is not in it
+        min = ((uint64_t)remaining_mah * 60 << 16)
+            / ((uint64_t)c->avg_da * 100);
+    } else if (!c->by_current && c->rise_dv && full_dv > c->dv) {
+        min = (uint32_t)(full_dv - c->dv) * CHARGE_TREND_S
+            / c->rise_dv / 60;
+    } else {
+        return 0;
+    }
+    // a minute at least while it is on its way
+    return (min >= 999) ? 999 : min + 1;
+}
\ No newline at end of file
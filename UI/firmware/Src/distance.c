@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#include "distance.h"
+
+void distance_init(struct distance* d, const struct vehicle_conf* vc)
+{
+    d->mm_p_rev = vc->dist_p_rev_mm;
+    d->ppr = vc->pulse_p_rev ? vc->pulse_p_rev : 1;
+
+    for (uint8_t i = 0; i < DIST_COUNTERS; ++i) {
+        d->c[i].mm = 0;
+        d->c[i].rem = 0;
+    }
+}
+
+void distance_set(struct distance* d, uint8_t counter, uint32_t pulses)
+{
+    uint64_t n = (uint64_t)pulses * d->mm_p_rev;
+
+    d->c[counter].mm = n / d->ppr;
+    d->c[counter].rem = n % d->ppr;
+}
+
+void distance_add(struct distance* d, uint32_t delta_pulses)
+{
+    if (delta_pulses == 0) {
+        return;
+    }
+
+    uint64_t n = (uint64_t)delta_pulses * d->mm_p_rev;
+    uint64_t mm = n / d->ppr;
+    uint32_t rem = n - mm * d->ppr;
+
+    for (uint8_t i = 0; i < DIST_COUNTERS; ++i) {
+        struct dist_counter* c = &d->c[i];
+
+        c->mm += mm;
+        c->rem += rem;
+        if (c->rem >= d->ppr) {
+            c->rem -= d->ppr;
+            ++c->mm;
+        }
+    }
+}
+
+uint64_t distance_mm(const struct distance* d, uint8_t counter)
+{
+    return d->c[counter].mm;
+}
+
+uint32_t distance_m(const struct distance* d, uint8_t counter)
+{
+    return d->c[counter].mm / 1000;
+}
\ No newline at end of file
@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#include "eeprom_async.h"
+
+#include <string.h>
+
+#define REQ_READ    0
+#define REQ_WRITE   1
+
+struct request
+{
+    uint8_t type;
+    uint16_t addr;
+    uint8_t* d;
+    uint16_t s;
+    // bytes already transferred
+    uint16_t done;
+    eeprom_async_cb cb;
+    void* ctx;
+};
+
+static struct request queue[EEPROM_ASYNC_QUEUE];
+static uint8_t head;
+static uint8_t count;
+
+// a transfer is on the bus
+static uint8_t in_flight;
+static uint16_t in_flight_s;
+static volatile uint8_t xfer_done;
+static volatile uint8_t xfer_ok;
+// the device runs a write cycle since cycle_start_ms
+static uint8_t in_cycle;
+static uint32_t cycle_start_ms;
+// the bus was taken over, nothing more is started
+static volatile uint8_t halted;
+
+static int _enqueue(uint8_t type, uint16_t addr, uint8_t* d, uint16_t s,
+    eeprom_async_cb cb, void* ctx)
+{
+    if (count == EEPROM_ASYNC_QUEUE) {
+        return 1;
+    }
+
+    struct request* r = &queue[(head + count) % EEPROM_ASYNC_QUEUE];
+    r->type = type;
+    r->addr = addr;
+    r->d = d;
+    r->s = s;
+    r->done = 0;
+    r->cb = cb;
+    r->ctx = ctx;
+    ++count;
+    return 0;
+}
+
+static void _finish(int err)
+{
+    struct request r = queue[head];
+
+    head = (head + 1) % EEPROM_ASYNC_QUEUE;
+    --count;
+    if (r.cb) {
+        // may queue the next request already
+        r.cb(r.ctx, err);
+    }
+}
+
+// starts the next part of the head request
+static void _start(void)
+{
+    struct request* r = &queue[head];
+    uint16_t addr = r->addr + r->done;
+    uint16_t s = r->s - r->done;
+    HAL_StatusTypeDef ret;
+
+    // the interrupt may come before the call returns
+    xfer_done = 0;
+    if (r->type == REQ_WRITE) {
+        uint16_t room = EEPROM_ASYNC_PAGE - addr % EEPROM_ASYNC_PAGE;
+        if (s > room) {
+            s = room;
+        }
+        ret = eeprom_port_write(addr, r->d + r->done, s);
+    } else {
+        ret = eeprom_port_read(addr, r->d + r->done, s);
+    }
+
+    if (ret != HAL_OK) {
+        _finish(1);
+        return;
+    }
+    in_flight = 1;
+    in_flight_s = s;
+}
+
+void eeprom_async_init(void)
+{
+    struct request dropped[EEPROM_ASYNC_QUEUE];
+    uint8_t n = count;
+    // the write that bypassed the queue may still be in its cycle
+    uint8_t bypassed = halted;
+
+    for (uint8_t i = 0; i < n; ++i) {
+        dropped[i] = queue[(head + i) % EEPROM_ASYNC_QUEUE];
+    }
+
+    head = 0;
+    count = 0;
+    in_flight = 0;
+    xfer_done = 0;
+    in_cycle = bypassed;
+    cycle_start_ms = HAL_GetTick();
+    halted = 0;
+
+    // the owners learn the requests are gone, and may queue them again
+    for (uint8_t i = 0; i < n; ++i) {
+        if (dropped[i].cb) {
+            dropped[i].cb(dropped[i].ctx, 1);
+        }
+    }
+}
+
+void eeprom_async_halt(void)
+{
+    halted = 1;
+}
+
+int eeprom_async_write(uint16_t addr, const uint8_t* d, uint16_t s,
+    eeprom_async_cb cb, void* ctx)
+{
+    // the engine never writes through it
+    return _enqueue(REQ_WRITE, addr, (uint8_t*)d, s, cb, ctx);
+}
+
+int eeprom_async_read(uint16_t addr, uint8_t* d, uint16_t s,
+    eeprom_async_cb cb, void* ctx)
+{
+    return _enqueue(REQ_READ, addr, d, s, cb, ctx);
+}
+
+void eeprom_async_xfer_done(uint8_t ok)
+{
+    xfer_ok = ok;
+    xfer_done = 1;
+}
+
+void eeprom_async_poll(void)
+{
+    if (halted) {
+        return;
+    }
+
+    if (in_flight) {
+        if (!xfer_done) {
+            return;
+        }
+        in_flight = 0;
+
+        struct request* r = &queue[head];
+        if (!xfer_ok) {
+            _finish(1);
+            return;
+        }
+        if (r->type == REQ_WRITE) {
+            in_cycle = 1;
+            cycle_start_ms = HAL_GetTick();
+        }
+        r->done += in_flight_s;
+        if (r->done == r->s) {
+            _finish(0);
+        }
+    }
+
+    if (in_cycle) {
+        // ACK polling, one probe per main loop pass
+        if (!eeprom_port_ready()) {
+            if (HAL_GetTick() - cycle_start_ms <= EEPROM_ASYNC_CYCLE_MS) {
+                return;
+            }
+            // still NACKing, let the next transfer fail or succeed
+        }
+        in_cycle = 0;
+    }
+
+    if (count) {
+        _start();
+    }
+}
+
+uint8_t eeprom_async_idle(void)
+{
+    return count == 0 && !in_flight && !in_cycle;
+}
\ No newline at end of file
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#include "eeprom_async.h"
+
+// 24LC256 with A2..A0 tied low
+#define EEPROM_DEV_ADDR 0xa0
+// address probes covering the 5 ms write cycle, ~100 us each; counted
+// rather than timed, SysTick may not advance in the PVD interrupt
+#define EEPROM_TWC_PROBES 60
+
+extern I2C_HandleTypeDef hi2c1;
+
+HAL_StatusTypeDef eeprom_port_write(uint16_t addr, const uint8_t* d,
+    uint16_t s)
+{
+    return HAL_I2C_Mem_Write_IT(&hi2c1, EEPROM_DEV_ADDR, addr,
+        I2C_MEMADD_SIZE_16BIT, (uint8_t*)d, s);
+}
+
+HAL_StatusTypeDef eeprom_port_read(uint16_t addr, uint8_t* d, uint16_t s)
+{
+    return HAL_I2C_Mem_Read_IT(&hi2c1, EEPROM_DEV_ADDR, addr,
+        I2C_MEMADD_SIZE_16BIT, d, s);
+}
+
+uint8_t eeprom_port_ready(void)
+{
+    // a single address probe, ~100 us at 100 kHz
+    return HAL_I2C_IsDeviceReady(&hi2c1, EEPROM_DEV_ADDR, 1, 1) == HAL_OK;
+}
+
+HAL_StatusTypeDef eeprom_port_write_now(uint16_t addr, const uint8_t* d,
+    uint16_t s)
+{
+    if (HAL_I2C_GetState(&hi2c1) != HAL_I2C_STATE_READY) {
+        // the queued transfer gets torn, its record fails the CRC
+        HAL_I2C_DeInit(&hi2c1);
+        HAL_I2C_Init(&hi2c1);
+    }
+
+    // the page before may still be in its write cycle
+    if (HAL_I2C_IsDeviceReady(&hi2c1, EEPROM_DEV_ADDR, EEPROM_TWC_PROBES, 1)
+        != HAL_OK) {
+        return HAL_ERROR;
+    }
+    return HAL_I2C_Mem_Write(&hi2c1, EEPROM_DEV_ADDR, addr,
+        I2C_MEMADD_SIZE_16BIT, (uint8_t*)d, s, 10);
+}
+
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef* hi2c)
+{
+    if (hi2c == &hi2c1) {
+        eeprom_async_xfer_done(1);
+    }
+}
+
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef* hi2c)
+{
+    if (hi2c == &hi2c1) {
+        eeprom_async_xfer_done(1);
+    }
+}
+
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef* hi2c)
+{
+    if (hi2c == &hi2c1) {
+        eeprom_async_xfer_done(0);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#include "energy.h"
+
+// twice the area in mW * ms, i.e. in 1/2000 mWs
+static void _acc_add(struct energy_acc* acc, uint64_t area2)
+{
+    area2 += acc->rem;
+    acc->mWs += area2 / 2000;
+    acc->rem = area2 % 2000;
+}
+
+// twice the area between two power samples of the same sign, halving
+// is left to _acc_add() so no rounding happens here
+static inline uint64_t _trapezoid(int32_t p1, int32_t p2, uint32_t dt_ms)
+{
+    int64_t area2 = ((int64_t)p1 + p2) * dt_ms;
+    return (area2 < 0) ? -area2 : area2;
+}
+
+void energy_init(struct energy* e)
+{
+    e->consumed.mWs = 0;
+    e->consumed.rem = 0;
+    e->recovered.mWs = 0;
+    e->recovered.rem = 0;
+    e->prev_mw = 0;
+    e->has_prev = 0;
+    e->gap_ms = 0;
+}
+
+void energy_sample(struct energy* e, uint16_t batt_dv, int16_t amper_da,
+    uint32_t dt_ms)
+{
+    // 0.1 V * 0.1 A == 10 mW
+    int32_t p = (int32_t)batt_dv * amper_da * 10;
+    int32_t p1 = e->prev_mw;
+
+    e->prev_mw = p;
+
+    if (!e->has_prev || dt_ms > ENERGY_MAX_GAP_MS) {
+        if (e->has_prev) {
+            e->gap_ms += dt_ms;
+        }
+        e->has_prev = 1;
+        return;
+    }
+
+    if ((p1 >= 0) == (p >= 0)) {
+        _acc_add((p >= 0) ? &e->consumed : &e->recovered,
+            _trapezoid(p1, p, dt_ms));
+        return;
+    }
+
+    // the current changed direction, split at the zero crossing
+    uint32_t t0 = (uint32_t)((int64_t)p1 * dt_ms / ((int64_t)p1 - p));
+    struct energy_acc* first = (p1 >= 0) ? &e->consumed : &e->recovered;
+    struct energy_acc* second = (p1 >= 0) ? &e->recovered : &e->consumed;
+
+    _acc_add(first, _trapezoid(p1, 0, t0));
+    _acc_add(second, _trapezoid(0, p, dt_ms - t0));
+}
+
+void energy_break(struct energy* e)
+{
+    e->has_prev = 0;
+}
+
+uint64_t energy_consumed_mWs(const struct energy* e)
+{
+    return e->consumed.mWs;
+}
+
+uint64_t energy_recovered_mWs(const struct energy* e)
+{
+    return e->recovered.mWs;
+}
+
+void energy_add_recovered(struct energy* e, uint64_t mWs)
+{
+    e->recovered.mWs += mWs;
+}
+
+uint32_t energy_to_dWh(uint64_t mWs)
+{
+    return (uint32_t)((mWs + ENERGY_MWS_P_DWH / 2) / ENERGY_MWS_P_DWH);
+}
+
+uint16_t energy_dWh_km(int64_t mWs, uint32_t m)
+{
+    if (mWs <= 0 || m == 0) {
+        return 0;
+    }
+
+    // 0.1 Wh/km == ENERGY_MWS_P_DWH mWs per 1000 m
+    uint64_t num = (uint64_t)mWs * 1000;
+    uint64_t den = (uint64_t)ENERGY_MWS_P_DWH * m;
+    uint64_t dWh_km = (num + den / 2) / den;
+
+    return (dWh_km > UINT16_MAX) ? UINT16_MAX : dWh_km;
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#include "export.h"
+#include "crc.h"
+
+#include <string.h>
+
+static uint8_t frame[EXPORT_MAX_FRAME];
+
+int export_frame(uint8_t type, uint16_t idx, const uint8_t* d, uint8_t len)
+{
+    if (export_port_busy() || len > EXPORT_MAX_PAYLOAD) {
+        return 1;
+    }
+
+    frame[0] = EXPORT_SYNC_1;
+    frame[1] = EXPORT_SYNC_2;
+    frame[2] = type;
+    frame[3] = idx & 0xff;
+    frame[4] = idx >> 8;
+    frame[5] = len;
+    memcpy(frame + EXPORT_HEADER, d, len);
+
+    uint16_t crc = crc16(CRC16_INIT, frame + 2, EXPORT_HEADER - 2 + len);
+    frame[EXPORT_HEADER + len] = crc & 0xff;
+    frame[EXPORT_HEADER + len + 1] = crc >> 8;
+
+    if (export_port_send(frame, EXPORT_HEADER + len + 2) != HAL_OK) {
+        return 1;
+    }
+    return 0;
+}
+
+uint8_t export_busy(void)
+{
+    return export_port_busy();
+}
\ No newline at end of file
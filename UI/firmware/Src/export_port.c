@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#include "export.h"
+
+extern UART_HandleTypeDef huart1;
+
+HAL_StatusTypeDef export_port_send(const uint8_t* d, uint16_t s)
+{
+    // the log output (blocking) gets HAL_BUSY meanwhile and is dropped
+    return HAL_UART_Transmit_IT(&huart1, (uint8_t*)d, s);
+}
+
+uint8_t export_port_busy(void)
+{
+    return huart1.gState != HAL_UART_STATE_READY;
+}
+
+uint8_t export_port_getc(uint8_t* c)
+{
+    // polled, the RX interrupt stays off
+    if (__HAL_UART_GET_FLAG(&huart1, UART_FLAG_RXNE)) {
+        *c = (uint8_t)(huart1.Instance->DR & 0xff);
+        return 1;
+    }
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,242 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#include "faultlog.h"
+#include "crc.h"
+
+#include <string.h>
+
+#define PAGES   (FAULTLOG_SLOTS * FAULTLOG_RECORD / EEPROM_ASYNC_PAGE)
+#define PER_PAGE    (EEPROM_ASYNC_PAGE / FAULTLOG_RECORD)
+
+static void _put_u16(uint8_t* b, uint16_t v)
+{
+    b[0] = v & 0xff;
+    b[1] = v >> 8;
+}
+
+static void _put_u32(uint8_t* b, uint32_t v)
+{
+    _put_u16(b, v & 0xffff);
+    _put_u16(b + 2, v >> 16);
+}
+
+static uint16_t _get_u16(const uint8_t* b)
+{
+    return b[0] | (uint16_t)b[1] << 8;
+}
+
+static uint32_t _get_u32(const uint8_t* b)
+{
+    return _get_u16(b) | (uint32_t)_get_u16(b + 2) << 16;
+}
+
+void faultlog_init(struct faultlog* fl, uint16_t base)
+{
+    memset(fl, 0, sizeof(struct faultlog));
+    fl->base = base;
+}
+
+// a record of the scanned page, valid and in the slot it belongs to
+static void _scan_record(struct faultlog* fl, const uint8_t* r,
+    uint8_t slot)
+{
+    if (crc16(CRC16_INIT, r, FAULTLOG_RECORD - 2)
+        != _get_u16(r + FAULTLOG_RECORD - 2)) {
+        return;
+    }
+
+    uint32_t seq = _get_u32(r);
+    uint8_t bit = r[4];
+    if (seq % FAULTLOG_SLOTS != slot || bit >= FAULT_BITS) {
+        return;
+    }
+
+    if (seq + 1 > fl->next_seq) {
+        fl->next_seq = seq + 1;
+    }
+
+    struct faultlog_stat* st = &fl->stat[bit];
+    uint16_t count = _get_u16(r + 6);
+    if (r[5] && count >= st->count) {
+        st->count = count;
+        st->last_hm = _get_u32(r + 8);
+    }
+    if (seq + 1 > fl->newest[bit]) {
+        // the state the bit was left in
+        fl->newest[bit] = seq + 1;
+        if (r[5]) {
+            fl->active |= 1 << bit;
+        } else {
+            fl->active &= ~(1 << bit);
+        }
+    }
+}
+
+static void _scanned(void* ctx, int err)
+{
+    struct faultlog* fl = (struct faultlog*)ctx;
+
+    fl->scanning = 0;
+    // a failed read is retried
+    if (err) {
+        return;
+    }
+
+    for (uint8_t i = 0; i < PER_PAGE; ++i) {
+        _scan_record(fl, fl->scan_buf + i * FAULTLOG_RECORD,
+            fl->scan_page * PER_PAGE + i);
+    }
+    if (++fl->scan_page == PAGES) {
+        fl->opened = 1;
+    }
+}
+
+static void _scan(struct faultlog* fl)
+{
+    if (!fl->scanning && !eeprom_async_read(
+            fl->base + fl->scan_page * EEPROM_ASYNC_PAGE, fl->scan_buf,
+            EEPROM_ASYNC_PAGE, _scanned, fl)) {
+        fl->scanning = 1;
+    }
+}
+
+int faultlog_open(struct faultlog* fl)
+{
+    faultlog_init(fl, fl->base);
+    _scan(fl);
+    return !fl->scanning;
+}
+
+static void _event(struct faultlog* fl, uint8_t bit, uint8_t onset,
+    uint32_t odo_hm, uint32_t uptime_s)
+{
+    struct faultlog_stat* st = &fl->stat[bit];
+
+    if (onset) {
+        ++st->count;
+        st->last_hm = odo_hm;
+    }
+    ++fl->events;
+
+    // a bus that long gone loses the newest ones
+    if (fl->npending == FAULTLOG_PENDING) {
+        ++fl->lost;
+        return;
+    }
+
+    uint8_t* r = fl->pending[fl->npending++];
+    _put_u32(r, fl->next_seq++);
+    r[4] = bit;
+    r[5] = onset;
+    _put_u16(r + 6, st->count);
+    _put_u32(r + 8, odo_hm);
+    _put_u16(r + 12, uptime_s > UINT16_MAX ? UINT16_MAX : uptime_s);
+    _put_u16(r + 14, crc16(CRC16_INIT, r, FAULTLOG_RECORD - 2));
+}
+
+void faultlog_update(struct faultlog* fl, uint16_t bits, uint16_t mask,
+    uint32_t odo_hm, uint32_t uptime_s)
+{
+    if (!fl->opened) {
+        return;
+    }
+
+    for (uint8_t bit = 0; bit < FAULT_BITS; ++bit) {
+        if (!((mask >> bit) & 1)) {
+            continue;
+        }
+        uint8_t level = (bits >> bit) & 1;
+        if (level == faultlog_active(fl, bit)) {
+            fl->deb[bit] = 0;
+            continue;
+        }
+        if (++fl->deb[bit] < FAULTLOG_DEBOUNCE) {
+            continue;
+        }
+        fl->deb[bit] = 0;
+        fl->active ^= 1 << bit;
+        _event(fl, bit, level, odo_hm, uptime_s);
+    }
+}
+
+static void _written(void* ctx, int err)
+{
+    struct faultlog* fl = (struct faultlog*)ctx;
+
+    if (err) {
+        fl->lost += fl->writing;
+    } else {
+        ++fl->writes;
+    }
+    fl->writing = 0;
+}
+
+void faultlog_poll(struct faultlog* fl, uint32_t now_ms)
+{
+    if (!fl->opened) {
+        if (fl->scan_page < PAGES) {
+            _scan(fl);
+        }
+        return;
+    }
+
+    if (fl->npending == 0) {
+        fl->holding = 0;
+        fl->flush = 0;
+        return;
+    }
+    if (!fl->holding) {
+        fl->holding = 1;
+        fl->pending_ms = now_ms;
+    }
+    if (fl->writing || (fl->npending < FAULTLOG_BATCH && !fl->flush
+            && now_ms - fl->pending_ms < FAULTLOG_HOLD_MS)) {
+        return;
+    }
+
+    // within one write page of the ring
+    uint8_t slot = _get_u32(fl->pending[0]) % FAULTLOG_SLOTS;
+    uint8_t n = PER_PAGE - slot % PER_PAGE;
+    if (n > fl->npending) {
+        n = fl->npending;
+    }
+
+    memcpy(fl->wbuf, fl->pending, n * FAULTLOG_RECORD);
+    if (eeprom_async_write(fl->base + slot * FAULTLOG_RECORD, fl->wbuf,
+            n * FAULTLOG_RECORD, _written, fl)) {
+        return;
+    }
+    fl->writing = n;
+    fl->npending -= n;
+    memmove(fl->pending, fl->pending[n], fl->npending * FAULTLOG_RECORD);
+    // what is left waits for a batch of its own
+    fl->holding = 0;
+}
+
+void faultlog_flush(struct faultlog* fl)
+{
+    fl->flush = 1;
+}
\ No newline at end of file
@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#include "fmt.h"
+
+static const uint32_t pow10_tab[] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000
+};
+
+uint32_t fmt_div_round(uint32_t n, uint32_t d)
+{
+    uint32_t q = n / d;
+    uint32_t r = n - q * d;
+
+    // half to even
+    if (r > d - r || (r == d - r && (q & 1))) {
+        ++q;
+    }
+
+    return q;
+}
+
+static uint32_t _scale(uint32_t v, uint8_t dp, uint8_t prec)
+{
+    if (prec >= dp) {
+        return v * pow10_tab[prec - dp];
+    }
+
+    return fmt_div_round(v, pow10_tab[dp - prec]);
+}
+
+uint32_t fmt_trunc(uint32_t v, uint8_t dp, uint8_t prec)
+{
+    if (prec >= dp) {
+        return v;
+    }
+
+    uint32_t d = pow10_tab[dp - prec];
+    return v / d * d;
+}
+
+uint8_t fmt_uint(char* dst, uint32_t v)
+{
+    char tmp[10];
+    uint8_t n = 0;
+
+    do {
+        tmp[n++] = '0' + v % 10;
+        v /= 10;
+    } while (v);
+
+    for (uint8_t i = 0; i < n; ++i) {
+        dst[i] = tmp[n - 1 - i];
+    }
+
+    return n;
+}
+
+uint8_t fmt_int(char* dst, int32_t v)
+{
+    if (v < 0) {
+        dst[0] = '-';
+        return 1 + fmt_uint(dst + 1, -(uint32_t)v);
+    }
+
+    return fmt_uint(dst, v);
+}
+
+uint8_t fmt_str(char* dst, const char* s)
+{
+    uint8_t n = 0;
+
+    while (s[n]) {
+        dst[n] = s[n];
+        ++n;
+    }
+
+    return n;
+}
+
+uint8_t fmt_fixed(char* dst, uint32_t v, uint8_t dp, uint8_t prec)
+{
+    uint32_t s = _scale(v, dp, prec);
+    uint8_t n = fmt_uint(dst, s / pow10_tab[prec]);
+
+    if (prec) {
+        uint32_t frac = s % pow10_tab[prec];
+
+        dst[n++] = '.';
+        for (uint8_t i = prec; i > 0; --i) {
+            dst[n++] = '0' + (frac / pow10_tab[i - 1]) % 10;
+        }
+    }
+
+    return n;
+}
+
+void fmt_uint_r(char* line, int last, uint32_t v)
+{
+    do {
+        line[last--] = '0' + v % 10;
+        v /= 10;
+    } while (v && last >= 0);
+}
+
+void fmt_fixed_r(char* line, int last, uint32_t v, uint8_t dp, uint8_t prec)
+{
+    uint32_t s = _scale(v, dp, prec);
+
+    for (uint8_t i = 0; i < prec; ++i) {
+        line[last--] = '0' + s % 10;
+        s /= 10;
+    }
+
+    if (prec) {
+        line[last--] = '.';
+    }
+
+    fmt_uint_r(line, last, s);
+}
+
+void fmt_unit(char* line, int unit_col, uint32_t v, uint8_t dp, char unit)
+{
+    uint32_t one = pow10_tab[dp];
+
+    line[unit_col] = unit;
+
+    if (v * 10 < one) {
+        line[unit_col - 1] = '0';
+        return;
+    }
+
+    if (_scale(v, dp, 1) < 1000) {
+        // "8.4", "84.0"
+        fmt_fixed_r(line, unit_col - 1, v, dp, 1);
+        return;
+    }
+
+    uint32_t units = fmt_div_round(v, one);
+
+    if (units < 1000) {
+        // "840"
+        fmt_uint_r(line, unit_col - 1, units);
+        return;
+    }
+
+    line[unit_col - 1] = 'k';
+
+    uint32_t k10 = fmt_div_round(v, one * 100);
+    if (k10 < 100) {
+        // "8.4k"
+        fmt_fixed_r(line, unit_col - 2, k10, 1, 1);
+    } else {
+        // "67k"
+        fmt_uint_r(line, unit_col - 2, fmt_div_round(v, one * 1000));
+    }
+}
+
+void fmt_unit_int(char* line, int unit_col, uint32_t v, char unit)
+{
+    line[unit_col] = unit;
+    fmt_uint_r(line, unit_col - 1, v);
+}
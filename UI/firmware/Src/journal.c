@@ -0,0 +1,411 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#include "journal.h"
+#include "crc.h"
+
+#include <string.h>
+
+static uint16_t _slot_addr(const struct journal* j, uint8_t slot)
+{
+    return j->base + (uint16_t)slot * JOURNAL_SLOT;
+}
+
+static void _put32(uint8_t* p, uint32_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+static uint32_t _get32(const uint8_t* p)
+{
+    return p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16)
+        | ((uint32_t)p[3] << 24);
+}
+
+// a read of the ring failed since journal_open() started
+static uint8_t read_failed;
+
+// reads the record of `slot`, 1 == valid
+static int _load(const struct journal* j, uint8_t slot, uint8_t* rec,
+    uint32_t* seq)
+{
+    uint16_t addr = _slot_addr(j, slot);
+    uint8_t type, len;
+    uint16_t crc;
+
+    if (j->read(addr, rec, JOURNAL_HEADER) != HAL_OK) {
+        read_failed = 1;
+        return 0;
+    }
+    type = rec[4];
+    len = rec[5];
+    if ((type != JOURNAL_FULL && type != JOURNAL_DELTA)
+        || len > JOURNAL_MAX_PAYLOAD) {
+        // erased or garbage, no point reading the rest
+        return 0;
+    }
+    if (j->read(addr + JOURNAL_HEADER, rec + JOURNAL_HEADER, len + 2)
+        != HAL_OK) {
+        read_failed = 1;
+        return 0;
+    }
+
+    crc = crc16(CRC16_INIT, rec, JOURNAL_HEADER + len);
+    if (rec[JOURNAL_HEADER + len] != (crc & 0xff)
+        || rec[JOURNAL_HEADER + len + 1] != (crc >> 8)) {
+        return 0;
+    }
+
+    *seq = _get32(rec);
+    return (*seq % j->slots) == slot;
+}
+
+// applies a record payload onto the image, 1 == well formed
+static int _apply(struct journal* j, const uint8_t* rec)
+{
+    const uint8_t* p = rec + JOURNAL_HEADER;
+    uint8_t len = rec[5];
+
+    if (rec[4] == JOURNAL_FULL) {
+        if (len != j->image_size) {
+            return 0;
+        }
+        memcpy(j->image, p, len);
+        return 1;
+    }
+
+    while (len >= 2) {
+        uint8_t off = p[0];
+        uint8_t run = p[1];
+        if (run == 0 || run > len - 2 || off + run > j->image_size) {
+            return 0;
+        }
+        memcpy(j->image + off, p + 2, run);
+        p += 2 + run;
+        len -= 2 + run;
+    }
+    return len == 0;
+}
+
+// changed runs of `img` against the stored image, -1 when a delta
+// would not be smaller than the image itself
+static int _delta(const struct journal* j, const uint8_t* img, uint8_t* out)
+{
+    int n = 0;
+    uint8_t i = 0;
+
+    while (i < j->image_size) {
+        if (j->image[i] == img[i]) {
+            ++i;
+            continue;
+        }
+
+        uint8_t start = i;
+        uint8_t end = i + 1;
+        for (uint8_t k = end; k < j->image_size
+            && k - end <= JOURNAL_RUN_GAP; ++k) {
+            if (j->image[k] != img[k]) {
+                end = k + 1;
+            }
+        }
+
+        uint8_t run = end - start;
+        if (n + 2 + run >= j->image_size) {
+            return -1;
+        }
+        out[n++] = start;
+        out[n++] = run;
+        memcpy(out + n, img + start, run);
+        n += run;
+        i = end;
+    }
+    return n;
+}
+
+// the driver may not wrap writes at the EEPROM page boundary itself
+static HAL_StatusTypeDef _write(const struct journal* j, uint16_t addr,
+    const uint8_t* d, uint16_t s)
+{
+    while (s) {
+        uint16_t chunk = JOURNAL_HW_PAGE - addr % JOURNAL_HW_PAGE;
+        if (chunk > s) {
+            chunk = s;
+        }
+        HAL_StatusTypeDef ret = j->write(addr, d, chunk);
+        if (ret != HAL_OK) {
+            return ret;
+        }
+        addr += chunk;
+        d += chunk;
+        s -= chunk;
+    }
+    return HAL_OK;
+}
+
+void journal_init(struct journal* j, uint16_t base, uint8_t slots,
+    uint8_t image_size, journal_read_fn read, journal_write_fn write)
+{
+    memset(j, 0, sizeof(struct journal));
+    j->base = base;
+    j->slots = slots;
+    j->image_size = image_size;
+    j->read = read;
+    j->write = write;
+}
+
+static int _open(struct journal* j, void* image)
+{
+    uint8_t rec[JOURNAL_SLOT];
+    uint32_t seq0, seq, newest_seq;
+    uint8_t newest, slot;
+
+    j->next_seq = 0;
+    j->since_full = 0;
+    j->has_image = 0;
+
+    // the first seq of the newest round; slot 0 may be the gap of a
+    // sealed record, then slot 1 tells
+    uint8_t have = 0;
+    if (_load(j, 0, rec, &seq)) {
+        seq0 = seq;
+        have = 1;
+    }
+    if (_load(j, 1, rec, &seq) && (!have || seq - 1 > seq0)) {
+        seq0 = seq - 1;
+        have = 1;
+    }
+    if (!have) {
+        return 1;
+    }
+
+    // the last slot holding a record of that round, over at most
+    // single slot gaps
+    uint8_t lo = 0;
+    uint8_t hi = j->slots - 1;
+    while (lo < hi) {
+        uint8_t mid = (lo + hi + 1) / 2;
+        if ((_load(j, mid, rec, &seq) && seq >= seq0)
+            || (mid < hi && _load(j, mid + 1, rec, &seq) && seq >= seq0)) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    newest = lo;
+
+    _load(j, newest, rec, &newest_seq);
+    j->next_seq = newest_seq + 1;
+
+    // back to the FULL record the image starts from
+    seq = newest_seq;
+    slot = newest;
+    for (;;) {
+        uint32_t s;
+        if (!_load(j, slot, rec, &s) || s != seq) {
+            return 1;
+        }
+        if (rec[4] == JOURNAL_FULL) {
+            break;
+        }
+        if (seq == 0 || newest_seq - seq + 1 >= JOURNAL_FULL_EVERY) {
+            return 1;
+        }
+        --seq;
+        slot = slot ? slot - 1 : j->slots - 1;
+    }
+
+    // and forward again, applying the deltas
+    for (;;) {
+        uint32_t s;
+        if (!_load(j, slot, rec, &s) || !_apply(j, rec)) {
+            return 1;
+        }
+        if (s == newest_seq) {
+            break;
+        }
+        slot = (slot + 1 == j->slots) ? 0 : slot + 1;
+    }
+
+    j->since_full = newest_seq - seq;
+    j->has_image = 1;
+    memcpy(image, j->image, j->image_size);
+    return 0;
+}
+
+int journal_open(struct journal* j, void* image)
+{
+    read_failed = 0;
+    int ret = _open(j, image);
+
+    // a slot missed for the bus may have been the newest one
+    return read_failed ? 2 : ret;
+}
+
+// header and CRC around the payload already in `rec`, returns the size
+static uint8_t _seal(uint8_t* rec, uint32_t seq, uint8_t type, uint8_t len)
+{
+    uint16_t crc;
+
+    _put32(rec, seq);
+    rec[4] = type;
+    rec[5] = len;
+    crc = crc16(CRC16_INIT, rec, JOURNAL_HEADER + len);
+    rec[JOURNAL_HEADER + len] = crc & 0xff;
+    rec[JOURNAL_HEADER + len + 1] = crc >> 8;
+    return JOURNAL_HEADER + len + 2;
+}
+
+// builds the record of `img` into `rec`, returns its size, 0 == unchanged
+static uint8_t _prepare(const struct journal* j, const uint8_t* img,
+    uint8_t* rec)
+{
+    int len = -1;
+
+    if (j->has_image) {
+        if (memcmp(j->image, img, j->image_size) == 0) {
+            return 0;
+        }
+        if (j->since_full + 1 < JOURNAL_FULL_EVERY) {
+            len = _delta(j, img, rec + JOURNAL_HEADER);
+        }
+    }
+
+    if (len < 0) {
+        memcpy(rec + JOURNAL_HEADER, img, j->image_size);
+        return _seal(rec, j->next_seq, JOURNAL_FULL, j->image_size);
+    }
+    return _seal(rec, j->next_seq, JOURNAL_DELTA, len);
+}
+
+// the record is on the EEPROM
+static void _commit(struct journal* j, const uint8_t* img, const uint8_t* rec)
+{
+    if (rec[4] == JOURNAL_FULL) {
+        j->since_full = 0;
+        ++j->full_writes;
+    } else {
+        ++j->since_full;
+        ++j->delta_writes;
+    }
+    j->bytes_written += JOURNAL_HEADER + rec[5] + 2;
+    ++j->next_seq;
+    memcpy(j->image, img, j->image_size);
+    j->has_image = 1;
+}
+
+int journal_append(struct journal* j, const void* image)
+{
+    uint8_t rec[JOURNAL_SLOT];
+    uint8_t size;
+
+    if (j->pending) {
+        return 1;
+    }
+
+    size = _prepare(j, (const uint8_t*)image, rec);
+    if (size == 0) {
+        return 0;
+    }
+
+    if (_write(j, _slot_addr(j, j->next_seq % j->slots), rec, size)
+        != HAL_OK) {
+        // the slot is retried with the same seq next time
+        return 1;
+    }
+
+    _commit(j, (const uint8_t*)image, rec);
+    return 0;
+}
+
+static void _append_done(void* ctx, int err)
+{
+    struct journal* j = (struct journal*)ctx;
+
+    j->pending = 0;
+    if (!err) {
+        _commit(j, j->pending_image, j->rec);
+    }
+    if (j->cb) {
+        j->cb(j->cb_ctx, err);
+    }
+}
+
+int journal_append_async(struct journal* j, const void* image,
+    eeprom_async_cb cb, void* ctx)
+{
+    uint8_t size;
+
+    if (j->pending) {
+        return 1;
+    }
+
+    size = _prepare(j, (const uint8_t*)image, j->rec);
+    if (size == 0) {
+        if (cb) {
+            cb(ctx, 0);
+        }
+        return 0;
+    }
+
+    // both stay with the journal until the write is done
+    memcpy(j->pending_image, image, j->image_size);
+    j->cb = cb;
+    j->cb_ctx = ctx;
+    if (eeprom_async_write(_slot_addr(j, j->next_seq % j->slots), j->rec,
+        size, _append_done, j)) {
+        return 1;
+    }
+    j->pending = 1;
+    return 0;
+}
+
+uint32_t journal_slot_writes(const struct journal* j, uint8_t slot)
+{
+    if (j->next_seq <= slot) {
+        return 0;
+    }
+    return (j->next_seq - 1 - slot) / j->slots + 1;
+}
+
+uint32_t journal_max_slot_writes(const struct journal* j)
+{
+    // slot 0 is always the first one of a round
+    return journal_slot_writes(j, 0);
+}
+
+uint8_t journal_seal(const struct journal* j, const void* image,
+    uint8_t* rec, uint16_t* addr)
+{
+    // a pending append keeps its seq, written or not; a slot left
+    // without it is a gap journal_open() steps over
+    uint32_t seq = j->next_seq + j->pending;
+
+    memcpy(rec + JOURNAL_HEADER, image, j->image_size);
+    *addr = _slot_addr(j, seq % j->slots);
+    return _seal(rec, seq, JOURNAL_FULL, j->image_size);
+}
\ No newline at end of file
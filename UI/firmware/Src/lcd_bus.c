@@ -0,0 +1,191 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#include "lcd_bus.h"
+#include "bench.h"
+#include "main.h"
+
+#include <lrr_hd44780.def>
+#include <lrr_usart.h>
+
+#define LCD_DATA_PINS (LCD_D4 | LCD_D5 | LCD_D6 | LCD_D7)
+
+static uint8_t busy_flag = LCD_USE_BUSY_FLAG;
+static uint8_t consecutive_timeouts = 0;
+static struct lcd_bus_stats stats;
+
+static void _data_pins_mode(uint32_t mode)
+{
+    GPIO_InitTypeDef init = {0};
+
+    init.Pin = LCD_DATA_PINS;
+    init.Mode = mode;
+    // an undriven D7 has to read busy
+    init.Pull = mode == GPIO_MODE_INPUT ? GPIO_PULLUP : GPIO_NOPULL;
+    init.Speed = GPIO_SPEED_FREQ_HIGH;
+    HAL_GPIO_Init(LCD_DATA_PORT, &init);
+}
+
+static inline void _enable_pulse(void)
+{
+    HAL_GPIO_WritePin(LCD_CTRL_PORT, LCD_EN, GPIO_PIN_SET);
+    bench_delay_us(1);
+    HAL_GPIO_WritePin(LCD_CTRL_PORT, LCD_EN, GPIO_PIN_RESET);
+    bench_delay_us(1);
+}
+
+static void _write_nibble(uint8_t n)
+{
+    HAL_GPIO_WritePin(LCD_DATA_PORT, LCD_D4, (n & 0x01) ? GPIO_PIN_SET : GPIO_PIN_RESET);
+    HAL_GPIO_WritePin(LCD_DATA_PORT, LCD_D5, (n & 0x02) ? GPIO_PIN_SET : GPIO_PIN_RESET);
+    HAL_GPIO_WritePin(LCD_DATA_PORT, LCD_D6, (n & 0x04) ? GPIO_PIN_SET : GPIO_PIN_RESET);
+    HAL_GPIO_WritePin(LCD_DATA_PORT, LCD_D7, (n & 0x08) ? GPIO_PIN_SET : GPIO_PIN_RESET);
+    _enable_pulse();
+}
+
+static void _write(uint8_t rs, uint8_t v)
+{
+    HAL_GPIO_WritePin(LCD_CTRL_PORT, LCD_RS, rs ? GPIO_PIN_SET : GPIO_PIN_RESET);
+    HAL_GPIO_WritePin(LCD_CTRL_PORT, LCD_RW, GPIO_PIN_RESET);
+    _write_nibble(v >> 4);
+    _write_nibble(v & 0x0F);
+}
+
+static uint8_t _read_busy_flag(void)
+{
+    uint8_t bf;
+
+    HAL_GPIO_WritePin(LCD_CTRL_PORT, LCD_EN, GPIO_PIN_SET);
+    bench_delay_us(1);
+    // high nibble, D7 is the busy flag
+    bf = HAL_GPIO_ReadPin(LCD_DATA_PORT, LCD_D7) == GPIO_PIN_SET;
+    HAL_GPIO_WritePin(LCD_CTRL_PORT, LCD_EN, GPIO_PIN_RESET);
+    bench_delay_us(1);
+    // low nibble (address counter) has to be clocked out as well
+    _enable_pulse();
+
+    return bf;
+}
+
+void lcd_bus_init(void)
+{
+    bench_init();
+    lcd_bus_reset_stats();
+    consecutive_timeouts = 0;
+}
+
+void lcd_bus_use_busy_flag(uint8_t enable)
+{
+    busy_flag = enable;
+    consecutive_timeouts = 0;
+}
+
+uint8_t lcd_bus_busy_flag_used(void)
+{
+    return busy_flag;
+}
+
+uint8_t lcd_bus_wait_ready(uint16_t assumed_us)
+{
+    uint32_t start = bench_cycles();
+    uint32_t limit = bench_us_to_cycles(assumed_us);
+    uint32_t elapsed;
+    uint8_t ready = 0;
+
+    if (busy_flag) {
+        _data_pins_mode(GPIO_MODE_INPUT);
+        HAL_GPIO_WritePin(LCD_CTRL_PORT, LCD_RS, GPIO_PIN_RESET);
+        HAL_GPIO_WritePin(LCD_CTRL_PORT, LCD_RW, GPIO_PIN_SET);
+
+        do {
+            ready = !_read_busy_flag();
+            elapsed = bench_cycles() - start;
+        } while (!ready && elapsed < limit);
+
+        HAL_GPIO_WritePin(LCD_CTRL_PORT, LCD_RW, GPIO_PIN_RESET);
+        _data_pins_mode(GPIO_MODE_OUTPUT_PP);
+
+        if (ready) {
+            consecutive_timeouts = 0;
+        } else {
+            ++stats.timeouts;
+            if (++consecutive_timeouts >= LCD_BUS_MAX_TIMEOUTS) {
+                // the flag never clears, RW line is likely not connected
+                LOG("LCD busy flag timeouts, fixed delays from now on");
+                busy_flag = 0;
+            }
+        }
+    } else {
+        bench_delay_us(assumed_us);
+        elapsed = bench_cycles() - start;
+    }
+
+    uint32_t elapsed_us = bench_cycles_to_us(elapsed);
+
+    ++stats.commands;
+    stats.actual_us += elapsed_us;
+    stats.assumed_us += assumed_us;
+    if (elapsed_us > stats.max_actual_us) {
+        stats.max_actual_us = elapsed_us;
+    }
+
+    return ready;
+}
+
+void lcd_bus_cmd(uint8_t cmd)
+{
+    _write(0, cmd);
+    lcd_bus_wait_ready(
+        (cmd == LCD_CMD_CLEAR || cmd == LCD_CMD_HOME) ? LCD_CLEAR_HOME_US : LCD_CMD_US);
+}
+
+void lcd_bus_data(uint8_t data)
+{
+    _write(1, data);
+    lcd_bus_wait_ready(LCD_DATA_US);
+}
+
+const struct lcd_bus_stats* lcd_bus_get_stats(void)
+{
+    return &stats;
+}
+
+void lcd_bus_reset_stats(void)
+{
+    stats.commands = 0;
+    stats.timeouts = 0;
+    stats.actual_us = 0;
+    stats.assumed_us = 0;
+    stats.max_actual_us = 0;
+}
+
+void lcd_bus_log_stats(void)
+{
+    LOG2("LCD commands: ", stats.commands);
+    LOG2("LCD busy actual us: ", stats.actual_us);
+    LOG2("LCD busy assumed us: ", stats.assumed_us);
+    LOG2("LCD busy max us: ", stats.max_actual_us);
+    LOG2("LCD busy flag timeouts: ", stats.timeouts);
+}
@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#include "lcd_gfx.h"
+#include "lcd_bus.h"
+
+#include <string.h>
+
+// CGRAM codes 0-7 are mirrored at 8-15, the latter do not terminate strings
+#define GFX_CODE_BASE       8
+
+static uint8_t shadow[GFX_GLYPHS][GFX_GLYPH_ROWS];
+static uint8_t valid = 0;
+static uint8_t used = 0;
+static uint8_t prev_used = 0;
+static uint32_t uploads = 0;
+
+static void _upload(uint8_t slot, const uint8_t bitmap[GFX_GLYPH_ROWS])
+{
+    lcd_bus_cmd(LCD_CMD_CGRAM_ADDR | (slot << 3));
+    for (uint8_t i = 0; i < GFX_GLYPH_ROWS; ++i) {
+        lcd_bus_data(bitmap[i]);
+    }
+    // back to DDRAM
+    lcd_bus_cmd(LCD_CMD_DDRAM_ADDR);
+
+    memcpy(shadow[slot], bitmap, GFX_GLYPH_ROWS);
+    valid |= 1 << slot;
+    ++uploads;
+}
+
+static uint8_t _eviction_rank(uint8_t bit)
+{
+    if (!(valid & bit)) {
+        return 0;
+    }
+    // glyphs shown in the last frame are likely to be requested again
+    return (prev_used & bit) ? 2 : 1;
+}
+
+void gfx_init(void)
+{
+    valid = 0;
+    used = 0;
+    prev_used = 0;
+}
+
+void gfx_begin_frame(void)
+{
+    prev_used = used;
+    used = 0;
+}
+
+char gfx_glyph(const uint8_t bitmap[GFX_GLYPH_ROWS])
+{
+    uint8_t slot;
+    uint8_t free_slot = GFX_GLYPHS;
+
+    for (slot = 0; slot < GFX_GLYPHS; ++slot) {
+        uint8_t bit = 1 << slot;
+
+        if ((valid & bit) && memcmp(shadow[slot], bitmap, GFX_GLYPH_ROWS) == 0) {
+            used |= bit;
+            return GFX_CODE_BASE + slot;
+        }
+
+        if (!(used & bit) && (free_slot == GFX_GLYPHS
+            || _eviction_rank(bit) < _eviction_rank(1 << free_slot))) {
+            free_slot = slot;
+        }
+    }
+
+    if (free_slot == GFX_GLYPHS) {
+        return GFX_NO_GLYPH;
+    }
+
+    _upload(free_slot, bitmap);
+    used |= 1 << free_slot;
+
+    return GFX_CODE_BASE + free_slot;
+}
+
+void gfx_bar(char* dst, uint8_t width, uint32_t value, uint32_t full_scale)
+{
+    uint32_t max_px = width * GFX_GLYPH_COLS;
+    uint32_t px = (full_scale == 0) ? 0 : value * max_px / full_scale;
+    uint8_t i = 0;
+
+    if (px > max_px) {
+        px = max_px;
+    }
+
+    for (; i < px / GFX_GLYPH_COLS; ++i) {
+        dst[i] = GFX_FULL_BLOCK;
+    }
+
+    uint8_t partial = px % GFX_GLYPH_COLS;
+    if (partial) {
+        uint8_t bitmap[GFX_GLYPH_ROWS];
+        // leftmost column is the most significant bit
+        uint8_t mask = (0x1F << (GFX_GLYPH_COLS - partial)) & 0x1F;
+
+        memset(bitmap, mask, GFX_GLYPH_ROWS);
+        dst[i++] = gfx_glyph(bitmap);
+    }
+
+    for (; i < width; ++i) {
+        dst[i] = GFX_EMPTY;
+    }
+}
+
+void gfx_spark_push(struct gfx_spark* s, uint16_t v)
+{
+    s->samples[s->head] = v;
+    s->head = (s->head + 1) % GFX_SPARK_LEN;
+    if (s->count < GFX_SPARK_LEN) {
+        ++s->count;
+    }
+}
+
+static char _level_glyph(uint8_t h)
+{
+    uint8_t bitmap[GFX_GLYPH_ROWS];
+
+    if (h == 0) {
+        return GFX_EMPTY;
+    }
+
+    if (h >= GFX_GLYPH_ROWS) {
+        return GFX_FULL_BLOCK;
+    }
+
+    // top rows empty, bottom h rows filled
+    memset(bitmap, 0, GFX_GLYPH_ROWS - h);
+    memset(&bitmap[GFX_GLYPH_ROWS - h], 0x1F, h);
+
+    return gfx_glyph(bitmap);
+}
+
+void gfx_spark(char* dst, uint8_t width, const struct gfx_spark* s)
+{
+    uint8_t n = (s->count < width) ? s->count : width;
+    uint16_t max = 1;
+    uint8_t i;
+
+    // index of the oldest drawn sample
+    uint8_t idx = (s->head + GFX_SPARK_LEN - n) % GFX_SPARK_LEN;
+
+    for (i = 0; i < n; ++i) {
+        uint16_t v = s->samples[(idx + i) % GFX_SPARK_LEN];
+        if (v > max) {
+            max = v;
+        }
+    }
+
+    for (i = 0; i < width - n; ++i) {
+        dst[i] = GFX_EMPTY;
+    }
+
+    for (uint8_t j = 0; j < n; ++j, ++i) {
+        uint16_t v = s->samples[(idx + j) % GFX_SPARK_LEN];
+        uint8_t h = (uint32_t)v * GFX_GLYPH_ROWS / max;
+
+        if (v > 0 && h == 0) {
+            h = 1;
+        }
+
+        dst[i] = _level_glyph(h);
+    }
+}
+
+uint32_t gfx_glyph_uploads(void)
+{
+    return uploads;
+}
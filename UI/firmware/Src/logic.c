@@ -4,6 +4,27 @@
 #include "state.h"
 #include "system.h"
 #include "ui.h"
+#include "lcd_bus.h"
+#include "bench.h"
+#include "speed.h"
+#include "distance.h"
+#include "energy.h"
+#include "rolling.h"
+#include "soc.h"
+#include "rint.h"
+#include "range.h"
+#include "eeprom_async.h"
+#include "resume.h"
+#include "ridelog.h"
+#include "faultlog.h"
+#include "trip.h"
+#include "alarm.h"
+#include "buzzer.h"
+#include "thermal.h"
+#include "rainflow.h"
+#include "profile.h"
+#include "charge.h"
+#include "export.h"
 
 #include <lrr_hd44780.h>
 #include <lrr_usart.h>
@@ -14,6 +35,13 @@
 
 #include <string.h>
 
+// saves the EEPROM queue refused, retried every second
+#define SAVE_RUNTIME        0x01
+#define SAVE_TRIPS_LIVE     0x02
+#define SAVE_TRIP           0x04
+#define SAVE_RINT           0x08
+#define SAVE_RAINFLOW       0x10
+
 extern CAN_HandleTypeDef hcan;
 
 static CAN_FilterTypeDef can_filter;
@@ -21,44 +49,422 @@ static CAN_FilterTypeDef can_filter;
 static struct vehicle_conf vc;
 static struct vehicle_runtime vr;
 static struct vehicle_gauges vg;
+static struct speed_est se;
+static struct distance dist;
+static struct energy en;
+static struct rolling roll;
+static struct soc soc;
+static struct rint rint;
+static struct rint_history rint_hist;
+static uint8_t rint_new_ride = 1;
+static struct range range;
+static uint64_t ride_start_mm = 0;
+static uint16_t ride_dWh_km = 0;
+static uint16_t boot_avg_dWh_km = 0;
+static struct ridelog rlog;
+static struct faultlog flog;
+// the fault on the diagnostics screen, bit + 1
+static uint8_t fault_shown = 0;
+static uint8_t fault_tick = 0;
+static struct trip trips[2];
+static struct trip_archive trip_arch;
+// the energy counters at the last trip frame
+static uint64_t trip_consumed_mWs = 0;
+static uint64_t trip_recovered_mWs = 0;
+static uint32_t trip_frame_ms = 0;
+// the archived trip on the trips screen, 0 == the newest
+static uint8_t trip_browse = 0;
 
 static struct Timer tim30s = { .Period_ms = 30000, .Prev_ms = 0};
-static struct Timer tim10s = { .Period_ms = 10000, .Prev_ms = 0};
 static struct Timer tim1s = { .Period_ms = 1000, .Prev_ms = 0};
 static struct Timer tim05s = { .Period_ms = 500, .Prev_ms = 0};
+static struct Timer tim_ui = { .Period_ms = UI_TICK_MS, .Prev_ms = 0};
 static struct Timer tim20ms = { .Period_ms = 20, .Prev_ms = 0};
 
+// the pulses counted since the boot, the motherboard's restarts included
 static uint32_t total_pulses = 0;
-static uint32_t prev_pulses = 0;
+// the motherboard's counter in the last motion frame
+static uint32_t mb_pulses = 0;
 static uint32_t prev_pulses_timestamp = 0;
+static uint32_t prev_motion_rx_ms = 0;
 
 static uint32_t prev_electric_timestamp = 0;
-static float consumed_Ws = 0.0;
-static float recovered_Ws = 0.0;
+static uint32_t prev_electric_rx_ms = 0;
 
 
 static uint8_t inactivity_watchdog = 0;
 static uint8_t any_movement_detected = 0;
+static uint32_t last_save_ms = 0;
 
 static uint16_t btn_1_watchdog = 0;
 static uint16_t btn_2_watchdog = 0;
 static uint16_t btn_3_watchdog = 0;
-
-static uint8_t beep_cnt = 0;
+// the release ends a hold, not a press
+static uint8_t btn_1_held = 0;
+static uint8_t btn_2_held = 0;
+
+static struct alarm alarms;
+// the alarm screen was dismissed, until a level goes up
+static uint8_t alarm_acked = 0;
+static struct thermal therm;
+static uint32_t therm_step_ms = 0;
+static struct rainflow rflow;
+static struct profile prof;
+// consumed - recovered at the previous electric frame
+static int64_t prof_net_mWs = 0;
+static struct charge chg;
+static uint8_t saves_due = 0;
 
 static uint16_t motherboard_watchdog = 0;
 static uint8_t first_motherboard_el_update = 1;
 
-static inline uint32_t _convert_to_mm(const struct vehicle_conf* vc, 
-    uint32_t pulses)
+static uint32_t first_gauge_ms = UINT32_MAX;
+
+#ifdef UI_BENCH
+static uint32_t ui_bench_cycles_sum = 0;
+static uint32_t ui_bench_updates = 0;
+#endif
+
+static void _update_energy_gauges(uint32_t now_ms)
+{
+    uint64_t consumed = energy_consumed_mWs(&en);
+    uint64_t recovered = energy_recovered_mWs(&en);
+
+    rolling_update(&roll, distance_mm(&dist, DIST_TOTAL),
+        (int64_t)(consumed - recovered), now_ms);
+    vg.dWh_km_1km = rolling_dWh_km(&roll, ROLL_1KM);
+    vg.dWh_km_5km = rolling_dWh_km(&roll, ROLL_5KM);
+    vg.dWh_km_10min = rolling_dWh_km(&roll, ROLL_10MIN);
+    vg.avg_dkmh_10min = rolling_avg_dkmh(&roll);
+
+    vg.consumed_dWh = energy_to_dWh(consumed);
+    vg.brake_dWh = energy_to_dWh(recovered);
+
+    uint32_t ride_m = (distance_mm(&dist, DIST_TOTAL) - ride_start_mm) / 1000;
+    ride_dWh_km = (ride_m >= 1000)
+        ? energy_dWh_km((int64_t)(consumed - recovered), ride_m) : 0;
+
+    vg.dWh_km = (vg.total_m >= 10)
+        ? energy_dWh_km((int64_t)(consumed - recovered), vg.total_m) : 0;
+}
+
+static void _update_range(uint32_t now_ms)
+{
+    uint16_t dWh_km = range_blend(vg.dWh_km_5km, ride_dWh_km,
+        vr.avg_dWh_km);
+
+    range_update(&range, soc_remaining_mWh(&soc), dWh_km, now_ms);
+    vg.range_m = range_m(&range);
+}
+
+static void _trip_runtime(struct trip_runtime* tr, const struct trip* t)
+{
+    uint16_t kmh = t->s.max_dkmh / 10;
+
+    tr->travel_time_s = t->s.moving_s;
+    tr->max_speed_kmh = (kmh > UINT8_MAX) ? UINT8_MAX : kmh;
+    tr->consumed_mah = t->consumed_mah;
+}
+
+// the runtime as it is to be stored, vr keeps the values of the boot
+static void _snapshot_runtime(struct vehicle_runtime* out)
+{
+    *out = vr;
+    out->total.dist_pulses += total_pulses;
+    _trip_runtime(&out->trip1, &trips[0]);
+    _trip_runtime(&out->trip2, &trips[1]);
+    soc_store(&soc, out);
+    if (ride_dWh_km) {
+        // this ride counts once however many stops it has
+        out->avg_dWh_km = boot_avg_dWh_km
+            ? (boot_avg_dWh_km * 7 + ride_dWh_km) / 8 : ride_dWh_km;
+    }
+}
+
+static void _update_distance_gauges(void)
+{
+    vg.total_m = distance_m(&dist, DIST_TOTAL);
+    vg.trip1_m = distance_m(&dist, DIST_TRIP1);
+    vg.trip2_m = distance_m(&dist, DIST_TRIP2);
+}
+
+static void _first_gauge_drawn(void)
+{
+    if (first_gauge_ms == UINT32_MAX) {
+        // the tick counts from HAL_Init(), i.e. from the reset
+        first_gauge_ms = HAL_GetTick();
+        LOG2("First gauge ms: ", first_gauge_ms);
+    }
+}
+
+static int8_t _clamp_i8(int16_t v)
+{
+    return (v < INT8_MIN) ? INT8_MIN : (v > INT8_MAX) ? INT8_MAX : v;
+}
+
+static void _store_resume(void)
+{
+    struct resume rs;
+
+    rs.display_mode = vr.current_display_mode;
+    rs.batt_perc = vg.batt_perc;
+    rs.ambient_temp = _clamp_i8(vg.ambient_temp);
+    rs.batt_dv = vg.batt_dv;
+    rs.total_m = vg.total_m;
+    rs.trip1_m = vg.trip1_m;
+    rs.trip2_m = vg.trip2_m;
+    resume_store(&rs);
+}
+
+static void _log_sample(void)
+{
+    struct ridelog_sample s;
+    uint16_t kmh = (vg.speed_dkmh + 5) / 10;
+
+    s.speed_kmh = (kmh > UINT8_MAX) ? UINT8_MAX : kmh;
+    s.amper_a = (vg.amper_da + ((vg.amper_da < 0) ? -5 : 5)) / 10;
+    s.batt_dv = vg.batt_dv;
+    s.moto_temp = _clamp_i8(vg.moto_temp);
+    s.driver_temp = _clamp_i8(vg.driver_temp);
+    s.batt_temp = _clamp_i8(vg.batt_temp);
+    s.ambient_temp = _clamp_i8(vg.ambient_temp);
+    s.consumed_wh = vg.consumed_dWh / 10;
+    ridelog_sample(&rlog, &s);
+}
+
+// the next fault with onsets, from the one shown on
+static void _update_fault_gauges(void)
+{
+    for (uint8_t i = 0; i < FAULT_BITS; ++i) {
+        uint8_t bit = (fault_shown + i) % FAULT_BITS;
+        const struct faultlog_stat* st = &flog.stat[bit];
+
+        if (st->count) {
+            fault_shown = bit + 1;
+            vg.fault_name = bit + 1;
+            vg.fault_count = st->count;
+            vg.fault_state = faultlog_active(&flog, bit) ? 2 : 1;
+            vg.fault_last_m = st->last_hm * 100;
+            return;
+        }
+    }
+
+    vg.fault_name = 0;
+    vg.fault_count = 0;
+    vg.fault_state = 0;
+    vg.fault_last_m = 0;
+}
+
+static void _update_trips(uint32_t now_ms)
+{
+    uint64_t consumed = energy_consumed_mWs(&en);
+    uint64_t recovered = energy_recovered_mWs(&en);
+    struct trip_frame f;
+
+    f.speed_dkmh = vg.speed_dkmh;
+    f.amper_da = vg.amper_da;
+    f.dt_ms = now_ms - trip_frame_ms;
+    f.consumed_mWs = consumed - trip_consumed_mWs;
+    f.recovered_mWs = recovered - trip_recovered_mWs;
+    f.moto_temp = vg.moto_temp;
+    f.driver_temp = vg.driver_temp;
+    f.batt_temp = vg.batt_temp;
+
+    f.dist_m = vg.trip1_m;
+    trip_update(&trips[0], &f);
+    f.dist_m = vg.trip2_m;
+    trip_update(&trips[1], &f);
+
+    trip_frame_ms = now_ms;
+    trip_consumed_mWs = consumed;
+    trip_recovered_mWs = recovered;
+}
+
+static void _update_trip_gauges(void)
+{
+    const struct trip_summary* s = trip_archive_get(&trip_arch, trip_browse);
+
+    if (s == NULL) {
+        vg.trip_no = 0;
+        vg.trip_dist_m = 0;
+        vg.trip_avg_dkmh = 0;
+        vg.trip_max_dkmh = 0;
+        vg.trip_moving_min = 0;
+        vg.trip_dWh = 0;
+        return;
+    }
+
+    vg.trip_no = trip_browse + 1;
+    vg.trip_dist_m = s->dist_m;
+    vg.trip_avg_dkmh = trip_avg_dkmh(s);
+    vg.trip_max_dkmh = s->max_dkmh;
+    vg.trip_moving_min = (s->moving_s / 60 > UINT16_MAX)
+        ? UINT16_MAX : s->moving_s / 60;
+    vg.trip_dWh = s->consumed_dWh;
+}
+
+static int _save_trips_live(void)
+{
+    struct trip_summary live[2] = { trips[0].s, trips[1].s };
+
+    return save_trip_live_async(live, NULL, NULL);
+}
+
+// the refused saves again, a bit stays until its save is queued
+static void _save_due(void)
+{
+    if (saves_due & SAVE_RUNTIME) {
+        struct vehicle_runtime snap;
+        _snapshot_runtime(&snap);
+        if (!save_vehicle_runtime_async(&snap, NULL, NULL)) {
+            saves_due &= ~SAVE_RUNTIME;
+        }
+    }
+    if ((saves_due & SAVE_TRIPS_LIVE) && !_save_trips_live()) {
+        saves_due &= ~SAVE_TRIPS_LIVE;
+    }
+    if ((saves_due & SAVE_TRIP) && !save_trip_async(&trip_arch, NULL, NULL)) {
+        saves_due &= ~SAVE_TRIP;
+    }
+    if ((saves_due & SAVE_RINT)
+        && !save_rint_history_async(&rint_hist, NULL, NULL)) {
+        saves_due &= ~SAVE_RINT;
+    }
+    if ((saves_due & SAVE_RAINFLOW)
+        && !save_rainflow_async(&rflow, NULL, NULL)) {
+        saves_due &= ~SAVE_RAINFLOW;
+    }
+}
+
+// trip 1 or 2 to the archive, it starts again
+static void _reset_trip(uint8_t i)
 {
-    return pulses * vc->dist_p_rev_mm / vc->pulse_p_rev;
+    trips[i].s.dist_m = (i == 0) ? vg.trip1_m : vg.trip2_m;
+    trip_archive_put(&trip_arch, &trips[i], vg.total_m);
+    saves_due |= SAVE_TRIP | SAVE_TRIPS_LIVE;
+    _save_due();
+    trip_browse = 0;
+    _update_trip_gauges();
+}
+
+static void _browse_trips(int8_t step)
+{
+    if (step < 0 && trip_browse > 0) {
+        --trip_browse;
+    } else if (step > 0 && trip_browse + 1 < trip_arch.count) {
+        ++trip_browse;
+    }
+    _update_trip_gauges();
+}
+
+static void _update_alarm_gauges(int8_t row)
+{
+    if (row < 0) {
+        vg.alarm_name = 0;
+        vg.alarm_level = ALARM_OK;
+        return;
+    }
+
+    vg.alarm_name = row + 1;
+    vg.alarm_level = alarms.rows[row].level;
+    vg.alarm_temp = alarm_temp(&vg, row);
+    vg.alarm_limit = alarm_limit(&vc, row);
+    vg.alarm_slope = alarm_slope_cmin(&alarms, row);
+}
+
+// at every sensor frame
+static void _check_alarms(uint32_t now_ms)
+{
+    uint8_t rose = alarm_update(&alarms, &vg, &vc, now_ms);
+    int8_t worst = alarm_worst(&alarms);
+    uint8_t hot = (worst >= 0 && alarms.rows[worst].level == ALARM_HOT);
+
+    if (rose) {
+        // a new or higher level is shown and heard again
+        alarm_acked = 0;
+        buzzer_play(hot ? BUZ_ALARM : BUZ_WARN);
+    }
+    if (!hot) {
+        buzzer_stop(BUZ_ALARM);
+    }
+
+    _update_alarm_gauges(worst);
+    ui_set_alarm(worst >= 0 && !alarm_acked);
+    faultlog_update(&flog, alarm_faults(&alarms), alarm_fault_mask(),
+        vg.total_m / 100, now_ms / 1000);
 }
 
-static inline uint32_t _convert_to_m(const struct vehicle_conf* vc,
-    uint32_t pulses)
+static void _update_thermal(uint32_t now_ms)
 {
-    return _convert_to_mm(vc, pulses) / 1000;
+    thermal_step(&therm, now_ms - therm_step_ms);
+    therm_step_ms = now_ms;
+
+    vg.moto_wind_temp = thermal_winding_c(&therm);
+    uint16_t s = vc.moto_t_alarm_c
+        ? thermal_time_to(&therm, vc.moto_t_alarm_c) : THERMAL_NEVER;
+    // a minute at least while it is on its way, 0 == never
+    vg.moto_limit_min = (s == THERMAL_NEVER) ? 0
+        : (s / 60 >= 999) ? 999 : s / 60 + 1;
+}
+
+static void _update_cycles(void)
+{
+    rainflow_sample(&rflow, soc_permille(&soc));
+    vg.batt_cycles_dc = soc_cycles_dc(&soc);
+    vg.batt_deep_cycles = rainflow_cycles(&rflow, 600);
+}
+
+static void _update_charge(void)
+{
+    charge_tick(&chg);
+    // what the coulomb count has left to full
+    uint32_t remaining_mah = (uint32_t)vc.cell_cap_mah * vc.batt_p
+        * (1000 - soc_permille(&soc)) / 1000;
+    uint16_t full_dv = (uint32_t)vc.cell_mv_max * vc.batt_s / 100;
+
+    vg.charge_dWh = charge_dWh(&chg);
+    vg.charge_da = charge_current_da(&chg);
+    vg.charge_min = charge_minutes_to_full(&chg, remaining_mah, full_dv);
+    ui_set_charging(chg.state == CHARGE_ON);
+
+    if (chg.closed && !save_charge_async(&chg.last, NULL, NULL)) {
+        chg.closed = 0;
+    }
+}
+
+// a byte on the USART1
+static void _command(uint8_t cmd)
+{
+    switch (cmd) {
+    case EXPORT_RIDE_LOG:
+        if (ridelog_export_start(&rlog)) {
+            LOG("Export running");
+        }
+        break;
+    case EXPORT_TRIPS:
+        if (trip_export_start()) {
+            LOG("Export running");
+        }
+        break;
+    case EXPORT_PROFILE:
+        if (profile_export_start()) {
+            LOG("Export running");
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+static void _resume_gauges(const struct resume* rs)
+{
+    vg.batt_perc = rs->batt_perc;
+    vg.ambient_temp = rs->ambient_temp;
+    vg.batt_dv = rs->batt_dv;
+    vg.total_m = rs->total_m;
+    vg.trip1_m = rs->trip1_m;
+    vg.trip2_m = rs->trip2_m;
+    ui_set_display_mode((enum display_mode)rs->display_mode);
 }
 
 static void _load_config(
@@ -115,14 +521,6 @@ static void _load_config(
             LOG("Loading eeprom vehicle runtime failed!");
             return;
         }
-
-        // initial vehicle gauge init
-        vg.total_m = _convert_to_m(vc, vr->total.dist_pulses);
-        vg.trip1_m = _convert_to_m(vc,
-            vr->total.dist_pulses - vr->trip1.dist_pulses);
-        vg.trip2_m = _convert_to_m(vc,
-            vr->total.dist_pulses - vr->trip2.dist_pulses); 
-
     }
 
     LOG("SUCCESS.");
@@ -130,15 +528,36 @@ static void _load_config(
 
 void logic_init(void)
 {
+    struct resume rs;
+    uint8_t warm;
+
+    first_gauge_ms = UINT32_MAX;
     ui_init();
+    resume_init();
+
+    // holding the mode button at power-up asks for the welcome screens
+    warm = !resume_load(&rs) && !is_btn_pressed_pin_check(BUTTON_3);
 
-    ui_welcome_screen_blk_1();
+    if (warm) {
+        // the last gauges stand until the EEPROM and the CAN catch up
+        _resume_gauges(&rs);
+        ui_update(&vg);
+        _first_gauge_drawn();
+    } else {
+        ui_welcome_screen_blk_1();
+    }
 
     LOG("Logic init...");
 
     _load_config(&vc, &vr);
 
-    ui_welcome_screen_blk_2();
+    if (warm) {
+        // mode changes are not saved, the snapshot is newer
+        vr.current_display_mode = rs.display_mode;
+    } else {
+        ui_welcome_screen_blk_2();
+        ui_set_display_mode((enum display_mode)vr.current_display_mode);
+    }
 
     LOG("Logic done.");
 
@@ -147,6 +566,94 @@ void logic_init(void)
         save_vehicle_conf(&vc);
     }
 
+    if (open_ride_log(&rlog)) {
+        LOG("Ride log empty");
+    }
+
+    if (load_trip_archive(&trip_arch)) {
+        init_trip_archive(&trip_arch);
+    }
+    struct trip_summary live[2];
+    int live_err = load_trip_live(live);
+    for (uint8_t i = 0; i < 2; ++i) {
+        const struct trip_runtime* tr = (i == 0) ? &vr.trip1 : &vr.trip2;
+
+        trip_start(&trips[i], i + 1);
+        if (!live_err) {
+            trip_resume(&trips[i], &live[i], tr->consumed_mah);
+            // the brown-out commit may be newer than the last stop
+            if (tr->travel_time_s > trips[i].s.moving_s) {
+                trips[i].s.moving_s = tr->travel_time_s;
+            }
+        } else {
+            // first boot of the summaries, what the runtime has
+            trips[i].s.moving_s = tr->travel_time_s;
+            trips[i].s.max_dkmh = tr->max_speed_kmh * 10;
+            trips[i].consumed_mah = tr->consumed_mah;
+        }
+    }
+    trip_browse = 0;
+    saves_due = 0;
+
+    if (load_rainflow(&rflow)) {
+        init_rainflow(&rflow);
+    }
+    if (load_profile(&prof)) {
+        profile_init(&prof);
+    }
+    struct charge_session last_charge;
+    // zeroed when there is none
+    load_charge_last(&last_charge);
+    charge_init(&chg, &last_charge);
+
+    // the blocking EEPROM access ends here
+    eeprom_async_init();
+
+    fault_shown = 0;
+    fault_tick = 0;
+    alarm_init(&alarms);
+    alarm_acked = 0;
+    buzzer_init();
+    if (open_fault_log(&flog)) {
+        LOG("Fault log scan not queued");
+    }
+
+    speed_init(&se, &vc);
+
+    energy_init(&en);
+    prof_net_mWs = 0;
+    rolling_init(&roll);
+    soc_init(&soc, &vc);
+    soc_restore(&soc, &vr);
+    vg.batt_perc = soc_percent(&soc);
+
+    rint_init(&rint);
+    rint_new_ride = 1;
+    if (load_rint_history(&rint_hist)) {
+        init_rint_history(&rint_hist);
+    }
+
+    // initial vehicle gauge init
+    total_pulses = 0;
+    mb_pulses = 0;
+    distance_init(&dist, &vc);
+    distance_set(&dist, DIST_TOTAL, vr.total.dist_pulses);
+    distance_set(&dist, DIST_TRIP1,
+        vr.total.dist_pulses - vr.trip1.dist_pulses);
+    distance_set(&dist, DIST_TRIP2,
+        vr.total.dist_pulses - vr.trip2.dist_pulses);
+    _update_distance_gauges();
+
+    trip_consumed_mWs = 0;
+    trip_recovered_mWs = 0;
+    trip_frame_ms = HAL_GetTick();
+    _update_trip_gauges();
+
+    range_init(&range);
+    ride_start_mm = distance_mm(&dist, DIST_TOTAL);
+    ride_dWh_km = 0;
+    boot_avg_dWh_km = vr.avg_dWh_km;
+
     can_filter.FilterMode = CAN_FILTERMODE_IDMASK;
     can_filter.FilterScale = CAN_FILTERSCALE_32BIT;
     can_filter.FilterIdHigh = 0x0000;
@@ -170,6 +677,29 @@ void logic_init(void)
     }
 
     vg.ambient_temp = readTemp();
+    thermal_init(&therm, vg.ambient_temp);
+    therm_step_ms = HAL_GetTick();
+}
+
+// the pulses of a motion frame, bounded by what the wheel can turn
+static uint32_t _motion_delta(uint32_t pulses, uint32_t now_ms)
+{
+    // the counter restarted with the motherboard
+    uint32_t delta = (pulses < mb_pulses) ? pulses : pulses - mb_pulses;
+    uint32_t elapsed_ms = now_ms - prev_motion_rx_ms;
+    uint32_t ppr = vc.pulse_p_rev ? vc.pulse_p_rev : 1;
+    uint32_t mm_p_rev = vc.dist_p_rev_mm ? vc.dist_p_rev_mm : 1;
+    // one revolution of slack for the frames' jitter
+    uint64_t max = (uint64_t)MOTION_MAX_MM_S * elapsed_ms / 1000 * ppr
+        / mm_p_rev + ppr;
+
+    mb_pulses = pulses;
+    prev_motion_rx_ms = now_ms;
+    if (delta > max) {
+        delta = (uint32_t)max;
+    }
+    total_pulses += delta;
+    return delta;
 }
 
 static inline uint32_t timestamp_delta(uint32_t prev, uint32_t curr)
@@ -186,6 +716,21 @@ void logic_update(void)
 {
     uint32_t now_ms = HAL_GetTick();
 
+    if (vehicle_runtime_committed()) {
+        // the supply dipped and came back
+        recover_vehicle_runtime_commit();
+    }
+    eeprom_async_poll();
+    ridelog_poll(&rlog);
+    faultlog_poll(&flog, now_ms);
+    trip_export_poll(&trip_arch);
+    profile_export_poll(&prof);
+
+    uint8_t cmd;
+    if (export_port_getc(&cmd)) {
+        _command(cmd);
+    }
+
     // check if there any messages waiting on CAN bus
     uint8_t data[8];
     CAN_RxHeaderTypeDef can_header;
@@ -205,69 +750,83 @@ void logic_update(void)
             const struct bcp_msg_electric* el 
                 = (const struct bcp_msg_electric*)&data[1];
 
-            vg.batt_v = el->voltage;
-            vg.batt_v /= 10;
-            // calculate percentage
-            int v_max_mv = vc.batt_s * vc.cell_mv_max;
-            int v_low_mv = vc.batt_s * vc.cell_mv_min;
-            float batt_perc = (vg.batt_v * 1000 - v_low_mv) / (v_max_mv - v_low_mv);
-            vg.batt_perc = 100.0 * (batt_perc < 0 ? 0 : batt_perc);
+            vg.batt_dv = el->voltage;
 
             vr.last_batt_mv = el->voltage * 100;
-            vg.amper = convert_from_14bit(el->current);
+            vg.amper_da = convert_from_14bit(el->current);
 
             if (vc.reverse_curr) {
-                vg.amper /= -10;
-            } else {
-                vg.amper /= 10;
+                vg.amper_da = -vg.amper_da;
             }
 
+            vg.power_cw = (int32_t)vg.amper_da * vg.batt_dv;
+
             if (first_motherboard_el_update) {
                 first_motherboard_el_update = 0;
-                // ampere sanity check
-                if (vg.amper > 30.0 || vg.amper < -30.0) {
+                // ampere sanity check, for motherboards without the
+                // fault bits
+                if (vg.amper_da > 300 || vg.amper_da < -300) {
                     // perhaps the sensor is not installed or corrupted
-                    // TODO: the motherboard should report dedicated fault
                     ui_disable_amp_gauges();
                 }
             }
+            if (el->faults & BCP_FAULT_AMP_SENS) {
+                ui_disable_amp_gauges();
+            }
+            faultlog_update(&flog, el->faults, FAULT_MB_MASK,
+                vg.total_m / 100, now_ms / 1000);
 
             uint32_t delta_t_ms = timestamp_delta(prev_electric_timestamp, el->timestamp);
             prev_electric_timestamp = el->timestamp;
-            // update consumedWH and recovered_Ws
-            float Ws = vg.amper * vg.batt_v * delta_t_ms / 1000.0;
 
-            if (vg.amper > 0) {
-                consumed_Ws += Ws;
+            if (now_ms - prev_electric_rx_ms >= MAX_TIMESTAMP) {
+                // the timestamp wrapped around unnoticed
+                energy_break(&en);
+                soc_break(&soc);
+            }
+            prev_electric_rx_ms = now_ms;
+
+            soc_sample(&soc, vg.batt_dv, vg.amper_da, delta_t_ms);
+            vg.batt_perc = soc_percent(&soc);
+            if (charge_sample(&chg, vg.speed_dkmh, vg.batt_dv, vg.amper_da,
+                    delta_t_ms)) {
+                // the charger's, neither regeneration nor the motor
+                energy_break(&en);
             } else {
-                recovered_Ws += Ws;
+                // the frames of a charger start which was none
+                energy_add_recovered(&en, charge_take_returned_mWs(&chg));
+                energy_sample(&en, vg.batt_dv, vg.amper_da, delta_t_ms);
+                int64_t net_mWs = (int64_t)(energy_consumed_mWs(&en)
+                    - energy_recovered_mWs(&en));
+                profile_sample(&prof, vg.speed_dkmh, vg.amper_da,
+                    vg.moto_temp, vg.batt_temp, net_mWs - prof_net_mWs,
+                    delta_t_ms);
+                prof_net_mWs = net_mWs;
+                thermal_current(&therm, vg.amper_da, delta_t_ms);
             }
+
+            rint_sample(&rint, vg.batt_dv, vg.amper_da);
+            vg.rint_mohm = rint_mohm(&rint);
+            vg.batt_ocv_dv = rint_compensate_dv(&rint, vg.batt_dv, vg.amper_da);
+
+            _update_range(now_ms);
             break;
         }
         case BCP_MSG_MOTION:
         {
             const struct bcp_msg_motion* m 
                 = (const struct bcp_msg_motion*)&data[1];
-            total_pulses = m->tot_pulses;
-
-            // convert to distance in mili-meters
-            uint32_t delta_mm = _convert_to_mm(&vc,
-                m->tot_pulses - prev_pulses);
-            
-            // calculate delta t
-            uint32_t delta_t_ms = timestamp_delta(prev_pulses_timestamp, m->timestamp);
-
-            delta_t_ms = (delta_t_ms == 0) ? 1 : delta_t_ms;
-
-            vg.speed_kmh = 36 * delta_mm / (10 * delta_t_ms);
-            vg.total_m = _convert_to_m(&vc, 
-                vr.total.dist_pulses + total_pulses);
-            vg.trip1_m = _convert_to_m(&vc,
-                vr.total.dist_pulses + total_pulses - vr.trip1.dist_pulses);
-            vg.trip2_m = _convert_to_m(&vc,
-                vr.total.dist_pulses + total_pulses - vr.trip2.dist_pulses); 
-
-            prev_pulses = m->tot_pulses;
+            distance_add(&dist, _motion_delta(m->tot_pulses, now_ms));
+            _update_distance_gauges();
+
+            speed_update(&se, total_pulses,
+                timestamp_delta(prev_pulses_timestamp, m->timestamp));
+
+            vg.speed_dkmh = speed_dkmh(&se);
+            vg.speed_conf = speed_confidence(&se);
+
+            _update_range(now_ms);
+
             prev_pulses_timestamp = m->timestamp;
             break;
         }
@@ -278,6 +837,10 @@ void logic_update(void)
             vg.moto_temp = convert_from_9bit(blk->moto_t);
             vg.driver_temp = convert_from_9bit(blk->drv_t);
             vg.batt_temp = convert_from_9bit(blk->batt_t);
+            if (vg.moto_temp >= ALARM_MIN_C) {
+                thermal_measure(&therm, vg.moto_temp);
+            }
+            _check_alarms(now_ms);
             break;
         }
         default:
@@ -314,32 +877,64 @@ void logic_update(void)
 
         if (btn_1_watchdog == 50) {
             // reset trip 1
+            _reset_trip(0);
             vr.trip1.dist_pulses = vr.total.dist_pulses + total_pulses;
+            distance_set(&dist, DIST_TRIP1, 0);
+            btn_1_held = 1;
         }
 
         if (btn_2_watchdog == 50) {
             // reset trip 2
+            _reset_trip(1);
             vr.trip2.dist_pulses = vr.total.dist_pulses + total_pulses;
+            distance_set(&dist, DIST_TRIP2, 0);
+            btn_2_held = 1;
         }
 
-        if (get_n_reset_btn_released(BUTTON_3) && !lock_display_mode) {            
-            // advance display mode
-            ++vr.current_display_mode;
-            if (vr.current_display_mode >= DM_LIMIT) {
-                vr.current_display_mode = 0;
+        // short presses browse the trips screen, older and newer
+        if (get_n_reset_btn_released(BUTTON_1)) {
+            if (!btn_1_held && vr.current_display_mode == DM_TRIPS) {
+                _browse_trips(1);
             }
-            ui_set_display_mode((enum display_mode)vr.current_display_mode);
+            btn_1_held = 0;
+        }
+        if (get_n_reset_btn_released(BUTTON_2)) {
+            if (!btn_2_held && vr.current_display_mode == DM_TRIPS) {
+                _browse_trips(-1);
+            }
+            btn_2_held = 0;
         }
 
-        if (beep_cnt > 0) {
-            --beep_cnt;
-
-            if (beep_cnt == 0) {
-                beep_off();
+        if (get_n_reset_btn_released(BUTTON_3) && !lock_display_mode) {
+            if (vg.alarm_name && !alarm_acked) {
+                // dismisses the alarm screen and silences it
+                alarm_acked = 1;
+                ui_set_alarm(0);
+                buzzer_stop(BUZ_ALARM);
             } else {
-                beep_on();
+                // advance display mode
+                ++vr.current_display_mode;
+                if (vr.current_display_mode >= DM_LIMIT) {
+                    vr.current_display_mode = 0;
+                }
+                ui_set_display_mode((enum display_mode)vr.current_display_mode);
             }
         }
+
+        buzzer_tick();
+    }
+
+    if (__timer_update(&tim_ui, now_ms)) {
+        // every field keeps its own refresh period, see ui.c
+#ifdef UI_BENCH
+        uint32_t start = bench_cycles();
+        ui_update(&vg);
+        ui_bench_cycles_sum += bench_cycles() - start;
+        ++ui_bench_updates;
+#else
+        ui_update(&vg);
+#endif
+        _first_gauge_drawn();
     }
 
     if (__timer_update(&tim05s, now_ms)) {
@@ -348,53 +943,93 @@ void logic_update(void)
         } else {
             vg.motherboard_offline = 0;
         }
-        
-        // update UI
-        ui_update(&vg);
+        faultlog_update(&flog, vg.motherboard_offline << FAULT_OFFLINE,
+            1 << FAULT_OFFLINE, vg.total_m / 100, now_ms / 1000);
 
-        if (vg.speed_kmh != 0) {
+        if (vg.speed_dkmh != 0) {
             inactivity_watchdog = 0;
             any_movement_detected = 1;
         }
+
+        // what the PVD interrupt writes when the supply goes
+        struct vehicle_runtime snap;
+        _snapshot_runtime(&snap);
+        prepare_vehicle_runtime_commit(&snap);
+        // and what a reset resumes from
+        _store_resume();
     }
 
     if (__timer_update(&tim1s, now_ms)) {
+        // the energy fields refresh once a second
+        _update_energy_gauges(now_ms);
+        _update_trips(now_ms);
+        _update_thermal(now_ms);
+        _update_cycles();
+        _update_charge();
+        _log_sample();
+        // a fault every other second
+        fault_tick = !fault_tick;
+        if (fault_tick) {
+            _update_fault_gauges();
+        }
+
         ++motherboard_watchdog;
-        if (vg.speed_kmh == 0) {
+        if (vg.speed_dkmh == 0) {
             ++inactivity_watchdog;
         }
 
-        if (inactivity_watchdog == 1 && any_movement_detected) {
-            // save runtime to EEPROM
+        // the power-off is covered by the brown-out commit, stops only
+        // save now and then in case the supply dies too fast for it
+        if (any_movement_detected && ((inactivity_watchdog == 1
+            && now_ms - last_save_ms >= STOP_SAVE_PERIOD_MS)
+            || inactivity_watchdog == PARKED_SAVE_S)) {
             // LOG("Saving state to eeprom");
-            uint32_t old_dist_pulses = vr.total.dist_pulses;
-            vr.total.dist_pulses += total_pulses;
-            save_vehicle_runtime(&vr);
-            // the trip might get continued so we need to use old value
-            vr.total.dist_pulses = old_dist_pulses;
+            // queued by _save_due(), the CAN keeps being serviced during
+            // the write cycles
+            saves_due |= SAVE_RUNTIME | SAVE_TRIPS_LIVE | SAVE_RAINFLOW;
+            last_save_ms = now_ms;
+            ridelog_flush(&rlog);
+            faultlog_flush(&flog);
+
+            if (rint_valid(&rint)) {
+                // one entry per ride, updated at every stop
+                rint_history_put(&rint_hist, rint_mohm(&rint), rint_new_ride);
+                rint_new_ride = 0;
+                saves_due |= SAVE_RINT;
+            }
+            if (prof.dirty && !save_profile_async(&prof, NULL, NULL)) {
+                prof.dirty = 0;
+            }
             // LOG("conf saved to EEPROM");
         }
+        // a full queue takes them a second later
+        _save_due();
 
         if (any_movement_detected && inactivity_watchdog == 60) {
-            beep_cnt = inactivity_watchdog;
+            buzzer_play(BUZ_REMINDER);
         }
     }
 
-    if (__timer_update(&tim10s, now_ms)) {
-        // update consumed/recovered Wh
-        float traveled_km = vg.total_m / 1000.0;
-
-        if (traveled_km > 0.01) {
-            vg.consumed_Wh += (consumed_Ws / 3600.0);
-            vg.brake_Wh += (recovered_Ws / 3600.0);
-            vg.Wh_km = (vg.consumed_Wh - vg.brake_Wh) / traveled_km;
+    if (__timer_update(&tim30s, now_ms)) {
+        vg.ambient_temp = readTemp();
+        thermal_ambient(&therm, vg.ambient_temp);
 
-            consumed_Ws = 0;
-            recovered_Ws = 0;
+#ifdef UI_BENCH
+        if (ui_bench_updates) {
+            LOG2("ui_update avg cycles: ", ui_bench_cycles_sum / ui_bench_updates);
         }
+        ui_bench_cycles_sum = 0;
+        ui_bench_updates = 0;
+#endif
+
+#ifdef LCD_BUS_MEASURE
+        lcd_bus_log_stats();
+        lcd_bus_reset_stats();
+#endif
     }
+}
 
-    if (__timer_update(&tim30s, now_ms)) {
-        vg.ambient_temp = readTemp();        
-    }
+uint32_t logic_first_gauge_ms(void)
+{
+    return first_gauge_ms;
 }
@@ -26,6 +26,7 @@
 
 #include "logic.h"
 #include "system.h"
+#include "pvd.h"
 
 /* USER CODE END Includes */
 
@@ -108,6 +109,8 @@ int main(void)
 
   system_init();
   logic_init();
+  // the runtime is loaded, from now on a brown-out commits it
+  pvd_init();
 
   /* USER CODE END 2 */
 
@@ -0,0 +1,358 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#include "persist.h"
+#include "crc.h"
+
+static uint8_t* _put8(uint8_t* p, uint8_t v)
+{
+    *p = v;
+    return p + 1;
+}
+
+static uint8_t* _put16(uint8_t* p, uint16_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+    return p + 2;
+}
+
+static uint8_t* _put32(uint8_t* p, uint32_t v)
+{
+    p = _put16(p, v);
+    return _put16(p, v >> 16);
+}
+
+static uint16_t _get16(const uint8_t* p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t _get32(const uint8_t* p)
+{
+    return _get16(p) | ((uint32_t)_get16(p + 2) << 16);
+}
+
+// appends the CRC of b..p, returns the image size
+static uint8_t _seal(uint8_t* b, uint8_t* p)
+{
+    uint16_t crc = crc16(CRC16_INIT, b, p - b);
+    p = _put16(p, crc);
+    return p - b;
+}
+
+static int _sealed(const uint8_t* b, uint8_t size, uint8_t len)
+{
+    return len >= size
+        && crc16(CRC16_INIT, b, size - 2) == _get16(b + size - 2);
+}
+
+uint8_t persist_encode_conf(const struct vehicle_conf* vc, uint8_t* b)
+{
+    uint8_t* p = b;
+
+    p = _put8(p, PERSIST_CONF_VERSION);
+    p = _put8(p, vc->batt_p);
+    p = _put8(p, vc->batt_s);
+    p = _put16(p, vc->cell_cap_mah);
+    p = _put16(p, vc->cell_mv_max);
+    p = _put16(p, vc->cell_mv_min);
+    p = _put8(p, vc->reverse_curr);
+    p = _put16(p, vc->pulse_p_rev);
+    p = _put16(p, vc->dist_p_rev_mm);
+    p = _put8(p, vc->moto_t_alarm_c);
+    p = _put8(p, vc->batt_t_alarm_c);
+    p = _put8(p, vc->drv_t_alarm_c);
+    return _seal(b, p);
+}
+
+int persist_decode_conf(struct vehicle_conf* vc, const uint8_t* b,
+    uint8_t len)
+{
+    if (b[0] == 1) {
+        if (!_sealed(b, PERSIST_CONF_SIZE, len)) {
+            // torn or corrupted; a raw struct of a 1p pack lands here as
+            // well and gets set up again
+            return 1;
+        }
+        init_vehicle_conf(vc);
+        vc->batt_p = b[1];
+        vc->batt_s = b[2];
+        vc->cell_cap_mah = _get16(b + 3);
+        vc->cell_mv_max = _get16(b + 5);
+        vc->cell_mv_min = _get16(b + 7);
+        vc->reverse_curr = b[9];
+        vc->pulse_p_rev = _get16(b + 10);
+        vc->dist_p_rev_mm = _get16(b + 12);
+        vc->moto_t_alarm_c = b[14];
+        vc->batt_t_alarm_c = b[15];
+        vc->drv_t_alarm_c = b[16];
+        return 0;
+    }
+
+    // batt_p of the raw struct, an erased page is none
+    if (len >= PERSIST_LEGACY_CONF_SIZE && b[0] != 0xff) {
+        // the raw struct, padding after reverse_curr and at the end
+        vc->batt_p = b[0];
+        vc->batt_s = b[1];
+        vc->cell_cap_mah = _get16(b + 2);
+        vc->cell_mv_max = _get16(b + 4);
+        vc->cell_mv_min = _get16(b + 6);
+        vc->reverse_curr = b[8];
+        vc->pulse_p_rev = _get16(b + 10);
+        vc->dist_p_rev_mm = _get16(b + 12);
+        vc->moto_t_alarm_c = b[14];
+        vc->batt_t_alarm_c = b[15];
+        vc->drv_t_alarm_c = b[16];
+        return 0;
+    }
+
+    return 1;
+}
+
+static uint8_t* _put_trip(uint8_t* p, const struct trip_runtime* t)
+{
+    p = _put32(p, t->dist_pulses);
+    p = _put32(p, t->travel_time_s);
+    p = _put8(p, t->max_speed_kmh);
+    return _put32(p, t->consumed_mah);
+}
+
+static void _get_trip(struct trip_runtime* t, const uint8_t* p, uint8_t pad)
+{
+    t->dist_pulses = _get32(p);
+    t->travel_time_s = _get32(p + 4);
+    t->max_speed_kmh = p[8];
+    t->consumed_mah = _get32(p + 9 + pad);
+}
+
+uint8_t persist_encode_runtime(const struct vehicle_runtime* vr, uint8_t* b)
+{
+    uint8_t* p = b;
+
+    p = _put8(p, PERSIST_RUNTIME_VERSION);
+    p = _put16(p, vr->last_batt_mv);
+    p = _put32(p, vr->pow_consumed_mah);
+    p = _put16(p, vr->full_batt_charge_cycles);
+    p = _put8(p, vr->current_display_mode);
+    p = _put_trip(p, &vr->total);
+    p = _put_trip(p, &vr->trip1);
+    p = _put_trip(p, &vr->trip2);
+    p = _put32(p, vr->cycle_mah);
+    p = _put16(p, vr->avg_dWh_km);
+    return p - b;
+}
+
+int persist_decode_runtime(struct vehicle_runtime* vr, const uint8_t* b,
+    uint8_t len)
+{
+    // the journal checks the integrity, the size tells the format
+    if (len == PERSIST_RUNTIME_SIZE && b[0] == 1) {
+        init_vehicle_runtime(vr);
+        vr->last_batt_mv = _get16(b + 1);
+        vr->pow_consumed_mah = _get32(b + 3);
+        vr->full_batt_charge_cycles = _get16(b + 7);
+        vr->current_display_mode = b[9];
+        _get_trip(&vr->total, b + 10, 0);
+        _get_trip(&vr->trip1, b + 23, 0);
+        _get_trip(&vr->trip2, b + 36, 0);
+        vr->cycle_mah = _get32(b + 49);
+        vr->avg_dWh_km = _get16(b + 53);
+        return 0;
+    }
+
+    if (len == PERSIST_LEGACY_RUNTIME_SIZE) {
+        // the raw struct, before the charge and consumption fields
+        init_vehicle_runtime(vr);
+        vr->last_batt_mv = _get16(b);
+        vr->pow_consumed_mah = _get16(b + 2);
+        vr->full_batt_charge_cycles = _get16(b + 4);
+        vr->current_display_mode = b[6];
+        _get_trip(&vr->total, b + 8, 3);
+        _get_trip(&vr->trip1, b + 24, 3);
+        _get_trip(&vr->trip2, b + 40, 3);
+        return 0;
+    }
+
+    return 1;
+}
+
+uint8_t persist_encode_rint(const struct rint_history* rh, uint8_t* b)
+{
+    uint8_t* p = b;
+
+    p = _put8(p, PERSIST_RINT_VERSION);
+    for (uint8_t i = 0; i < RINT_HISTORY; ++i) {
+        p = _put16(p, rh->mohm[i]);
+    }
+    p = _put8(p, rh->count);
+    return _seal(b, p);
+}
+
+int persist_decode_rint(struct rint_history* rh, const uint8_t* b,
+    uint8_t len)
+{
+    if (!_sealed(b, PERSIST_RINT_SIZE, len) || b[0] != 1
+        || b[1 + 2 * RINT_HISTORY] > RINT_HISTORY) {
+        return 1;
+    }
+
+    for (uint8_t i = 0; i < RINT_HISTORY; ++i) {
+        rh->mohm[i] = _get16(b + 1 + 2 * i);
+    }
+    rh->count = b[1 + 2 * RINT_HISTORY];
+    return 0;
+}
+
+uint8_t persist_encode_trip(const struct trip_summary* ts, uint8_t* b)
+{
+    uint8_t* p = b;
+
+    p = _put8(p, PERSIST_TRIP_VERSION);
+    p = _put32(p, ts->seq);
+    p = _put8(p, ts->trip);
+    p = _put32(p, ts->end_m);
+    p = _put32(p, ts->dist_m);
+    p = _put32(p, ts->moving_s);
+    p = _put16(p, ts->max_dkmh);
+    p = _put32(p, ts->consumed_dWh);
+    p = _put32(p, ts->recovered_dWh);
+    p = _put8(p, ts->max_moto_temp);
+    p = _put8(p, ts->max_driver_temp);
+    p = _put8(p, ts->max_batt_temp);
+    return _seal(b, p);
+}
+
+int persist_decode_trip(struct trip_summary* ts, const uint8_t* b,
+    uint8_t len)
+{
+    if (!_sealed(b, PERSIST_TRIP_SIZE, len) || b[0] != 1) {
+        return 1;
+    }
+
+    ts->seq = _get32(b + 1);
+    ts->trip = b[5];
+    ts->end_m = _get32(b + 6);
+    ts->dist_m = _get32(b + 10);
+    ts->moving_s = _get32(b + 14);
+    ts->max_dkmh = _get16(b + 18);
+    ts->consumed_dWh = _get32(b + 20);
+    ts->recovered_dWh = _get32(b + 24);
+    ts->max_moto_temp = (int8_t)b[28];
+    ts->max_driver_temp = (int8_t)b[29];
+    ts->max_batt_temp = (int8_t)b[30];
+    return 0;
+}
+
+uint8_t persist_encode_cycles(const struct rainflow* rf, uint8_t* b)
+{
+    uint8_t* p = b;
+
+    p = _put8(p, PERSIST_RAINFLOW_VERSION);
+    for (uint8_t d = 0; d < RAINFLOW_DEPTHS; ++d) {
+        for (uint8_t m = 0; m < RAINFLOW_MEANS; ++m) {
+            p = _put16(p, rf->half[d][m]);
+        }
+    }
+    return _seal(b, p);
+}
+
+int persist_decode_cycles(struct rainflow* rf, const uint8_t* b,
+    uint8_t len)
+{
+    if (!_sealed(b, PERSIST_CYCLES_SIZE, len) || b[0] != 1) {
+        return 1;
+    }
+
+    const uint8_t* p = b + 1;
+    for (uint8_t d = 0; d < RAINFLOW_DEPTHS; ++d) {
+        for (uint8_t m = 0; m < RAINFLOW_MEANS; ++m) {
+            rf->half[d][m] = _get16(p);
+            p += 2;
+        }
+    }
+    return 0;
+}
+
+uint8_t persist_encode_reversals(const struct rainflow* rf, uint8_t* b)
+{
+    uint8_t* p = b;
+
+    p = _put8(p, PERSIST_RAINFLOW_VERSION);
+    p = _put8(p, rf->count);
+    for (uint8_t i = 0; i < RAINFLOW_STACK; ++i) {
+        p = _put16(p, (i < rf->count) ? rf->stack[i] : 0);
+    }
+    return _seal(b, p);
+}
+
+int persist_decode_reversals(struct rainflow* rf, const uint8_t* b,
+    uint8_t len)
+{
+    if (!_sealed(b, PERSIST_REVERSALS_SIZE, len) || b[0] != 1
+        || b[1] > RAINFLOW_STACK) {
+        return 1;
+    }
+
+    rf->count = b[1];
+    for (uint8_t i = 0; i < RAINFLOW_STACK; ++i) {
+        rf->stack[i] = _get16(b + 2 + 2 * i);
+    }
+    return 0;
+}
+
+uint8_t persist_encode_charge(const struct charge_session* cs, uint8_t* b)
+{
+    uint8_t* p = b;
+
+    p = _put8(p, PERSIST_CHARGE_VERSION);
+    p = _put32(p, cs->seq);
+    p = _put16(p, cs->start_dv);
+    p = _put16(p, cs->end_dv);
+    p = _put32(p, cs->duration_s);
+    p = _put32(p, cs->dWh_in);
+    p = _put32(p, cs->mAh_in);
+    p = _put32(p, cs->total_dWh);
+    p = _put32(p, cs->total_mAh);
+    return _seal(b, p);
+}
+
+int persist_decode_charge(struct charge_session* cs, const uint8_t* b,
+    uint8_t len)
+{
+    if (!_sealed(b, PERSIST_CHARGE_SIZE, len) || b[0] != 1) {
+        return 1;
+    }
+
+    cs->seq = _get32(b + 1);
+    cs->start_dv = _get16(b + 5);
+    cs->end_dv = _get16(b + 7);
+    cs->duration_s = _get32(b + 9);
+    cs->dWh_in = _get32(b + 13);
+    cs->mAh_in = _get32(b + 17);
+    cs->total_dWh = _get32(b + 21);
+    cs->total_mAh = _get32(b + 25);
+    return 0;
+}
\ No newline at end of file
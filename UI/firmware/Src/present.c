@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#include "present.h"
+#include "ui_layout.h"
+
+#define Q                   8
+
+#define PRESENT(m, kind_, shift_, threshold_, snap_) \
+    { UI_SRC(m), .kind = (kind_), .shift = (shift_), \
+      .threshold = (threshold_), .snap = (snap_) }
+
+static const struct present_conf conf[] = {
+    // 0.1 km/h
+    PRESENT(speed_dkmh, PF_CRITICAL, 2, 4, 50),
+    // 0.1 A
+    PRESENT(amper_da, PF_EMA, 2, 2, 5),
+    // 0.01 W
+    PRESENT(power_cw, PF_EMA, 2, 200, 500),
+    // 0.1 V
+    PRESENT(batt_dv, PF_EMA, 3, 2, 5),
+};
+
+#define FILTERS (sizeof(conf) / sizeof(conf[0]))
+
+struct present_state
+{
+    // Q8 filter stages
+    int64_t s1;
+    int64_t s2;
+    int32_t shown;
+};
+
+static struct present_state state[FILTERS];
+static uint8_t initialized = 0;
+
+static inline int64_t _abs64(int64_t v)
+{
+    return (v < 0) ? -v : v;
+}
+
+static inline int32_t _round_q(int64_t v)
+{
+    return (v + (1 << (Q - 1))) >> Q;
+}
+
+static int32_t _filter(const struct present_conf* c, struct present_state* s,
+    int32_t raw)
+{
+    int64_t x = (int64_t)raw << Q;
+
+    if (c->kind == PF_NONE || _abs64(raw - (int64_t)s->shown) > c->snap) {
+        // real step, no smoothing
+        s->s1 = x;
+        s->s2 = x;
+        s->shown = raw;
+        return raw;
+    }
+
+    s->s1 += (x - s->s1) >> c->shift;
+    if (c->kind == PF_CRITICAL) {
+        s->s2 += (s->s1 - s->s2) >> c->shift;
+    } else {
+        s->s2 = s->s1;
+    }
+
+    int64_t deadband = ((int64_t)c->threshold << Q) - (1 << (Q - 2));
+
+    if (_abs64(s->s2 - ((int64_t)s->shown << Q)) >= deadband) {
+        s->shown = _round_q(s->s2);
+    }
+
+    return s->shown;
+}
+
+void present_init(void)
+{
+    initialized = 0;
+}
+
+void present_update(const struct vehicle_gauges* raw,
+    struct vehicle_gauges* presented)
+{
+    *presented = *raw;
+
+    for (uint8_t i = 0; i < FILTERS; ++i) {
+        const struct present_conf* c = &conf[i];
+        int32_t v = ui_gauge_get(raw, c->src, c->src_type);
+
+        if (!initialized) {
+            state[i].s1 = (int64_t)v << Q;
+            state[i].s2 = state[i].s1;
+            state[i].shown = v;
+        }
+
+        ui_gauge_set(presented, c->src, c->src_type, _filter(c, &state[i], v));
+    }
+
+    initialized = 1;
+}
@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#include "profile.h"
+#include "energy.h"
+#include "export.h"
+#include "crc.h"
+
+#include <string.h>
+
+#define PROFILE_VERSION     1
+
+#define CURRENT_ROWS    (PROFILE_CURRENTS / PROFILE_CURRENT_ROW)
+#define ROWS            (PROFILE_SPEEDS + CURRENT_ROWS + PROFILE_MOTO_BANDS)
+
+// the row after the last one exported, ROWS + 1 when idle
+static uint8_t exp_idx = ROWS + 1;
+
+static uint8_t* _put_u64(uint8_t* b, uint64_t v)
+{
+    for (uint8_t i = 0; i < 8; ++i) {
+        b[i] = v >> (8 * i);
+    }
+    return b + 8;
+}
+
+static uint64_t _get_u64(const uint8_t* b)
+{
+    uint64_t v = 0;
+
+    for (uint8_t i = 0; i < 8; ++i) {
+        v |= (uint64_t)b[i] << (8 * i);
+    }
+    return v;
+}
+
+// equally wide bins from `min`, the last one open
+static uint8_t _bin(int32_t v, int32_t min, int32_t width, uint8_t bins)
+{
+    if (v < min) {
+        return 0;
+    }
+    v = (v - min) / width;
+    return (v < bins) ? v : bins - 1;
+}
+
+// the bins of table row `row`, returns the bytes written
+static uint8_t _put_row(const struct profile* p, uint8_t row, uint8_t* b)
+{
+    uint8_t* e = b;
+
+    if (row < PROFILE_SPEEDS) {
+        e = _put_u64(e, p->speed_mWs[row]);
+        e = _put_u64(e, p->speed_mm[row]);
+        e = _put_u64(e, p->speed_ms[row]);
+        return e - b;
+    }
+    row -= PROFILE_SPEEDS;
+    if (row < CURRENT_ROWS) {
+        for (uint8_t i = 0; i < PROFILE_CURRENT_ROW; ++i) {
+            e = _put_u64(e, p->current_ms[row * PROFILE_CURRENT_ROW + i]);
+        }
+        return e - b;
+    }
+    row -= CURRENT_ROWS;
+    for (uint8_t i = 0; i < PROFILE_BATT_BANDS; ++i) {
+        e = _put_u64(e, p->temp_ms[row][i]);
+    }
+    return e - b;
+}
+
+void profile_init(struct profile* p)
+{
+    memset(p, 0, sizeof(struct profile));
+}
+
+void profile_sample(struct profile* p, uint16_t speed_dkmh,
+    int16_t amper_da, int16_t moto_c, int16_t batt_c, int32_t mWs,
+    uint32_t dt_ms)
+{
+    if (dt_ms > ENERGY_MAX_GAP_MS || (speed_dkmh == 0
+        && amper_da <= PROFILE_IDLE_DA && amper_da >= -PROFILE_IDLE_DA)) {
+        return;
+    }
+
+    uint8_t s = _bin(speed_dkmh, 0, PROFILE_SPEED_DKMH, PROFILE_SPEEDS);
+    p->speed_mWs[s] += mWs;
+    // 0.1 km/h == 1/36 mm/ms
+    p->speed_mm[s] += (uint32_t)speed_dkmh * dt_ms / 36;
+    p->speed_ms[s] += dt_ms;
+
+    p->current_ms[_bin(amper_da, PROFILE_CURRENT_MIN_DA, PROFILE_CURRENT_DA,
+        PROFILE_CURRENTS)] += dt_ms;
+    p->temp_ms[_bin(moto_c, 0, PROFILE_MOTO_C, PROFILE_MOTO_BANDS)]
+        [_bin(batt_c, 0, PROFILE_BATT_C, PROFILE_BATT_BANDS)] += dt_ms;
+    p->dirty = 1;
+}
+
+int16_t profile_dWh_km(const struct profile* p, uint8_t speed_bin)
+{
+    if (p->speed_mm[speed_bin] < 100000) {
+        return 0;
+    }
+    // mWs / mm == Wh/km * 3.6
+    return p->speed_mWs[speed_bin] * 10 * 1000
+        / (int64_t)(p->speed_mm[speed_bin] * 3600);
+}
+
+uint16_t profile_encode(const struct profile* p, uint8_t* b)
+{
+    uint8_t* e = b;
+
+    *e++ = PROFILE_VERSION;
+    for (uint8_t row = 0; row < ROWS; ++row) {
+        e += _put_row(p, row, e);
+    }
+    uint16_t crc = crc16(CRC16_INIT, b, e - b);
+    *e++ = crc;
+    *e++ = crc >> 8;
+    return e - b;
+}
+
+int profile_decode(struct profile* p, const uint8_t* b, uint16_t len)
+{
+    if (len < PROFILE_SIZE || b[0] != PROFILE_VERSION
+        || crc16(CRC16_INIT, b, PROFILE_SIZE - 2)
+            != (b[PROFILE_SIZE - 2] | (b[PROFILE_SIZE - 1] << 8))) {
+        return 1;
+    }
+
+    const uint8_t* e = b + 1;
+    for (uint8_t i = 0; i < PROFILE_SPEEDS; ++i) {
+        p->speed_mWs[i] = (int64_t)_get_u64(e);
+        p->speed_mm[i] = _get_u64(e + 8);
+        p->speed_ms[i] = _get_u64(e + 16);
+        e += 24;
+    }
+    for (uint8_t i = 0; i < PROFILE_CURRENTS; ++i, e += 8) {
+        p->current_ms[i] = _get_u64(e);
+    }
+    for (uint8_t m = 0; m < PROFILE_MOTO_BANDS; ++m) {
+        for (uint8_t i = 0; i < PROFILE_BATT_BANDS; ++i, e += 8) {
+            p->temp_ms[m][i] = _get_u64(e);
+        }
+    }
+    p->dirty = 0;
+    return 0;
+}
+
+int profile_export_start(void)
+{
+    if (exp_idx <= ROWS) {
+        return 1;
+    }
+    exp_idx = 0;
+    return 0;
+}
+
+void profile_export_poll(const struct profile* p)
+{
+    if (exp_idx > ROWS) {
+        return;
+    }
+
+    uint8_t b[EXPORT_MAX_PAYLOAD] = { 0 };
+
+    if (exp_idx == ROWS) {
+        if (!export_frame(EXPORT_PROFILE, ROWS, b, 0)) {
+            exp_idx = ROWS + 1;
+        }
+        return;
+    }
+
+    uint8_t row = exp_idx;
+    b[0] = (row < PROFILE_SPEEDS) ? 0
+        : (row < PROFILE_SPEEDS + CURRENT_ROWS) ? 1 : 2;
+    b[1] = (b[0] == 0) ? row : (b[0] == 1) ? row - PROFILE_SPEEDS
+        : row - PROFILE_SPEEDS - CURRENT_ROWS;
+    if (!export_frame(EXPORT_PROFILE, exp_idx, b,
+            2 + _put_row(p, row, b + 2))) {
+        ++exp_idx;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#include "pvd.h"
+#include "state.h"
+
+#include "stm32f1xx_hal.h"
+
+void pvd_init(void)
+{
+    PWR_PVDTypeDef pvd;
+
+    __HAL_RCC_PWR_CLK_ENABLE();
+
+    // 2.9 V, the highest level; PVDO rises when VDD drops below it
+    pvd.PVDLevel = PWR_PVDLEVEL_7;
+    pvd.Mode = PWR_PVD_MODE_IT_RISING;
+    HAL_PWR_ConfigPVD(&pvd);
+    HAL_PWR_EnablePVD();
+
+    // below SysTick, the blocking I2C write needs HAL_GetTick()
+    HAL_NVIC_SetPriority(PVD_IRQn, 1, 0);
+    HAL_NVIC_EnableIRQ(PVD_IRQn);
+}
+
+void HAL_PWR_PVDCallback(void)
+{
+    if (__HAL_PWR_GET_FLAG(PWR_FLAG_PVDO)) {
+        commit_vehicle_runtime();
+    }
+}
\ No newline at end of file
@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#include "rainflow.h"
+
+#include <string.h>
+
+static const uint16_t depth_edges[RAINFLOW_DEPTHS] = {
+    0, 50, 100, 200, 400, 600, 800,
+};
+
+static uint16_t _range(uint16_t a, uint16_t b)
+{
+    return (a > b) ? a - b : b - a;
+}
+
+uint8_t rainflow_depth_bin(uint16_t depth)
+{
+    uint8_t bin = RAINFLOW_DEPTHS - 1;
+
+    while (bin > 0 && depth < depth_edges[bin]) {
+        --bin;
+    }
+    return bin;
+}
+
+uint8_t rainflow_mean_bin(uint16_t mean)
+{
+    uint8_t bin = mean / (1000 / RAINFLOW_MEANS);
+
+    return (bin < RAINFLOW_MEANS) ? bin : RAINFLOW_MEANS - 1;
+}
+
+uint16_t rainflow_depth_edge(uint8_t bin)
+{
+    return depth_edges[bin];
+}
+
+static void _count(struct rainflow* rf, uint16_t a, uint16_t b,
+    uint8_t halves)
+{
+    uint16_t* n = &rf->half[rainflow_depth_bin(_range(a, b))]
+        [rainflow_mean_bin((a + b) / 2)];
+
+    *n = (*n > UINT16_MAX - halves) ? UINT16_MAX : *n + halves;
+}
+
+static void _push(struct rainflow* rf, uint16_t x)
+{
+    if (rf->count == RAINFLOW_STACK) {
+        _count(rf, rf->stack[0], rf->stack[1], 1);
+        memmove(rf->stack, rf->stack + 1,
+            (RAINFLOW_STACK - 1) * sizeof(rf->stack[0]));
+        --rf->count;
+    }
+    rf->stack[rf->count++] = x;
+}
+
+// four point rule over the confirmed reversals, the last point is not one
+static void _close(struct rainflow* rf)
+{
+    while (rf->count >= 5) {
+        uint16_t* p = &rf->stack[rf->count - 5];
+        uint16_t inner = _range(p[1], p[2]);
+
+        if (inner > _range(p[0], p[1]) || inner > _range(p[2], p[3])) {
+            break;
+        }
+        _count(rf, p[1], p[2], 2);
+        p[1] = p[3];
+        p[2] = p[4];
+        rf->count -= 2;
+    }
+}
+
+void rainflow_sample(struct rainflow* rf, uint16_t permille)
+{
+    if (rf->count == 0) {
+        rf->stack[rf->count++] = permille;
+        return;
+    }
+
+    uint16_t* last = &rf->stack[rf->count - 1];
+    if (rf->count == 1) {
+        // no direction yet
+        if (_range(permille, *last) >= RAINFLOW_GATE) {
+            _push(rf, permille);
+        }
+        return;
+    }
+
+    uint8_t rising = *last > rf->stack[rf->count - 2];
+    if (rising ? permille > *last : permille < *last) {
+        *last = permille;
+    } else if (_range(permille, *last) >= RAINFLOW_GATE) {
+        _push(rf, permille);
+        _close(rf);
+    }
+}
+
+uint32_t rainflow_cycles(const struct rainflow* rf, uint16_t min_depth)
+{
+    uint32_t halves = 0;
+
+    for (uint8_t d = rainflow_depth_bin(min_depth); d < RAINFLOW_DEPTHS; ++d) {
+        for (uint8_t m = 0; m < RAINFLOW_MEANS; ++m) {
+            halves += rf->half[d][m];
+        }
+    }
+    return halves / 2;
+}
\ No newline at end of file
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#include "range.h"
+
+#define Q                   8
+
+void range_init(struct range* r)
+{
+    r->range = 0;
+    r->last_ms = 0;
+    r->started = 0;
+}
+
+uint16_t range_blend(uint16_t recent, uint16_t ride, uint16_t long_term)
+{
+    uint32_t sum = 0;
+    uint32_t w = 0;
+
+    if (recent) {
+        sum += (uint32_t)recent * RANGE_W_RECENT;
+        w += RANGE_W_RECENT;
+    }
+    if (ride) {
+        sum += (uint32_t)ride * RANGE_W_RIDE;
+        w += RANGE_W_RIDE;
+    }
+    if (long_term) {
+        sum += (uint32_t)long_term * RANGE_W_LONG;
+        w += RANGE_W_LONG;
+    }
+
+    return w ? (sum + w / 2) / w : RANGE_DEFAULT_DWH_KM;
+}
+
+void range_update(struct range* r, uint32_t remaining_mWh, uint16_t dWh_km,
+    uint32_t now_ms)
+{
+    // 0.1 Wh/km == 0.1 mWh/m
+    int64_t target = dWh_km ? ((int64_t)remaining_mWh * 10 << Q) / dWh_km : 0;
+
+    if (!r->started) {
+        r->started = 1;
+        r->range = target;
+        r->last_ms = now_ms;
+        return;
+    }
+
+    uint32_t dt = now_ms - r->last_ms;
+    r->last_ms = now_ms;
+
+    if (dt >= RANGE_TAU_MS) {
+        r->range = target;
+    } else {
+        r->range += (target - r->range) * dt / RANGE_TAU_MS;
+    }
+}
+
+uint32_t range_m(const struct range* r)
+{
+    return (r->range + (1 << (Q - 1))) >> Q;
+}
\ No newline at end of file
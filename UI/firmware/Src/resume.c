@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#include "resume.h"
+#include "crc.h"
+
+#define RESUME_BYTES    (2 * RESUME_REGS)
+
+static void _put_u16(uint8_t* b, uint16_t v)
+{
+    b[0] = v & 0xff;
+    b[1] = v >> 8;
+}
+
+static void _put_u32(uint8_t* b, uint32_t v)
+{
+    _put_u16(b, v & 0xffff);
+    _put_u16(b + 2, v >> 16);
+}
+
+static uint16_t _get_u16(const uint8_t* b)
+{
+    return b[0] | (uint16_t)b[1] << 8;
+}
+
+static uint32_t _get_u32(const uint8_t* b)
+{
+    return _get_u16(b) | (uint32_t)_get_u16(b + 2) << 16;
+}
+
+void resume_init(void)
+{
+    bkp_init();
+}
+
+void resume_store(const struct resume* r)
+{
+    uint8_t b[RESUME_BYTES];
+
+    b[2] = RESUME_VERSION;
+    b[3] = r->display_mode;
+    b[4] = r->batt_perc;
+    b[5] = (uint8_t)r->ambient_temp;
+    _put_u16(b + 6, r->batt_dv);
+    _put_u32(b + 8, r->total_m);
+    _put_u32(b + 12, r->trip1_m);
+    _put_u32(b + 16, r->trip2_m);
+    _put_u16(b, crc16(CRC16_INIT, b + 2, RESUME_BYTES - 2));
+
+    // a reset between the writes leaves a CRC mismatch, i.e. a cold boot
+    for (uint8_t i = 0; i < RESUME_REGS; ++i) {
+        uint16_t v = _get_u16(b + 2 * i);
+        if (bkp_read(i) != v) {
+            bkp_write(i, v);
+        }
+    }
+}
+
+int resume_load(struct resume* r)
+{
+    uint8_t b[RESUME_BYTES];
+
+    for (uint8_t i = 0; i < RESUME_REGS; ++i) {
+        _put_u16(b + 2 * i, bkp_read(i));
+    }
+
+    if (_get_u16(b) != crc16(CRC16_INIT, b + 2, RESUME_BYTES - 2)
+        || b[2] != RESUME_VERSION) {
+        return 1;
+    }
+
+    r->display_mode = b[3];
+    r->batt_perc = b[4];
+    r->ambient_temp = (int8_t)b[5];
+    r->batt_dv = _get_u16(b + 6);
+    r->total_m = _get_u32(b + 8);
+    r->trip1_m = _get_u32(b + 12);
+    r->trip2_m = _get_u32(b + 16);
+    return 0;
+}
\ No newline at end of file
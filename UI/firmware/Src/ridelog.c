@@ -0,0 +1,376 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#include "ridelog.h"
+#include "export.h"
+#include "crc.h"
+
+#include <string.h>
+
+#define FIELDS      8
+#define CLASSES     6
+
+// payload bits of the prefix code classes, class k is k 1 bits and a 0
+// bit, the last one without the 0
+static const uint8_t class_bits[CLASSES] = { 0, 2, 5, 10, 16, 32 };
+
+static void _put_u32(uint8_t* b, uint32_t v)
+{
+    b[0] = v & 0xff;
+    b[1] = (v >> 8) & 0xff;
+    b[2] = (v >> 16) & 0xff;
+    b[3] = v >> 24;
+}
+
+static uint32_t _get_u32(const uint8_t* b)
+{
+    return b[0] | (uint32_t)b[1] << 8 | (uint32_t)b[2] << 16
+        | (uint32_t)b[3] << 24;
+}
+
+// signed fields sign-extended, the deltas wrap like the energy counter
+static void _fields(const struct ridelog_sample* s, uint32_t* v)
+{
+    v[0] = s->speed_kmh;
+    v[1] = (uint32_t)(int32_t)s->amper_a;
+    v[2] = s->batt_dv;
+    v[3] = (uint32_t)(int32_t)s->moto_temp;
+    v[4] = (uint32_t)(int32_t)s->driver_temp;
+    v[5] = (uint32_t)(int32_t)s->batt_temp;
+    v[6] = (uint32_t)(int32_t)s->ambient_temp;
+    v[7] = s->consumed_wh;
+}
+
+static void _sample(const uint32_t* v, struct ridelog_sample* s)
+{
+    s->speed_kmh = (uint8_t)v[0];
+    s->amper_a = (int16_t)v[1];
+    s->batt_dv = (uint16_t)v[2];
+    s->moto_temp = (int8_t)v[3];
+    s->driver_temp = (int8_t)v[4];
+    s->batt_temp = (int8_t)v[5];
+    s->ambient_temp = (int8_t)v[6];
+    s->consumed_wh = v[7];
+}
+
+static uint32_t _zigzag(uint32_t cur, uint32_t prev)
+{
+    int32_t d = (int32_t)(cur - prev);
+    return ((uint32_t)d << 1) ^ (uint32_t)(d >> 31);
+}
+
+static uint32_t _unzigzag(uint32_t z, uint32_t prev)
+{
+    return prev + ((z >> 1) ^ (0u - (z & 1)));
+}
+
+static uint8_t _class(uint32_t z)
+{
+    uint8_t k = 0;
+    while (k < CLASSES - 1 && (z >> class_bits[k]) != 0) {
+        ++k;
+    }
+    return k;
+}
+
+static uint8_t _code_bits(uint32_t z)
+{
+    uint8_t k = _class(z);
+    return k + (k < CLASSES - 1) + class_bits[k];
+}
+
+static void _put_bits(uint8_t* d, uint16_t* pos, uint32_t v, uint8_t n)
+{
+    while (n--) {
+        if ((v >> n) & 1) {
+            d[*pos / 8] |= 0x80 >> (*pos % 8);
+        }
+        ++*pos;
+    }
+}
+
+static uint32_t _get_bits(const uint8_t* d, uint16_t* pos, uint8_t n)
+{
+    uint32_t v = 0;
+    while (n--) {
+        // past the stream reads zeros, the caller checks *pos
+        v <<= 1;
+        if (*pos < RIDELOG_STREAM * 8) {
+            v |= (d[*pos / 8] >> (7 - *pos % 8)) & 1;
+        }
+        ++*pos;
+    }
+    return v;
+}
+
+static void _put_code(uint8_t* d, uint16_t* pos, uint32_t z)
+{
+    uint8_t k = _class(z);
+
+    _put_bits(d, pos, (1u << k) - 1, k);
+    if (k < CLASSES - 1) {
+        _put_bits(d, pos, 0, 1);
+    }
+    _put_bits(d, pos, z, class_bits[k]);
+}
+
+static uint16_t _page_addr(const struct ridelog* rl, uint16_t page)
+{
+    return rl->base + page * RIDELOG_BLOCK;
+}
+
+void ridelog_init(struct ridelog* rl, uint16_t base, uint16_t pages,
+    ridelog_read_fn read)
+{
+    memset(rl, 0, sizeof(struct ridelog));
+    rl->base = base;
+    rl->pages = pages;
+    rl->read = read;
+}
+
+// a valid block in the page it belongs to
+static uint8_t _load(const struct ridelog* rl, uint16_t page, uint32_t* seq)
+{
+    uint8_t b[RIDELOG_BLOCK];
+
+    if (rl->read(_page_addr(rl, page), b, RIDELOG_BLOCK) != HAL_OK) {
+        return 0;
+    }
+    if (crc16(CRC16_INIT, b, RIDELOG_BLOCK - 2)
+        != (b[RIDELOG_BLOCK - 2] | (uint16_t)b[RIDELOG_BLOCK - 1] << 8)) {
+        return 0;
+    }
+    *seq = _get_u32(b);
+    return *seq % rl->pages == page;
+}
+
+int ridelog_open(struct ridelog* rl)
+{
+    uint32_t seq, seq0 = 0;
+    uint8_t have = 0;
+
+    rl->next_seq = 0;
+
+    // as in journal_open(), page 0 may be a torn block
+    if (_load(rl, 0, &seq)) {
+        seq0 = seq;
+        have = 1;
+    }
+    if (_load(rl, 1, &seq) && (!have || seq - 1 > seq0)) {
+        seq0 = seq - 1;
+        have = 1;
+    }
+    if (!have) {
+        return 1;
+    }
+
+    uint16_t lo = 0;
+    uint16_t hi = rl->pages - 1;
+    while (lo < hi) {
+        uint16_t mid = (lo + hi + 1) / 2;
+        if ((_load(rl, mid, &seq) && seq >= seq0)
+            || (mid < hi && _load(rl, mid + 1, &seq) && seq >= seq0)) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+
+    // page p of the newest round holds seq0 + p
+    rl->next_seq = seq0 + lo + 1;
+    return 0;
+}
+
+static void _written(void* ctx, int err)
+{
+    struct ridelog* rl = (struct ridelog*)ctx;
+
+    rl->writing = 0;
+    if (err) {
+        ++rl->blocks_dropped;
+    } else {
+        ++rl->blocks_written;
+    }
+}
+
+static void _write_block(struct ridelog* rl)
+{
+    uint8_t* b = rl->blk[rl->cur];
+
+    if (rl->n == 0) {
+        return;
+    }
+
+    b[8] = rl->n;
+    uint16_t crc = crc16(CRC16_INIT, b, RIDELOG_BLOCK - 2);
+    b[RIDELOG_BLOCK - 2] = crc & 0xff;
+    b[RIDELOG_BLOCK - 1] = crc >> 8;
+
+    // a block still going out means the bus is stuck, this one is lost
+    // and its seq reused
+    if (rl->writing || eeprom_async_write(
+            _page_addr(rl, rl->next_seq % rl->pages), b, RIDELOG_BLOCK,
+            _written, rl)) {
+        ++rl->blocks_dropped;
+    } else {
+        rl->writing = 1;
+        rl->cur = !rl->cur;
+        ++rl->next_seq;
+    }
+    rl->n = 0;
+}
+
+void ridelog_sample(struct ridelog* rl, const struct ridelog_sample* s)
+{
+    uint32_t v[FIELDS], prev[FIELDS], z[FIELDS];
+    uint16_t need = 1;
+    uint8_t changed = 0;
+
+    _fields(s, v);
+    if (rl->n) {
+        _fields(&rl->prev, prev);
+        for (uint8_t f = 0; f < FIELDS; ++f) {
+            z[f] = _zigzag(v[f], prev[f]);
+            changed |= (z[f] != 0);
+            need += _code_bits(z[f]);
+        }
+        if (rl->n == RIDELOG_MAX_SAMPLES
+            || rl->bits + (changed ? need : 1) > RIDELOG_STREAM * 8) {
+            _write_block(rl);
+        }
+    }
+
+    if (rl->n == 0) {
+        // the first sample of a block against zeros, it fits any block
+        uint8_t* b = rl->blk[rl->cur];
+        memset(b, 0, RIDELOG_BLOCK);
+        _put_u32(b, rl->next_seq);
+        _put_u32(b + 4, rl->t_s);
+        rl->bits = 0;
+        changed = 1;
+        for (uint8_t f = 0; f < FIELDS; ++f) {
+            z[f] = _zigzag(v[f], 0);
+        }
+    }
+
+    uint8_t* stream = rl->blk[rl->cur] + RIDELOG_HEADER;
+    _put_bits(stream, &rl->bits, changed, 1);
+    if (changed) {
+        for (uint8_t f = 0; f < FIELDS; ++f) {
+            _put_code(stream, &rl->bits, z[f]);
+        }
+    }
+
+    rl->prev = *s;
+    ++rl->n;
+    ++rl->t_s;
+    ++rl->samples;
+}
+
+void ridelog_flush(struct ridelog* rl)
+{
+    _write_block(rl);
+}
+
+int ridelog_export_start(struct ridelog* rl)
+{
+    if (rl->exporting) {
+        return 1;
+    }
+
+    // with the last seconds, the read of its page queues behind
+    ridelog_flush(rl);
+    rl->exporting = 1;
+    rl->exp_reading = 0;
+    rl->exp_ready = 0;
+    rl->exp_page = 0;
+    return 0;
+}
+
+static void _exported(void* ctx, int err)
+{
+    struct ridelog* rl = (struct ridelog*)ctx;
+
+    rl->exp_reading = 0;
+    // a failed read is retried
+    rl->exp_ready = !err;
+}
+
+void ridelog_poll(struct ridelog* rl)
+{
+    if (!rl->exporting || rl->exp_reading) {
+        return;
+    }
+
+    if (rl->exp_page == rl->pages) {
+        if (!export_frame(EXPORT_RIDE_LOG, rl->pages, rl->exp_buf, 0)) {
+            rl->exporting = 0;
+        }
+    } else if (rl->exp_ready) {
+        if (!export_frame(EXPORT_RIDE_LOG, rl->exp_page, rl->exp_buf,
+                RIDELOG_BLOCK)) {
+            rl->exp_ready = 0;
+            ++rl->exp_page;
+        }
+    } else if (!eeprom_async_read(_page_addr(rl, rl->exp_page),
+            rl->exp_buf, RIDELOG_BLOCK, _exported, rl)) {
+        rl->exp_reading = 1;
+    }
+}
+
+int ridelog_block_decode(const uint8_t* blk, uint32_t* seq, uint32_t* t_s,
+    struct ridelog_sample* out, uint16_t max)
+{
+    uint32_t v[FIELDS] = { 0 };
+    const uint8_t* stream = blk + RIDELOG_HEADER;
+    uint16_t pos = 0;
+    uint8_t n = blk[8];
+
+    if (crc16(CRC16_INIT, blk, RIDELOG_BLOCK - 2)
+        != (blk[RIDELOG_BLOCK - 2] | (uint16_t)blk[RIDELOG_BLOCK - 1] << 8)
+        || n == 0 || n > max) {
+        return -1;
+    }
+    *seq = _get_u32(blk);
+    *t_s = _get_u32(blk + 4);
+
+    for (uint8_t i = 0; i < n; ++i) {
+        if (_get_bits(stream, &pos, 1)) {
+            for (uint8_t f = 0; f < FIELDS; ++f) {
+                uint8_t k = 0;
+                while (k < CLASSES - 1 && _get_bits(stream, &pos, 1)) {
+                    ++k;
+                }
+                v[f] = _unzigzag(_get_bits(stream, &pos, class_bits[k]),
+                    v[f]);
+            }
+        }
+        if (pos > RIDELOG_STREAM * 8) {
+            return -1;
+        }
+        _sample(v, &out[i]);
+    }
+    return n;
+}
\ No newline at end of file
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#include "rint.h"
+
+#include <string.h>
+
+static inline void _mean(int64_t* m, int64_t x)
+{
+    *m += (x - *m) >> RINT_FORGET_SHIFT;
+}
+
+static void _solve(struct rint* r)
+{
+    // weighted variance of I and covariance of I and V
+    int64_t var = r->mii - ((r->mi * r->mi) >> RINT_Q);
+    int64_t cov = r->miv - ((r->mi * r->mv) >> RINT_Q);
+
+    int64_t min_var = (int64_t)RINT_MIN_SPREAD_DA * RINT_MIN_SPREAD_DA
+        << RINT_Q;
+
+    if (r->samples < RINT_MIN_SAMPLES || var < min_var) {
+        return;
+    }
+
+    // V = OCV - R * I, 0.1 V / 0.1 A == Ohm
+    int64_t mohm = -cov * 1000 / var;
+
+    if (mohm < 0 || mohm > UINT16_MAX) {
+        return;
+    }
+
+    r->mohm = mohm;
+    // OCV = mean(V) + R * mean(I)
+    r->ocv_dv = (r->mv + mohm * r->mi / 1000) >> RINT_Q;
+    r->valid = 1;
+}
+
+void rint_init(struct rint* r)
+{
+    memset(r, 0, sizeof(*r));
+}
+
+void rint_sample(struct rint* r, uint16_t batt_dv, int16_t amper_da)
+{
+    if (r->has_last) {
+        int16_t di = amper_da - r->last_da;
+        if (di < RINT_MIN_DI && di > -RINT_MIN_DI) {
+            return;
+        }
+    }
+
+    r->last_da = amper_da;
+    r->has_last = 1;
+
+    int64_t i = amper_da;
+    int64_t v = batt_dv;
+
+    if (r->samples == 0) {
+        r->mi = i << RINT_Q;
+        r->mv = v << RINT_Q;
+        r->mii = (i * i) << RINT_Q;
+        r->miv = (i * v) << RINT_Q;
+    } else {
+        _mean(&r->mi, i << RINT_Q);
+        _mean(&r->mv, v << RINT_Q);
+        _mean(&r->mii, (i * i) << RINT_Q);
+        _mean(&r->miv, (i * v) << RINT_Q);
+    }
+
+    if (r->samples < UINT16_MAX) {
+        ++r->samples;
+    }
+
+    _solve(r);
+}
+
+uint8_t rint_valid(const struct rint* r)
+{
+    return r->valid;
+}
+
+uint16_t rint_mohm(const struct rint* r)
+{
+    return r->mohm;
+}
+
+uint16_t rint_compensate_dv(const struct rint* r, uint16_t batt_dv,
+    int16_t amper_da)
+{
+    if (!r->valid) {
+        return batt_dv;
+    }
+
+    // mOhm * 0.1 A == 0.1 mV
+    int32_t dv = batt_dv + (int32_t)r->mohm * amper_da / 1000;
+
+    return (dv < 0) ? 0 : dv;
+}
+
+void rint_history_put(struct rint_history* h, uint16_t mohm, uint8_t new_ride)
+{
+    if (new_ride || h->count == 0) {
+        if (h->count == RINT_HISTORY) {
+            memmove(&h->mohm[0], &h->mohm[1],
+                (RINT_HISTORY - 1) * sizeof(h->mohm[0]));
+            --h->count;
+        }
+        ++h->count;
+    }
+
+    h->mohm[h->count - 1] = mohm;
+}
\ No newline at end of file
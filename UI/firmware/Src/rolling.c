@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#include "rolling.h"
+#include "energy.h"
+
+#include <string.h>
+
+// buckets in the 1 km window
+#define DIST_1KM            (1000000 / ROLL_DIST_BUCKET_MM)
+
+static inline int32_t _clamp32(int64_t v)
+{
+    return (v > INT32_MAX) ? INT32_MAX : (v < INT32_MIN) ? INT32_MIN : v;
+}
+
+static void _close_dist(struct rolling* r)
+{
+    int32_t e = r->dist_open_mWs;
+
+    r->dist_open_mWs = 0;
+    r->dist_edge_mm += ROLL_DIST_BUCKET_MM;
+
+    // the bucket leaving the 1 km window, still in the ring
+    if (r->dist_count >= DIST_1KM) {
+        uint8_t old = (r->dist_head + ROLL_DIST_BUCKETS - DIST_1KM)
+            % ROLL_DIST_BUCKETS;
+        r->sum_1km_mWs -= r->dist_mWs[old];
+    }
+    // the bucket leaving the 5 km window is overwritten now
+    if (r->dist_count == ROLL_DIST_BUCKETS) {
+        r->sum_5km_mWs -= r->dist_mWs[r->dist_head];
+    } else {
+        ++r->dist_count;
+    }
+
+    r->dist_mWs[r->dist_head] = e;
+    r->sum_1km_mWs += e;
+    r->sum_5km_mWs += e;
+    r->dist_head = (r->dist_head + 1) % ROLL_DIST_BUCKETS;
+}
+
+static void _close_time(struct rolling* r)
+{
+    if (r->time_count == ROLL_TIME_BUCKETS) {
+        r->sum_10min_mWs -= r->time_mWs[r->time_head];
+        r->sum_10min_mm -= r->time_mm[r->time_head];
+    } else {
+        ++r->time_count;
+    }
+
+    r->time_mWs[r->time_head] = r->time_open_mWs;
+    r->time_mm[r->time_head] = r->time_open_mm;
+    r->sum_10min_mWs += r->time_open_mWs;
+    r->sum_10min_mm += r->time_open_mm;
+    r->time_head = (r->time_head + 1) % ROLL_TIME_BUCKETS;
+
+    r->time_open_mWs = 0;
+    r->time_open_mm = 0;
+    r->time_edge_ms += ROLL_TIME_BUCKET_MS;
+}
+
+void rolling_init(struct rolling* r)
+{
+    memset(r, 0, sizeof(*r));
+}
+
+void rolling_update(struct rolling* r, uint64_t total_mm, int64_t net_mWs,
+    uint32_t now_ms)
+{
+    if (!r->started) {
+        r->started = 1;
+        r->last_mm = total_mm;
+        r->last_mWs = net_mWs;
+        r->dist_edge_mm = total_mm + ROLL_DIST_BUCKET_MM;
+        r->time_edge_ms = now_ms;
+        return;
+    }
+
+    uint32_t d_mm = (uint32_t)(total_mm - r->last_mm);
+    int32_t d_mWs = _clamp32(net_mWs - r->last_mWs);
+
+    r->last_mm = total_mm;
+    r->last_mWs = net_mWs;
+
+    r->dist_open_mWs = _clamp32((int64_t)r->dist_open_mWs + d_mWs);
+    r->time_open_mWs = _clamp32((int64_t)r->time_open_mWs + d_mWs);
+    r->time_open_mm += d_mm;
+
+    if (total_mm >= r->dist_edge_mm
+        && total_mm - r->dist_edge_mm
+            >= (uint64_t)ROLL_DIST_BUCKETS * ROLL_DIST_BUCKET_MM) {
+        // a jump longer than the window, nothing in it is measured
+        r->dist_head = 0;
+        r->dist_count = 0;
+        r->sum_1km_mWs = 0;
+        r->sum_5km_mWs = 0;
+        r->dist_open_mWs = 0;
+        r->dist_edge_mm = total_mm + ROLL_DIST_BUCKET_MM;
+    }
+    while (total_mm >= r->dist_edge_mm) {
+        _close_dist(r);
+    }
+
+    if (now_ms - r->time_edge_ms >= ROLL_TIME_BUCKETS * ROLL_TIME_BUCKET_MS) {
+        // no updates for longer than the window, nothing in it is recent
+        r->time_head = 0;
+        r->time_count = 0;
+        r->sum_10min_mWs = 0;
+        r->sum_10min_mm = 0;
+        r->time_open_mWs = 0;
+        r->time_open_mm = 0;
+        r->time_edge_ms = now_ms;
+    }
+    while (now_ms - r->time_edge_ms >= ROLL_TIME_BUCKET_MS) {
+        _close_time(r);
+    }
+}
+
+uint16_t rolling_dWh_km(const struct rolling* r, uint8_t window)
+{
+    uint8_t n = r->dist_count;
+
+    switch (window) {
+    case ROLL_1KM:
+        n = (n > DIST_1KM) ? DIST_1KM : n;
+        return energy_dWh_km(r->sum_1km_mWs, n * (ROLL_DIST_BUCKET_MM / 1000));
+    case ROLL_5KM:
+        return energy_dWh_km(r->sum_5km_mWs, n * (ROLL_DIST_BUCKET_MM / 1000));
+    case ROLL_10MIN:
+        return energy_dWh_km(r->sum_10min_mWs, r->sum_10min_mm / 1000);
+    default:
+        return 0;
+    }
+}
+
+uint16_t rolling_avg_dkmh(const struct rolling* r)
+{
+    uint32_t ms = (uint32_t)r->time_count * ROLL_TIME_BUCKET_MS;
+
+    if (ms == 0) {
+        return 0;
+    }
+
+    // mm/ms == m/s, 0.1 km/h == m/s * 36
+    return (uint16_t)(((uint64_t)r->sum_10min_mm * 36 + ms / 2) / ms);
+}
\ No newline at end of file
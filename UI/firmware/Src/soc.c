@@ -0,0 +1,234 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#include "soc.h"
+
+#define UAS_P_MAH           3600000LL
+
+struct ocv_point
+{
+    uint16_t mv;
+    uint16_t permille;
+};
+
+// rested Li-ion (NMC) cell at room temperature
+static const struct ocv_point ocv_curve[] = {
+    { 3300, 0 },
+    { 3450, 50 },
+    { 3530, 100 },
+    { 3610, 200 },
+    { 3670, 300 },
+    { 3720, 400 },
+    { 3770, 500 },
+    { 3830, 600 },
+    { 3910, 700 },
+    { 3990, 800 },
+    { 4080, 900 },
+    { 4180, 1000 },
+};
+
+#define OCV_POINTS (sizeof(ocv_curve) / sizeof(ocv_curve[0]))
+
+// the curve with its ends at the configured cell voltages, or just the
+// ends for a linear one
+static uint8_t _ocv_last(const struct soc* s)
+{
+    return s->ocv_linear ? 1 : OCV_POINTS - 1;
+}
+
+static struct ocv_point _ocv_point(const struct soc* s, uint8_t i)
+{
+    struct ocv_point p;
+
+    if (i == 0) {
+        p.mv = s->cell_mv_min;
+        p.permille = 0;
+    } else if (i == _ocv_last(s)) {
+        p.mv = s->cell_mv_max;
+        p.permille = 1000;
+    } else {
+        p = ocv_curve[i];
+    }
+    return p;
+}
+
+uint16_t soc_ocv_permille(const struct soc* s, uint16_t cell_mv)
+{
+    if (cell_mv <= s->cell_mv_min) {
+        return 0;
+    }
+
+    for (uint8_t i = 1; i <= _ocv_last(s); ++i) {
+        struct ocv_point hi = _ocv_point(s, i);
+        struct ocv_point lo = _ocv_point(s, i - 1);
+
+        if (cell_mv < hi.mv) {
+            return lo.permille + (uint32_t)(cell_mv - lo.mv)
+                * (hi.permille - lo.permille) / (hi.mv - lo.mv);
+        }
+    }
+
+    return 1000;
+}
+
+// integral of the OCV curve from 0 to permille, in permille * mV
+static uint32_t _ocv_integral(const struct soc* s, uint16_t permille)
+{
+    uint32_t sum = 0;
+
+    for (uint8_t i = 1; i <= _ocv_last(s); ++i) {
+        struct ocv_point hi = _ocv_point(s, i);
+        struct ocv_point lo = _ocv_point(s, i - 1);
+
+        if (permille <= lo.permille) {
+            break;
+        }
+
+        uint16_t end = (permille < hi.permille) ? permille : hi.permille;
+        uint16_t end_mv = lo.mv + (uint32_t)(end - lo.permille)
+            * (hi.mv - lo.mv) / (hi.permille - lo.permille);
+
+        sum += (uint32_t)(end - lo.permille) * (lo.mv + end_mv) / 2;
+    }
+
+    return sum;
+}
+
+static void _anchor(struct soc* s, uint16_t batt_dv)
+{
+    uint16_t cell_mv = (uint32_t)batt_dv * 100 / s->batt_s;
+    uint16_t permille = soc_ocv_permille(s, cell_mv);
+
+    s->used = s->capacity * (1000 - permille) / 1000;
+    s->anchored = 1;
+    s->rest_ms = 0;
+}
+
+void soc_init(struct soc* s, const struct vehicle_conf* vc)
+{
+    s->capacity = (int64_t)vc->cell_cap_mah * vc->batt_p * UAS_P_MAH;
+    s->capacity = s->capacity ? s->capacity : 1;
+    s->batt_s = vc->batt_s ? vc->batt_s : 1;
+    s->mah_cells = (uint32_t)vc->cell_cap_mah * vc->batt_p * vc->batt_s;
+    if (vc->cell_mv_max > vc->cell_mv_min) {
+        s->cell_mv_min = vc->cell_mv_min;
+        s->cell_mv_max = vc->cell_mv_max;
+    } else {
+        s->cell_mv_min = ocv_curve[0].mv;
+        s->cell_mv_max = ocv_curve[OCV_POINTS - 1].mv;
+    }
+    // the Li-ion shape only fits a range around its inner points
+    s->ocv_linear = s->cell_mv_min >= ocv_curve[1].mv
+        || s->cell_mv_max <= ocv_curve[OCV_POINTS - 2].mv;
+    s->used = 0;
+    s->cycle = 0;
+    s->cycles = 0;
+    s->prev_da = 0;
+    s->has_prev = 0;
+    s->anchored = 0;
+    s->rest_ms = 0;
+}
+
+void soc_restore(struct soc* s, const struct vehicle_runtime* vr)
+{
+    s->used = (int64_t)vr->pow_consumed_mah * UAS_P_MAH;
+    s->used = (s->used > s->capacity) ? s->capacity : s->used;
+    s->cycle = (int64_t)vr->cycle_mah * UAS_P_MAH;
+    s->cycles = vr->full_batt_charge_cycles;
+}
+
+void soc_store(const struct soc* s, struct vehicle_runtime* vr)
+{
+    vr->pow_consumed_mah = (s->used + UAS_P_MAH / 2) / UAS_P_MAH;
+    vr->cycle_mah = s->cycle / UAS_P_MAH;
+    vr->full_batt_charge_cycles = s->cycles;
+}
+
+void soc_sample(struct soc* s, uint16_t batt_dv, int16_t amper_da,
+    uint32_t dt_ms)
+{
+    uint8_t quiet = (amper_da <= SOC_REST_DA && amper_da >= -SOC_REST_DA);
+    uint8_t connected = s->has_prev && dt_ms <= SOC_MAX_GAP_MS;
+
+    if (!s->anchored && quiet) {
+        // first quiet sample after power up, the pack has been resting
+        _anchor(s, batt_dv);
+    }
+
+    if (connected) {
+        // 0.1 A * ms == 100 uAs, trapezoid => / 2
+        int64_t q = ((int32_t)s->prev_da + amper_da) * (int64_t)dt_ms * 50;
+
+        s->used += q;
+        s->used = (s->used < 0) ? 0 : (s->used > s->capacity) ? s->capacity : s->used;
+
+        if (q > 0) {
+            s->cycle += q;
+            if (s->cycle >= s->capacity) {
+                s->cycle -= s->capacity;
+                ++s->cycles;
+            }
+        }
+
+        if (quiet) {
+            s->rest_ms += dt_ms;
+            if (s->rest_ms >= SOC_REST_MS) {
+                _anchor(s, batt_dv);
+            }
+        } else {
+            s->rest_ms = 0;
+        }
+    }
+
+    s->prev_da = amper_da;
+    s->has_prev = 1;
+}
+
+void soc_break(struct soc* s)
+{
+    s->has_prev = 0;
+}
+
+uint16_t soc_permille(const struct soc* s)
+{
+    return (uint16_t)(1000 - s->used * 1000 / s->capacity);
+}
+
+uint8_t soc_percent(const struct soc* s)
+{
+    return (uint8_t)((soc_permille(s) + 5) / 10);
+}
+
+uint32_t soc_remaining_mWh(const struct soc* s)
+{
+    // mAh * permille * mV / 1000 / 1000 == mWh
+    return (uint64_t)s->mah_cells * _ocv_integral(s, soc_permille(s))
+        / 1000000;
+}
+
+uint32_t soc_cycles_dc(const struct soc* s)
+{
+    return (uint32_t)s->cycles * 10 + s->cycle * 10 / s->capacity;
+}
\ No newline at end of file
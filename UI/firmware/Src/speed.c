@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#include "speed.h"
+
+// filter gains as shifts: alpha = 1/2, beta = 1/4
+#define ALPHA_SHIFT         1
+#define BETA_SHIFT          2
+
+// mm/s Q8 -> 0.1 km/h: * 0.036 / 256
+#define DKMH_MUL            9
+#define DKMH_DIV            64000
+
+static inline int32_t _abs32(int32_t v)
+{
+    return (v < 0) ? -v : v;
+}
+
+// v * num / den without overflowing
+static inline int32_t _muldiv(int32_t v, int32_t num, int32_t den)
+{
+    return (int32_t)((int64_t)v * num / den);
+}
+
+// distance of `pulses` in time `ms` as mm/s Q8
+static inline int32_t _pulses_to_v(const struct speed_est* se,
+    uint32_t pulses, uint32_t ms)
+{
+    uint64_t mm_s = (uint64_t)pulses * se->mm_pp * 1000;
+    return (int32_t)((mm_s >> (16 - SPEED_Q)) / ms);
+}
+
+static void _stopped(struct speed_est* se)
+{
+    se->v = 0;
+    se->a = 0;
+    se->confidence = 100;
+}
+
+void speed_init(struct speed_est* se, const struct vehicle_conf* vc)
+{
+    uint16_t ppr = vc->pulse_p_rev ? vc->pulse_p_rev : 1;
+
+    se->mm_pp = ((uint32_t)vc->dist_p_rev_mm << 16) / ppr;
+    se->pulses = 0;
+    se->idle_ms = 0;
+    se->started = 0;
+    _stopped(se);
+}
+
+void speed_update(struct speed_est* se, uint32_t tot_pulses, uint32_t dt_ms)
+{
+    if (!se->started) {
+        se->pulses = tot_pulses;
+        se->started = 1;
+        return;
+    }
+
+    if (dt_ms == 0) {
+        // keep the pulses for the next window
+        return;
+    }
+
+    uint32_t delta = tot_pulses - se->pulses;
+    se->pulses = tot_pulses;
+
+    if (delta == 0) {
+        se->idle_ms += dt_ms;
+        if (se->idle_ms >= SPEED_STOP_MS) {
+            _stopped(se);
+            return;
+        }
+
+        // less than one pulse in the idle time
+        int32_t bound = _pulses_to_v(se, 1, se->idle_ms);
+        int32_t v = se->v + _muldiv(se->a, dt_ms, 1000);
+
+        if (v > bound) {
+            v = bound;
+            se->a = (se->a > 0) ? 0 : se->a;
+        }
+        se->v = (v < 0) ? 0 : v;
+        se->confidence /= 2;
+        return;
+    }
+
+    se->idle_ms = 0;
+
+    int32_t vm = _pulses_to_v(se, delta, dt_ms);
+
+    if (dt_ms > SPEED_MAX_WINDOW_MS) {
+        // a gap, the average is all we know
+        se->v = vm;
+        se->a = 0;
+        se->confidence = 0;
+        return;
+    }
+
+    // predict and move the measurement from the middle of the window
+    // to its end
+    int32_t vp = se->v + _muldiv(se->a, dt_ms, 1000);
+    vm += _muldiv(se->a, dt_ms, 2000);
+
+    int32_t r = vm - vp;
+
+    se->v = vp + (r >> ALPHA_SHIFT);
+    se->a += _muldiv(r >> BETA_SHIFT, 1000, dt_ms);
+
+    if (se->v < 0) {
+        se->v = 0;
+        se->a = 0;
+    }
+
+    // residual and one pulse of quantization against the speed itself
+    int32_t err = _abs32(r) + _pulses_to_v(se, 1, dt_ms);
+    se->confidence = (uint8_t)((int64_t)se->v * 100 / (se->v + err));
+}
+
+uint16_t speed_dkmh(const struct speed_est* se)
+{
+    return (uint16_t)(((uint32_t)se->v * DKMH_MUL + DKMH_DIV / 2) / DKMH_DIV);
+}
+
+int16_t speed_accel(const struct speed_est* se)
+{
+    // mm/s^2 Q8 -> 0.01 m/s^2
+    return (int16_t)(se->a / (10 << SPEED_Q));
+}
+
+uint8_t speed_confidence(const struct speed_est* se)
+{
+    return se->confidence;
+}
\ No newline at end of file
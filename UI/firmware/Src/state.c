@@ -24,6 +24,12 @@
  */
 
 #include "state.h"
+#include "journal.h"
+#include "persist.h"
+#include "ridelog.h"
+#include "faultlog.h"
+#include "profile.h"
+#include "crc.h"
 #include "version.h"
 
 #include <lrr_eeprom_24LC256.h>
@@ -36,8 +42,32 @@
 
 #define EEPROM_CONSTANTS_CONF   (EEPROM_PAGE * 0)
 #define EEPROM_VEHICLE_CONF     (EEPROM_PAGE * 1)
+// runtime of firmwares before the journal, read once for migration
 #define EEPROM_RUNTIME_1        (EEPROM_PAGE * 2)
 #define EEPROM_FAULTS           (EEPROM_PAGE * 3)
+#define EEPROM_RINT_HISTORY     (EEPROM_PAGE * 4)
+// pages 5-8, 64 slots
+#define EEPROM_RUNTIME_JOURNAL  (EEPROM_PAGE * 5)
+#define RUNTIME_JOURNAL_SLOTS   (EEPROM_PAGE * 4 / JOURNAL_SLOT)
+// a write page per trip: the running trips 1 and 2, then the archive
+#define EEPROM_TRIPS            (EEPROM_PAGE * 9)
+#define TRIP_SLOT               64
+// the cycle histogram, then the open reversals a write page further
+#define EEPROM_RAINFLOW         (EEPROM_PAGE * 10)
+#define RAINFLOW_SLOT           64
+// two profile copies, written in turns by seq: a cut write leaves the
+// other one; the second one fits behind the rainflow slots
+#define EEPROM_PROFILE          (EEPROM_PAGE * 11)
+#define EEPROM_PROFILE_2        (EEPROM_RAINFLOW + 2 * RAINFLOW_SLOT)
+// seq (u32 LE) | profile image | crc16 of both
+#define PROFILE_COPY            (4 + PROFILE_SIZE + 2)
+// a write page per charge session, a ring by seq
+#define EEPROM_CHARGES          (EEPROM_PAGE * 12)
+#define CHARGE_SLOT             64
+#define CHARGE_SLOTS            (EEPROM_PAGE / CHARGE_SLOT)
+// pages 13-31 hold the ride log, 304 blocks
+#define EEPROM_RIDE_LOG         (EEPROM_PAGE * 13)
+#define RIDE_LOG_BLOCKS         (EEPROM_PAGE * 19 / RIDELOG_BLOCK)
 
 #define DEF_BATT_P      17
 #define DEF_BATT_S      20
@@ -50,6 +80,95 @@
 #define DEF_BATT_T      60
 #define DEF_DRV_T       90
 
+static struct journal runtime_journal;
+static uint8_t runtime_journal_open;
+
+// the queue needs the data until written, hence the copies
+struct async_save
+{
+    uint8_t pending;
+    eeprom_async_cb cb;
+    void* ctx;
+};
+
+// brown-out commit: the image is encoded by the main loop, the
+// interrupt only seals and writes it; two buffers so the interrupt
+// never sees one half encoded
+static uint8_t commit_image[2][PERSIST_RUNTIME_SIZE];
+static volatile uint8_t commit_idx;
+static volatile uint8_t commit_ready;
+static volatile uint8_t committed;
+
+static struct async_save conf_save;
+static uint8_t conf_pending[PERSIST_CONF_SIZE];
+static struct async_save rint_save;
+static uint8_t rint_pending[PERSIST_RINT_SIZE];
+static struct async_save trip_live_save;
+static uint8_t trip_live_pending[2 * TRIP_SLOT];
+static struct async_save trip_save;
+static uint8_t trip_pending[PERSIST_TRIP_SIZE];
+static struct async_save rainflow_save;
+static uint8_t rainflow_pending[2 * RAINFLOW_SLOT];
+static struct async_save charge_save;
+static uint8_t charge_pending[PERSIST_CHARGE_SIZE];
+static struct async_save profile_save;
+// also the read buffer at the boot, too large for the stack
+static uint8_t profile_pending[PROFILE_COPY];
+// of the newest copy written, the next one goes to the other address
+static uint32_t profile_seq;
+static eeprom_async_cb profile_cb;
+static void* profile_ctx;
+
+static void _save_done(void* ctx, int err)
+{
+    struct async_save* s = (struct async_save*)ctx;
+
+    s->pending = 0;
+    if (s->cb) {
+        s->cb(s->ctx, err);
+    }
+}
+
+// `image` was encoded into the pending buffer of `s`
+static int _save_async(struct async_save* s, uint16_t addr,
+    const uint8_t* image, uint16_t size, eeprom_async_cb cb, void* ctx)
+{
+    s->cb = cb;
+    s->ctx = ctx;
+    if (eeprom_async_write(addr, image, size, _save_done, s)) {
+        return 1;
+    }
+    s->pending = 1;
+    return 0;
+}
+
+static HAL_StatusTypeDef _runtime_read(uint16_t addr, uint8_t* d,
+    uint16_t s)
+{
+    // NACKed in a write cycle, fails at once rather than in the driver
+    if (!eeprom_port_ready()) {
+        return HAL_ERROR;
+    }
+    return eeprom_24lc256_read(addr, d, s);
+}
+
+// 2 when the ring could not be read, see journal_open()
+static int _open_runtime_journal(struct vehicle_runtime* vr)
+{
+    uint8_t b[PERSIST_RUNTIME_SIZE];
+    int ret;
+
+    journal_init(&runtime_journal, EEPROM_RUNTIME_JOURNAL,
+        RUNTIME_JOURNAL_SLOTS, PERSIST_RUNTIME_SIZE,
+        _runtime_read, eeprom_24lc256_write);
+    runtime_journal_open = 1;
+    ret = journal_open(&runtime_journal, b);
+    if (ret) {
+        return ret;
+    }
+    return persist_decode_runtime(vr, b, PERSIST_RUNTIME_SIZE);
+}
+
 void init_eeprom_constants(struct eeprom_constants* ec)
 {
     ec->magic = EEPROM_MAGIC;
@@ -110,12 +229,12 @@ void init_vehicle_conf(struct vehicle_conf* vc)
 int load_vehicle_conf(struct vehicle_conf* vc)
 {
     HAL_StatusTypeDef ret;
+    uint8_t b[PERSIST_CONF_BUF];
     
-    ret = eeprom_24lc256_read(EEPROM_VEHICLE_CONF, 
-        (uint8_t*)vc, sizeof(struct vehicle_conf));
+    ret = eeprom_24lc256_read(EEPROM_VEHICLE_CONF, b, sizeof(b));
     
     if (ret == HAL_OK) {
-        return 0;
+        return persist_decode_conf(vc, b, sizeof(b));
     }
 
     return 1;
@@ -124,9 +243,10 @@ int load_vehicle_conf(struct vehicle_conf* vc)
 int save_vehicle_conf(const struct vehicle_conf* vc)
 {
     HAL_StatusTypeDef ret;
+    uint8_t b[PERSIST_CONF_SIZE];
     
-    ret = eeprom_24lc256_write(EEPROM_VEHICLE_CONF, 
-        (const uint8_t*)vc, sizeof(struct vehicle_conf));
+    ret = eeprom_24lc256_write(EEPROM_VEHICLE_CONF, b,
+        persist_encode_conf(vc, b));
     
     if (ret == HAL_OK) {
         return 0;
@@ -135,6 +255,17 @@ int save_vehicle_conf(const struct vehicle_conf* vc)
     return 1;
 }
 
+int save_vehicle_conf_async(const struct vehicle_conf* vc,
+    eeprom_async_cb cb, void* ctx)
+{
+    if (conf_save.pending) {
+        return 1;
+    }
+
+    return _save_async(&conf_save, EEPROM_VEHICLE_CONF, conf_pending,
+        persist_encode_conf(vc, conf_pending), cb, ctx);
+}
+
 void init_vehicle_runtime(struct vehicle_runtime* vr)
 {
     memset(vr, 0, sizeof(struct vehicle_runtime));
@@ -143,27 +274,403 @@ void init_vehicle_runtime(struct vehicle_runtime* vr)
 int load_vehicle_runtime(struct vehicle_runtime* vr)
 {
     HAL_StatusTypeDef ret;
-    
-    ret = eeprom_24lc256_read(EEPROM_RUNTIME_1, 
-        (uint8_t*)vr, sizeof(struct vehicle_runtime));
+    uint8_t b[PERSIST_LEGACY_RUNTIME_SIZE];
+
+    if (_open_runtime_journal(vr) == 0) {
+        return 0;
+    }
+
+    // nothing journaled yet, the first save moves it to the journal
+    ret = eeprom_24lc256_read(EEPROM_RUNTIME_1, b, sizeof(b));
     
     if (ret == HAL_OK) {
-        return 0;
+        return persist_decode_runtime(vr, b, sizeof(b));
     }
 
     return 1;
 }
 
 int save_vehicle_runtime(const struct vehicle_runtime* vr)
+{
+    uint8_t b[PERSIST_RUNTIME_SIZE];
+
+    if (!runtime_journal_open) {
+        // virgin mode saves without loading first
+        struct vehicle_runtime stored;
+        _open_runtime_journal(&stored);
+    }
+
+    // only the changed fields get written
+    persist_encode_runtime(vr, b);
+    return journal_append(&runtime_journal, b);
+}
+
+int save_vehicle_runtime_async(const struct vehicle_runtime* vr,
+    eeprom_async_cb cb, void* ctx)
+{
+    if (!runtime_journal_open) {
+        // only after load_vehicle_runtime() or save_vehicle_runtime()
+        return 1;
+    }
+
+    uint8_t b[PERSIST_RUNTIME_SIZE];
+
+    // the journal keeps its own copy
+    persist_encode_runtime(vr, b);
+    return journal_append_async(&runtime_journal, b, cb, ctx);
+}
+
+void prepare_vehicle_runtime_commit(const struct vehicle_runtime* vr)
+{
+    uint8_t idx = !commit_idx;
+
+    persist_encode_runtime(vr, commit_image[idx]);
+    commit_idx = idx;
+    commit_ready = 1;
+}
+
+int commit_vehicle_runtime(void)
+{
+    uint8_t rec[JOURNAL_SLOT];
+    uint16_t addr;
+    uint8_t size;
+
+    if (!runtime_journal_open || !commit_ready) {
+        return 1;
+    }
+
+    // nothing queued may follow and overwrite it
+    eeprom_async_halt();
+    size = journal_seal(&runtime_journal, commit_image[commit_idx], rec,
+        &addr);
+    committed = 1;
+
+    if (eeprom_port_write_now(addr, rec, size) != HAL_OK) {
+        return 1;
+    }
+    return 0;
+}
+
+uint8_t vehicle_runtime_committed(void)
+{
+    return committed;
+}
+
+void recover_vehicle_runtime_commit(void)
+{
+    struct vehicle_runtime stored;
+
+    // the commit may still be in its write cycle, the logic calls again
+    // on its next pass
+    if (!eeprom_port_ready()) {
+        return;
+    }
+    if (committed == 1) {
+        // the queue is stale after the commit, the dropped saves clear
+        // their pending flags in their callbacks
+        eeprom_async_init();
+        committed = 2;
+    }
+    // so is the journal state; opened from a ring that could not be read
+    // it would restart at seq 0 and the next boot would take its records
+    // for older ones, it stays closed until a read gets through
+    if (_open_runtime_journal(&stored) == 2) {
+        runtime_journal_open = 0;
+        return;
+    }
+    committed = 0;
+}
+
+const struct journal* vehicle_runtime_journal(void)
+{
+    return &runtime_journal;
+}
+
+void init_rint_history(struct rint_history* rh)
+{
+    memset(rh, 0, sizeof(struct rint_history));
+}
+
+int load_rint_history(struct rint_history* rh)
+{
+    HAL_StatusTypeDef ret;
+    uint8_t b[PERSIST_RINT_BUF];
+    
+    ret = eeprom_24lc256_read(EEPROM_RINT_HISTORY, b, sizeof(b));
+    
+    if (ret == HAL_OK) {
+        return persist_decode_rint(rh, b, sizeof(b));
+    }
+
+    return 1;
+}
+
+int save_rint_history(const struct rint_history* rh)
 {
     HAL_StatusTypeDef ret;
+    uint8_t b[PERSIST_RINT_SIZE];
     
-    ret = eeprom_24lc256_write(EEPROM_RUNTIME_1, 
-        (const uint8_t*)vr, sizeof(struct vehicle_runtime));
+    ret = eeprom_24lc256_write(EEPROM_RINT_HISTORY, b,
+        persist_encode_rint(rh, b));
     
     if (ret == HAL_OK) {
         return 0;
     }
 
     return 1;
+}
+
+int save_rint_history_async(const struct rint_history* rh,
+    eeprom_async_cb cb, void* ctx)
+{
+    if (rint_save.pending) {
+        return 1;
+    }
+
+    return _save_async(&rint_save, EEPROM_RINT_HISTORY, rint_pending,
+        persist_encode_rint(rh, rint_pending), cb, ctx);
+}
+
+void init_rainflow(struct rainflow* rf)
+{
+    memset(rf, 0, sizeof(struct rainflow));
+}
+
+int load_rainflow(struct rainflow* rf)
+{
+    uint8_t b[PERSIST_REVERSALS_SIZE];
+
+    init_rainflow(rf);
+    if (eeprom_24lc256_read(EEPROM_RAINFLOW, b, PERSIST_CYCLES_SIZE) != HAL_OK
+        || persist_decode_cycles(rf, b, PERSIST_CYCLES_SIZE)) {
+        return 1;
+    }
+    // without them the counting restarts from the next sample
+    if (eeprom_24lc256_read(EEPROM_RAINFLOW + RAINFLOW_SLOT, b, sizeof(b))
+        != HAL_OK || persist_decode_reversals(rf, b, sizeof(b))) {
+        rf->count = 0;
+    }
+    return 0;
+}
+
+int save_rainflow_async(const struct rainflow* rf,
+    eeprom_async_cb cb, void* ctx)
+{
+    if (rainflow_save.pending) {
+        return 1;
+    }
+
+    // both images in one request, the rest of the first slot goes out
+    // as 0xff; it is in the same write page, no extra write cycle
+    memset(rainflow_pending, 0xff, sizeof(rainflow_pending));
+    persist_encode_cycles(rf, rainflow_pending);
+    persist_encode_reversals(rf, rainflow_pending + RAINFLOW_SLOT);
+    return _save_async(&rainflow_save, EEPROM_RAINFLOW, rainflow_pending,
+        RAINFLOW_SLOT + PERSIST_REVERSALS_SIZE, cb, ctx);
+}
+
+int load_charge_last(struct charge_session* cs)
+{
+    uint8_t b[PERSIST_CHARGE_SIZE];
+    struct charge_session s;
+
+    memset(cs, 0, sizeof(struct charge_session));
+    for (uint8_t i = 0; i < CHARGE_SLOTS; ++i) {
+        if (eeprom_24lc256_read(EEPROM_CHARGES + i * CHARGE_SLOT, b,
+                sizeof(b)) != HAL_OK) {
+            return 1;
+        }
+        if (!persist_decode_charge(&s, b, sizeof(b))
+            && s.seq % CHARGE_SLOTS == i && s.seq > cs->seq) {
+            *cs = s;
+        }
+    }
+    return cs->seq == 0;
+}
+
+int save_charge_async(const struct charge_session* cs,
+    eeprom_async_cb cb, void* ctx)
+{
+    if (cs->seq == 0 || charge_save.pending) {
+        return 1;
+    }
+
+    return _save_async(&charge_save,
+        EEPROM_CHARGES + (cs->seq % CHARGE_SLOTS) * CHARGE_SLOT,
+        charge_pending, persist_encode_charge(cs, charge_pending), cb, ctx);
+}
+
+static uint16_t _profile_addr(uint32_t seq)
+{
+    return (seq & 1) ? EEPROM_PROFILE_2 : EEPROM_PROFILE;
+}
+
+// reads the copy into profile_pending, 1 when its CRC does not match
+static int _read_profile_copy(uint32_t seq, uint32_t* stored_seq)
+{
+    uint8_t* b = profile_pending;
+
+    if (eeprom_24lc256_read(_profile_addr(seq), b, PROFILE_COPY) != HAL_OK
+        || crc16(CRC16_INIT, b, PROFILE_COPY - 2)
+            != (b[PROFILE_COPY - 2] | (b[PROFILE_COPY - 1] << 8))) {
+        return 1;
+    }
+    *stored_seq = b[0] | (b[1] << 8) | ((uint32_t)b[2] << 16)
+        | ((uint32_t)b[3] << 24);
+    return 0;
+}
+
+int load_profile(struct profile* p)
+{
+    uint32_t seq[2];
+    int err[2];
+
+    profile_seq = 0;
+    err[0] = _read_profile_copy(0, &seq[0]);
+    err[1] = _read_profile_copy(1, &seq[1]);
+    // the buffer holds the second copy now
+    if (!err[1] && (err[0] || seq[1] > seq[0])
+        && profile_decode(p, profile_pending + 4, PROFILE_SIZE) == 0) {
+        profile_seq = seq[1];
+        return 0;
+    }
+
+    if (err[0] || _read_profile_copy(0, &seq[0])
+        || profile_decode(p, profile_pending + 4, PROFILE_SIZE)) {
+        return 1;
+    }
+    profile_seq = seq[0];
+    return 0;
+}
+
+static void _profile_saved(void* ctx, int err)
+{
+    (void)ctx;
+    // a failed copy is written again, the other one stays intact
+    if (!err) {
+        ++profile_seq;
+    }
+    if (profile_cb) {
+        profile_cb(profile_ctx, err);
+    }
+}
+
+int save_profile_async(const struct profile* p,
+    eeprom_async_cb cb, void* ctx)
+{
+    uint8_t* b = profile_pending;
+    uint32_t seq = profile_seq + 1;
+
+    if (profile_save.pending) {
+        return 1;
+    }
+
+    b[0] = seq;
+    b[1] = seq >> 8;
+    b[2] = seq >> 16;
+    b[3] = seq >> 24;
+    profile_encode(p, b + 4);
+    uint16_t crc = crc16(CRC16_INIT, b, PROFILE_COPY - 2);
+    b[PROFILE_COPY - 2] = crc;
+    b[PROFILE_COPY - 1] = crc >> 8;
+
+    profile_cb = cb;
+    profile_ctx = ctx;
+    return _save_async(&profile_save, _profile_addr(seq), b, PROFILE_COPY,
+        _profile_saved, NULL);
+}
+
+static uint16_t _trip_slot_addr(uint32_t seq)
+{
+    return EEPROM_TRIPS + (2 + seq % TRIP_ARCHIVE) * TRIP_SLOT;
+}
+
+int load_trip_live(struct trip_summary* live)
+{
+    uint8_t b[PERSIST_TRIP_SIZE];
+    int err = 0;
+
+    for (uint8_t i = 0; i < 2; ++i) {
+        if (eeprom_24lc256_read(EEPROM_TRIPS + i * TRIP_SLOT, b, sizeof(b))
+            != HAL_OK || persist_decode_trip(&live[i], b, sizeof(b))) {
+            err = 1;
+        }
+    }
+    return err;
+}
+
+int save_trip_live_async(const struct trip_summary* live,
+    eeprom_async_cb cb, void* ctx)
+{
+    if (trip_live_save.pending) {
+        return 1;
+    }
+
+    // both slots in one request, the gap between them goes out as 0xff;
+    // it shares their write pages, so it costs no extra write cycle
+    memset(trip_live_pending, 0xff, sizeof(trip_live_pending));
+    persist_encode_trip(&live[0], trip_live_pending);
+    persist_encode_trip(&live[1], trip_live_pending + TRIP_SLOT);
+    return _save_async(&trip_live_save, EEPROM_TRIPS, trip_live_pending,
+        TRIP_SLOT + PERSIST_TRIP_SIZE, cb, ctx);
+}
+
+void init_trip_archive(struct trip_archive* ta)
+{
+    memset(ta, 0, sizeof(struct trip_archive));
+    ta->next_seq = 1;
+}
+
+int load_trip_archive(struct trip_archive* ta)
+{
+    uint8_t b[PERSIST_TRIP_SIZE];
+    struct trip_summary ts;
+
+    init_trip_archive(ta);
+    for (uint8_t i = 0; i < TRIP_ARCHIVE; ++i) {
+        if (eeprom_24lc256_read(EEPROM_TRIPS + (2 + i) * TRIP_SLOT, b,
+                sizeof(b)) != HAL_OK) {
+            return 1;
+        }
+        if (persist_decode_trip(&ts, b, sizeof(b)) || ts.seq == 0
+            || ts.seq % TRIP_ARCHIVE != i) {
+            continue;
+        }
+
+        // insertion by seq, at most TRIP_ARCHIVE of them
+        uint8_t k = ta->count++;
+        while (k > 0 && ta->trips[k - 1].seq > ts.seq) {
+            ta->trips[k] = ta->trips[k - 1];
+            --k;
+        }
+        ta->trips[k] = ts;
+        if (ts.seq >= ta->next_seq) {
+            ta->next_seq = ts.seq + 1;
+        }
+    }
+    return 0;
+}
+
+int save_trip_async(const struct trip_archive* ta,
+    eeprom_async_cb cb, void* ctx)
+{
+    if (ta->count == 0 || trip_save.pending) {
+        return 1;
+    }
+
+    const struct trip_summary* ts = &ta->trips[ta->count - 1];
+    return _save_async(&trip_save, _trip_slot_addr(ts->seq), trip_pending,
+        persist_encode_trip(ts, trip_pending), cb, ctx);
+}
+
+int open_ride_log(struct ridelog* rl)
+{
+    ridelog_init(rl, EEPROM_RIDE_LOG, RIDE_LOG_BLOCKS, eeprom_24lc256_read);
+    return ridelog_open(rl);
+}
+
+int open_fault_log(struct faultlog* fl)
+{
+    faultlog_init(fl, EEPROM_FAULTS);
+    return faultlog_open(fl);
 }
\ No newline at end of file
@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#include "thermal.h"
+
+#include <string.h>
+
+#define Q       16
+// of the load
+#define QL      8
+// of the sensitivities
+#define QS      4
+
+static int32_t _q(int16_t c)
+{
+    return (int32_t)c << Q;
+}
+
+// ln(r), r >= 1, both Q16: log2 from the leading bit and
+// log2(1 + x) ~ x * (1.3465 - 0.3465 * x) on the mantissa
+static uint32_t _ln_q16(uint32_t r)
+{
+    uint8_t n = 31 - __builtin_clz(r);
+    uint32_t x = (n > 16) ? r >> (n - 16) : r << (16 - n);
+
+    x -= 1 << 16;
+    uint32_t log2 = ((uint32_t)(n - 16) << 16)
+        + (uint32_t)(((uint64_t)x * (88245 - ((22708 * x) >> 16))) >> 16);
+    return ((uint64_t)log2 * 45426) >> 16;
+}
+
+void thermal_init(struct thermal* th, int16_t ambient_c)
+{
+    memset(th, 0, sizeof(struct thermal));
+    th->ta = _q(ambient_c);
+    th->tw = th->ta;
+    th->ts = th->ta;
+    th->g = THERMAL_G_DEF;
+}
+
+void thermal_current(struct thermal* th, int16_t amper_da, uint32_t dt_ms)
+{
+    uint32_t da2 = (int32_t)amper_da * amper_da;
+
+    th->acc_a2ms += da2 * dt_ms / 100;
+}
+
+void thermal_ambient(struct thermal* th, int16_t ambient_c)
+{
+    th->ta = _q(ambient_c);
+}
+
+void thermal_step(struct thermal* th, uint32_t dt_ms)
+{
+    if (dt_ms == 0) {
+        return;
+    }
+
+    // g * integral of I^2, Q24 * A^2 s to Q16
+    int32_t heat = ((int64_t)th->g * th->acc_a2ms / 1000) >> (24 - Q);
+    int32_t loss = (int64_t)(th->tw - th->ta) * dt_ms
+        / (THERMAL_TAU_W_S * 1000);
+    th->tw += heat - loss;
+    th->ts += (int64_t)(th->tw - th->ts) * dt_ms / (THERMAL_TAU_S_S * 1000);
+
+    // the same nodes driven by I^2 alone
+    th->sw += ((uint64_t)th->acc_a2ms << QS) / 1000
+        - (int64_t)th->sw * dt_ms / (THERMAL_TAU_W_S * 1000);
+    th->ss += (int64_t)(th->sw - th->ss) * dt_ms / (THERMAL_TAU_S_S * 1000);
+
+    int32_t a2 = ((uint64_t)th->acc_a2ms << QL) / dt_ms;
+    th->load += (int64_t)(a2 - th->load) * dt_ms
+        / (THERMAL_LOAD_TAU_MS + dt_ms);
+    th->acc_a2ms = 0;
+}
+
+void thermal_measure(struct thermal* th, int16_t moto_c)
+{
+    if (!th->primed) {
+        // the motor rested, all of it at the reading
+        th->primed = 1;
+        th->tw = _q(moto_c);
+        th->ts = th->tw;
+        return;
+    }
+
+    int32_t e = _q(moto_c) - th->ts;
+    th->ts += (e * THERMAL_L_S) >> 8;
+    th->tw += (e * THERMAL_L_W) >> 8;
+
+    // normalized gradient: e * s / (s^2 + floor^2), Q16 C * Q4 A^2 s
+    // over Q8 (A^2 s)^2 to Q24 C/s per A^2
+    const int64_t floor = (int64_t)THERMAL_CAL_MIN_A2 * THERMAL_TAU_W_S << QS;
+    int64_t den = (int64_t)th->ss * th->ss + floor * floor;
+    int64_t dg = ((int64_t)e * th->ss << (24 + 2 * QS - Q - QS)) / den;
+    th->g += dg >> THERMAL_CAL_SHIFT;
+    if (th->g < THERMAL_G_MIN) {
+        th->g = THERMAL_G_MIN;
+    } else if (th->g > THERMAL_G_MAX) {
+        th->g = THERMAL_G_MAX;
+    }
+}
+
+int16_t thermal_winding_c(const struct thermal* th)
+{
+    return (th->tw + (1 << (Q - 1))) >> Q;
+}
+
+uint16_t thermal_time_to(const struct thermal* th, int16_t limit_c)
+{
+    int32_t limit = _q(limit_c);
+
+    if (th->tw >= limit) {
+        return 0;
+    }
+
+    // Q24 C/s per A^2 * Q8 A^2 over the time constant, to Q16 C
+    int64_t tss = th->ta + (((int64_t)th->g * th->load * THERMAL_TAU_W_S)
+        >> (24 + QL - Q));
+    if (tss <= limit) {
+        return THERMAL_NEVER;
+    }
+
+    // the ratio of the distances to the end, Q16
+    int64_t r = ((tss - th->tw) << 16) / (tss - limit);
+    if (r > UINT32_MAX) {
+        return THERMAL_NEVER - 1;
+    }
+    uint32_t s = ((uint64_t)_ln_q16((uint32_t)r) * THERMAL_TAU_W_S) >> 16;
+    return (s >= THERMAL_NEVER) ? THERMAL_NEVER - 1 : s;
+}
\ No newline at end of file
@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2020 Rafal Rowniak rrowniak.com
+ * 
+ * The author hereby grant you a non-exclusive, non-transferable,
+ * free of charge right to copy, modify, merge, publish and distribute,
+ * the Software for the sole purpose of performing non-commercial
+ * scientific research, non-commercial education, or non-commercial 
+ * artistic projects.
+ * 
+ * Any other use, in particular any use for commercial purposes,
+ * is prohibited. This includes, without limitation, incorporation
+ * in a commercial product, use in a commercial service, or production
+ * of other artefacts for commercial purposes.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+ * THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ */
+
+#include "trip.h"
+#include "persist.h"
+#include "export.h"
+
+#include <string.h>
+
+// 0.1 Wh in mWs, 1 mAh in 0.1 A ms
+#define DWH_MWS     360000
+#define MAH_DAMS    36000
+
+// the frame after the last one exported, TRIP_ARCHIVE + 1 when idle
+static uint8_t exp_idx = TRIP_ARCHIVE + 1;
+
+static int8_t _clamp_i8(int16_t v)
+{
+    return (v < INT8_MIN) ? INT8_MIN : (v > INT8_MAX) ? INT8_MAX : v;
+}
+
+static void _max_i8(int8_t* m, int16_t v)
+{
+    int8_t c = _clamp_i8(v);
+
+    if (c > *m) {
+        *m = c;
+    }
+}
+
+// adds `v` units of 1/`unit` to `acc`, keeping the remainder in `rem`
+static void _carry(uint32_t* acc, uint32_t* rem, uint32_t v, uint32_t unit)
+{
+    *rem += v;
+    if (*rem >= unit) {
+        *acc += *rem / unit;
+        *rem %= unit;
+    }
+}
+
+void trip_start(struct trip* t, uint8_t which)
+{
+    memset(t, 0, sizeof(struct trip));
+    t->s.trip = which;
+    t->s.max_moto_temp = INT8_MIN;
+    t->s.max_driver_temp = INT8_MIN;
+    t->s.max_batt_temp = INT8_MIN;
+}
+
+void trip_resume(struct trip* t, const struct trip_summary* s,
+    uint32_t consumed_mah)
+{
+    uint8_t which = t->s.trip;
+
+    memset(t, 0, sizeof(struct trip));
+    t->s = *s;
+    t->s.trip = which;
+    t->s.seq = 0;
+    t->consumed_mah = consumed_mah;
+}
+
+void trip_update(struct trip* t, const struct trip_frame* f)
+{
+    struct trip_summary* s = &t->s;
+
+    s->dist_m = f->dist_m;
+    if (f->speed_dkmh) {
+        _carry(&s->moving_s, &t->moving_ms, f->dt_ms, 1000);
+    }
+    if (f->speed_dkmh > s->max_dkmh) {
+        s->max_dkmh = f->speed_dkmh;
+    }
+
+    _carry(&s->consumed_dWh, &t->consumed_mWs, f->consumed_mWs, DWH_MWS);
+    _carry(&s->recovered_dWh, &t->recovered_mWs, f->recovered_mWs,
+        DWH_MWS);
+    if (f->amper_da > 0) {
+        _carry(&t->consumed_mah, &t->consumed_dAms,
+            (uint32_t)f->amper_da * f->dt_ms, MAH_DAMS);
+    }
+
+    _max_i8(&s->max_moto_temp, f->moto_temp);
+    _max_i8(&s->max_driver_temp, f->driver_temp);
+    _max_i8(&s->max_batt_temp, f->batt_temp);
+}
+
+uint16_t trip_avg_dkmh(const struct trip_summary* s)
+{
+    if (s->moving_s == 0) {
+        return 0;
+    }
+    // m/s * 36 == 0.1 km/h
+    return (uint64_t)s->dist_m * 36 / s->moving_s;
+}
+
+void trip_archive_put(struct trip_archive* ta, struct trip* t,
+    uint32_t end_m)
+{
+    if (ta->count == TRIP_ARCHIVE) {
+        memmove(&ta->trips[0], &ta->trips[1],
+            (TRIP_ARCHIVE - 1) * sizeof(struct trip_summary));
+        --ta->count;
+    }
+
+    struct trip_summary* s = &ta->trips[ta->count++];
+    *s = t->s;
+    s->seq = ta->next_seq++;
+    s->end_m = end_m;
+
+    trip_start(t, t->s.trip);
+}
+
+const struct trip_summary* trip_archive_get(const struct trip_archive* ta,
+    uint8_t k)
+{
+    return (k < ta->count) ? &ta->trips[ta->count - 1 - k] : NULL;
+}
+
+int trip_export_start(void)
+{
+    if (exp_idx <= TRIP_ARCHIVE) {
+        return 1;
+    }
+    exp_idx = 0;
+    return 0;
+}
+
+void trip_export_poll(const struct trip_archive* ta)
+{
+    if (exp_idx > TRIP_ARCHIVE) {
+        return;
+    }
+
+    uint8_t b[PERSIST_TRIP_SIZE] = { 0 };
+
+    if (exp_idx >= ta->count) {
+        if (!export_frame(EXPORT_TRIPS, ta->count, b, 0)) {
+            exp_idx = TRIP_ARCHIVE + 1;
+        }
+    } else if (!export_frame(EXPORT_TRIPS, exp_idx, b,
+            persist_encode_trip(&ta->trips[exp_idx], b))) {
+        ++exp_idx;
+    }
+}
\ No newline at end of file
@@ -26,70 +26,449 @@
 #include "ui.h"
 #include "system.h"
 #include "version.h"
+#include "lcd_bus.h"
+#include "fmt.h"
+#include "lcd_gfx.h"
+#include "ui_layout.h"
+#include "present.h"
 #include <lrr_hd44780.h>
-#include <stdio.h>
 #include <string.h>
 #include <assert.h>
 
-#define MAX_LINE 16
+#define MAX_LINE UI_COLS
 
 static enum display_mode mode;
 static uint8_t current = 1;
-static char lcd_line[17];
+static uint8_t alarm = 0;
+static uint8_t charging = 0;
+static struct gfx_spark power_spark;
+// the point of power_spark being averaged
+static uint32_t spark_sum_w;
+static uint8_t spark_ticks;
+static struct vehicle_gauges presented;
+
+// fields running past MAX_LINE spill into the second half and get cut off
+static char lines[UI_ROWS][2 * MAX_LINE + 1];
+static char scratch[2 * MAX_LINE + 1];
+// what the display shows
+static char shown[UI_ROWS][MAX_LINE];
+// lcd_bus was polling the busy flag at the last frame
+static uint8_t busy_flag_used;
+
+// ----------------------------------------------------------------------------
+// screen layouts
+// ----------------------------------------------------------------------------
+
+// "84.0V 100% 10.0A"
+static const struct ui_field status_current[] = {
+    UI_GAUGE(1, 0, batt_dv, 1, "V", 0, 100),
+    UI_NUM(1, 6, 4, batt_perc, 0, 0, 0, "%", 0, 100),
+    UI_GAUGE(1, 11, amper_da, 1, "A", 0, 100),
+};
+
+// "84.0V 100%  21C"
+static const struct ui_field status_no_current[] = {
+    UI_GAUGE(1, 0, batt_dv, 1, "V", 0, 100),
+    UI_NUM(1, 6, 4, batt_perc, 0, 0, 0, "%", 0, 100),
+    UI_NUM(1, 11, 5, ambient_temp, 0, 0, 0, "C", 0, 5000),
+};
+
+// "OFFLINE!"
+static const struct ui_field status_offline[] = {
+    UI_TEXT(1, 0, "OFFLINE!"),
+};
+
+// "25 km/h 1234.5km"
+static const struct ui_field scr_default[] = {
+    UI_NUM(0, 0, 2, speed_dkmh, 1, 0, 0, "", 0, 200),
+    UI_TEXT(0, 3, "km/h"),
+    UI_NUM(0, 7, 9, total_m, 3, 1, 0, "km", UF_TRUNC, 1000),
+};
+
+// "25 km/h  12.3km-1", no decimals from 100km on
+static const struct ui_field scr_trip1[] = {
+    UI_NUM(0, 0, 2, speed_dkmh, 1, 0, 0, "", 0, 200),
+    UI_TEXT(0, 3, "km/h"),
+    UI_NUM(0, 8, 6, trip1_m, 3, 1, 0, "km", UF_TRUNC, 1000),
+    UI_TEXT(0, 14, "-1"),
+};
+
+static const struct ui_field scr_trip2[] = {
+    UI_NUM(0, 0, 2, speed_dkmh, 1, 0, 0, "", 0, 200),
+    UI_TEXT(0, 3, "km/h"),
+    UI_NUM(0, 8, 6, trip2_m, 3, 1, 0, "km", UF_TRUNC, 1000),
+    UI_TEXT(0, 14, "-2"),
+};
+
+// " 25C 80C 30C 28C"
+static const struct ui_field scr_temp[] = {
+    UI_NUM(0, 0, 4, ambient_temp, 0, 0, 0, "C", 0, 5000),
+    UI_NUM(0, 4, 4, moto_temp, 0, 0, 0, "C", UF_CLAMP0, 5000),
+    UI_NUM(0, 8, 4, driver_temp, 0, 0, 0, "C", UF_CLAMP0, 5000),
+    UI_NUM(0, 12, 4, batt_temp, 0, 0, 0, "C", UF_CLAMP0, 5000),
+};
+
+// " -12.3Wh  +1.2Wh"
+static const struct ui_field scr_power[] = {
+    UI_NUM(0, 0, 8, consumed_dWh, 1, 1, '-', "Wh", 0, 1000),
+    UI_NUM(0, 8, 8, brake_dWh, 1, 1, '+', "Wh", 0, 1000),
+};
+
+// "+ 840W 63.7Wh/km"
+static const struct ui_field scr_power2[] = {
+    UI_GAUGE(0, 0, power_cw, 2, "W", UF_REGEN_PLUS, 100),
+    UI_GAUGE(0, 7, dWh_km, 1, "Wh/km", 0, 1000),
+};
+
+// "######=   + 840W"
+static const struct ui_field scr_bar[] = {
+    UI_BAR(0, 0, 10, batt_perc, 100),
+    UI_GAUGE(0, 10, power_cw, 2, "W", UF_REGEN_PLUS, 100),
+};
+
+// "  _.-=#=-.  840W"
+static const struct ui_field scr_spark[] = {
+    UI_SPARK(0, 0, 10, &power_spark),
+    UI_GAUGE(0, 10, power_cw, 2, "W", UF_REGEN_PLUS, 100),
+};
+
+// "1k 63.7  5k 58.2"
+static const struct ui_field scr_roll_dist[] = {
+    UI_TEXT(0, 0, "1k"),
+    UI_NUM(0, 2, 5, dWh_km_1km, 1, 1, 0, "", 0, 1000),
+    UI_TEXT(0, 9, "5k"),
+    UI_NUM(0, 11, 5, dWh_km_5km, 1, 1, 0, "", 0, 1000),
+};
+
+// "10m 61.2  25km/h"
+static const struct ui_field scr_roll_time[] = {
+    UI_TEXT(0, 0, "10m"),
+    UI_NUM(0, 3, 5, dWh_km_10min, 1, 1, 0, "", 0, 1000),
+    UI_NUM(0, 9, 7, avg_dkmh_10min, 1, 0, 0, "km/h", 0, 1000),
+};
+
+// "  85mOhm 83.1Voc"
+static const struct ui_field scr_batt[] = {
+    UI_NUM(0, 0, 8, rint_mohm, 0, 0, 0, "mOhm", 0, 1000),
+    UI_GAUGE(0, 9, batt_ocv_dv, 1, "Voc", 0, 1000),
+};
+
+// "Range     42.3km", no decimals from 100km on
+static const struct ui_field scr_range[] = {
+    UI_TEXT(0, 0, "Range"),
+    UI_NUM(0, 5, 11, range_m, 3, 1, 0, "km", UF_TRUNC, 1000),
+};
+
+static const char* const fault_names[] = {
+    "No faults", "Amp sens", "Moto Tsens", "Batt Tsens", "Drv Tsens",
+    "MB fault", "MB fault", "MB fault", "MB fault", "MB fault", "MB fault",
+    "MB fault", "Offline", "Moto hot", "Drv hot", "Batt hot", "Fault",
+};
+
+static const char* const fault_states[] = { "", "off", "ON" };
+
+// "Batt Tsens   x3 "
+// "ON      1234.5km"
+static const struct ui_field scr_faults[] = {
+    UI_NAME(0, 0, 10, fault_name, fault_names, UF_LEFT),
+    UI_NUM(0, 10, 5, fault_count, 0, 0, 'x', "", UF_BLANK0, 200),
+    UI_NAME(1, 0, 3, fault_state, fault_states, UF_LEFT),
+    UI_NUM(1, 3, 13, fault_last_m, 3, 1, 0, "km", UF_TRUNC | UF_BLANK0, 200),
+};
+
+// "#1   12.3km  83m"
+// "25/45km/h 12.3Wh"
+static const struct ui_field scr_trips[] = {
+    UI_NUM(0, 0, 3, trip_no, 0, 0, '#', "", UF_LEFT | UF_BLANK0, 200),
+    UI_NUM(0, 4, 7, trip_dist_m, 3, 1, 0, "km", UF_TRUNC, 200),
+    UI_NUM(0, 11, 5, trip_moving_min, 0, 0, 0, "m", 0, 200),
+    UI_NUM(1, 0, 2, trip_avg_dkmh, 1, 0, 0, "", 0, 200),
+    UI_TEXT(1, 2, "/"),
+    UI_NUM(1, 3, 6, trip_max_dkmh, 1, 0, 0, "km/h", UF_LEFT, 200),
+    UI_NUM(1, 10, 6, trip_dWh, 1, 1, 0, "Wh", 0, 200),
+};
+
+static const char* const alarm_names[] = {
+    "", "Motor", "Driver", "Battery",
+};
+
+static const char* const alarm_levels[] = { "", "soon", "HOT!" };
+
+// "Motor   HOT! 95C"
+// "max 90C   2C/min"
+static const struct ui_field scr_alarm[] = {
+    UI_NAME(0, 0, 7, alarm_name, alarm_names, UF_LEFT),
+    UI_NAME(0, 8, 4, alarm_level, alarm_levels, UF_LEFT),
+    UI_NUM(0, 12, 4, alarm_temp, 0, 0, 0, "C", 0, 200),
+    UI_TEXT(1, 0, "max"),
+    UI_NUM(1, 3, 4, alarm_limit, 0, 0, 0, "C", 0, 200),
+    UI_NUM(1, 8, 8, alarm_slope, 0, 0, 0, "C/min", 0, 1000),
+};
+
+static const struct ui_screen alarm_screen = UI_SCREEN(scr_alarm, 0);
+
+// "CHG 82.1V 125min"
+// "   123.4Wh  4.2A"
+static const struct ui_field scr_charge[] = {
+    UI_TEXT(0, 0, "CHG"),
+    UI_GAUGE(0, 4, batt_dv, 1, "V", 0, 1000),
+    UI_NUM(0, 9, 7, charge_min, 0, 0, 0, "min", UF_BLANK0, 1000),
+    UI_NUM(1, 0, 9, charge_dWh, 1, 1, 0, "Wh", 0, 1000),
+    UI_GAUGE(1, 11, charge_da, 1, "A", UF_BLANK0, 1000),
+};
+
+static const struct ui_screen charge_screen = UI_SCREEN(scr_charge, 0);
+
+// "Wind 112C  12min"
+static const struct ui_field scr_motor[] = {
+    UI_TEXT(0, 0, "Wind"),
+    UI_NUM(0, 4, 5, moto_wind_temp, 0, 0, 0, "C", 0, 1000),
+    UI_NUM(0, 9, 7, moto_limit_min, 0, 0, 0, "min", UF_BLANK0, 1000),
+};
+
+// "Cycles     123.4"
+// "deep>60%      12"
+static const struct ui_field scr_cycles[] = {
+    UI_TEXT(0, 0, "Cycles"),
+    UI_NUM(0, 6, 10, batt_cycles_dc, 1, 1, 0, "", 0, 1000),
+    UI_TEXT(1, 0, "deep>60%"),
+    UI_NUM(1, 8, 8, batt_deep_cycles, 0, 0, 0, "", 0, 1000),
+};
+
+static const struct ui_screen screens[DM_LIMIT] = {
+    [DM_DEFAULT] = UI_SCREEN(scr_default, 1),
+    [DM_TRIP1] = UI_SCREEN(scr_trip1, 1),
+    [DM_TRIP2] = UI_SCREEN(scr_trip2, 1),
+    [DM_TEMP] = UI_SCREEN(scr_temp, 1),
+    [DM_POWER] = UI_SCREEN(scr_power, 1),
+    [DM_POWER2] = UI_SCREEN(scr_power2, 1),
+    [DM_BAR] = UI_SCREEN(scr_bar, 1),
+    [DM_SPARK] = UI_SCREEN(scr_spark, 1),
+    [DM_ROLL_DIST] = UI_SCREEN(scr_roll_dist, 1),
+    [DM_ROLL_TIME] = UI_SCREEN(scr_roll_time, 1),
+    [DM_BATT] = UI_SCREEN(scr_batt, 1),
+    [DM_RANGE] = UI_SCREEN(scr_range, 1),
+    [DM_FAULTS] = UI_SCREEN(scr_faults, 0),
+    [DM_TRIPS] = UI_SCREEN(scr_trips, 0),
+    [DM_MOTOR] = UI_SCREEN(scr_motor, 1),
+    [DM_CYCLES] = UI_SCREEN(scr_cycles, 0),
+};
+
+static const struct ui_screen status_screens[] = {
+    UI_SCREEN(status_current, 0),
+    UI_SCREEN(status_no_current, 0),
+    UI_SCREEN(status_offline, 0),
+};
+
+// ----------------------------------------------------------------------------
+// generic renderer
+// ----------------------------------------------------------------------------
+
+struct ui_field_state
+{
+    int32_t value;
+    uint8_t age;
+    uint8_t dirty;
+};
 
-void ui_init(void)
+struct ui_screen_state
 {
-    lcd_init();
-    lcd_on();
-    lcd_clear();
-    lcd_disable_cursor();
+    const struct ui_screen* screen;
+    struct ui_field_state fields[UI_MAX_FIELDS];
+};
+
+static struct ui_screen_state main_state;
+static struct ui_screen_state status_state;
+
+static void _attach(struct ui_screen_state* st, const struct ui_screen* scr)
+{
+    if (st->screen == scr) {
+        return;
+    }
+
+    st->screen = scr;
+    for (uint8_t i = 0; i < scr->count; ++i) {
+        st->fields[i].dirty = 1;
+        // clear the area of the new layout
+        memset(&lines[scr->fields[i].row][0], ' ', MAX_LINE);
+    }
+}
+
+static int32_t _field_value(const struct ui_field* f,
+    const struct vehicle_gauges* vg)
+{
+    if (f->fmt == UF_TEXT || f->fmt == UF_SPARK) {
+        return 0;
+    }
+
+    return ui_gauge_get(vg, f->src, f->src_type);
+}
+
+static inline uint32_t _mag(int32_t v)
+{
+    return (v < 0) ? -(uint32_t)v : (uint32_t)v;
+}
+
+static uint8_t _render_num(const struct ui_field* f, int32_t v, uint8_t prec)
+{
+    uint8_t n = 0;
+    uint32_t mag = _mag(v);
+
+    if (v < 0 && (f->flags & UF_CLAMP0)) {
+        mag = 0;
+    }
+
+    if (f->prefix) {
+        scratch[n++] = f->prefix;
+    }
+
+    if (mag != 0 && v < 0 && !(f->flags & UF_CLAMP0)) {
+        scratch[n++] = '-';
+    }
+
+    if (f->flags & UF_TRUNC) {
+        mag = fmt_trunc(mag, f->dp, prec);
+    }
+
+    n += fmt_fixed(&scratch[n], mag, f->dp, prec);
+    n += fmt_str(&scratch[n], (const char*)f->arg);
+
+    return n;
 }
 
-static void clean_line_buffer(void)
+static uint8_t _render(const struct ui_field* f, int32_t v)
 {
-    for (int i = 0; i < MAX_LINE; ++i) {
-        lcd_line[i] = ' ';
+    uint8_t n;
+
+    if (v == 0 && (f->flags & UF_BLANK0)) {
+        return 0;
+    }
+
+    switch (f->fmt) {
+    case UF_TEXT:
+        return fmt_str(scratch, (const char*)f->arg);
+    case UF_NUM:
+        n = _render_num(f, v, f->prec);
+        if (n > f->width && f->prec) {
+            n = _render_num(f, v, 0);
+        }
+        return n;
+    case UF_GAUGE:
+    {
+        const char* unit = (const char*)f->arg;
+        uint8_t sign = (f->flags & UF_REGEN_PLUS) ? 1 : 0;
+
+        memset(scratch, ' ', f->width);
+        fmt_unit(&scratch[sign], 4, _mag(v), f->dp, unit[0]);
+        fmt_str(&scratch[sign + 5], unit + 1);
+        if (sign && v < 0) {
+            scratch[0] = '+';
+        }
+        return f->width;
+    }
+    case UF_BAR:
+        gfx_bar(scratch, f->width, (v < 0) ? 0 : v, f->scale);
+        return f->width;
+    case UF_SPARK:
+        gfx_spark(scratch, f->width, (const struct gfx_spark*)f->arg);
+        return f->width;
+    case UF_NAME:
+        v = (v < 0) ? 0 : (v >= f->scale) ? f->scale - 1 : v;
+        return fmt_str(scratch, ((const char* const*)f->arg)[v]);
+    default:
+        return 0;
     }
-    lcd_line[MAX_LINE] = '\0';
 }
 
-static void unit_2_line(float v, char unit, int latest_char)
+static void _place(const struct ui_field* f, uint8_t n)
 {
-    if (v < 0.1) {
-        lcd_line[latest_char - 1] = '0';
-    } else if (v < 10.0) {
-        sprintf(&lcd_line[latest_char - 3], "%.1f", v);
-    } else if (v < 100.0) {
-        sprintf(&lcd_line[latest_char - 4], "%.1f", v);
-    } else if (v < 1000.0) {
-        sprintf(&lcd_line[latest_char - 3], "%.0f", v);
-    } else if (v < 10000.0) {
-        v /= 1000.0;
-        sprintf(&lcd_line[latest_char - 4], "%.1fk", v);
+    char* dst = &lines[f->row][f->col];
+
+    memset(dst, ' ', f->width);
+
+    if (n > f->width) {
+        // does not fit
+        memset(dst, '*', f->width);
+    } else if (f->flags & UF_LEFT) {
+        memcpy(dst, scratch, n);
     } else {
-        v /= 1000.0;
-        sprintf(&lcd_line[latest_char - 3], "%.0fk", v);
+        memcpy(dst + f->width - n, scratch, n);
     }
+}
 
-    lcd_line[latest_char] = unit;
+// re-renders fields which are dirty or due and changed,
+// returns a bitmask of modified rows
+static uint8_t _update_screen(struct ui_screen_state* st,
+    const struct vehicle_gauges* vg)
+{
+    uint8_t rows = 0;
+
+    for (uint8_t i = 0; i < st->screen->count; ++i) {
+        const struct ui_field* f = &st->screen->fields[i];
+        struct ui_field_state* fs = &st->fields[i];
+        int32_t v = _field_value(f, vg);
+
+        if (fs->age < UINT8_MAX) {
+            ++fs->age;
+        }
+
+        if (!fs->dirty) {
+            if (f->refresh == UI_STATIC || fs->age < f->refresh) {
+                continue;
+            }
+            if (v == fs->value && f->fmt != UF_BAR && f->fmt != UF_SPARK) {
+                continue;
+            }
+        }
+
+        _place(f, _render(f, v));
+
+        fs->value = v;
+        fs->age = 0;
+        fs->dirty = 0;
+        rows |= 1 << f->row;
+    }
+
+    return rows;
 }
 
-static void unit_2_line_int(unsigned int v, char unit, int latest_char)
+// the whole row, padded with spaces
+static void _print_row(const char* s, uint8_t row)
 {
-    if (v < 10) {
-        sprintf(&lcd_line[latest_char - 1], "%d", v);
-    } else if (v < 100) {
-        sprintf(&lcd_line[latest_char - 2], "%d", v);
-    } else if (v < 1000) {
-        sprintf(&lcd_line[latest_char - 3], "%d", v);
+    lcd_bus_cmd(LCD_CMD_DDRAM_ADDR | (row ? LCD_ROW1_ADDR : 0));
+    for (uint8_t c = 0; c < MAX_LINE; ++c) {
+        lcd_bus_data(*s ? *s++ : ' ');
     }
+}
+
+void ui_init(void)
+{
+    lcd_init();
+    lcd_on();
+    lcd_bus_init();
+    lcd_bus_cmd(LCD_CMD_CLEAR);
+    lcd_disable_cursor();
+    gfx_init();
+    busy_flag_used = lcd_bus_busy_flag_used();
 
-    lcd_line[latest_char] = unit;
+    for (uint8_t r = 0; r < UI_ROWS; ++r) {
+        memset(lines[r], ' ', MAX_LINE);
+        lines[r][MAX_LINE] = '\0';
+        memset(shown[r], ' ', MAX_LINE);
+    }
+    main_state.screen = 0;
+    status_state.screen = 0;
+    present_init();
+    memset(&power_spark, 0, sizeof(power_spark));
+    spark_sum_w = 0;
+    spark_ticks = 0;
+    alarm = 0;
+    charging = 0;
 }
 
 void ui_set_display_mode(enum display_mode dm)
 {
-    mode = dm;
+    mode = (dm < DM_LIMIT) ? dm : DM_DEFAULT;
 }
 
 void ui_disable_amp_gauges(void)
@@ -97,111 +476,105 @@ void ui_disable_amp_gauges(void)
     current = 0;
 }
 
-static void _displ_trip(uint8_t speed, uint16_t dist_m, uint8_t trip_num)
+void ui_set_alarm(uint8_t on)
 {
-    int d_km = dist_m / 1000;
-    int d_01 = (dist_m - d_km * 1000) / 100;
-    
-    if (d_km < 10000) {
-        if (trip_num == 0) {
-            lcd_printfln("%d km/h %d.%dkm", speed, d_km, d_01);
-        } else {
-            lcd_printfln("%d km/h %d.%dkm-%d", speed, d_km, d_01, trip_num);
-        }
-    } else {
-        if (trip_num == 0) {
-            lcd_printfln("%d km/h %dkm", speed, d_km);
-        } else {
-            lcd_printfln("%d km/h %dkm-%d", speed, d_km, trip_num);
-        }
-    }
+    alarm = on;
+}
+
+void ui_set_charging(uint8_t on)
+{
+    charging = on;
 }
 
 void ui_update(const struct vehicle_gauges* vg)
 {
-    lcd_set_cursor(0, 1);
-
-    if (!vg->motherboard_offline) {
-        if (current) {
-            clean_line_buffer();
-            unit_2_line(vg->batt_v, 'V', 4);
-            unit_2_line_int(vg->batt_perc, '%', 9);
-            unit_2_line((vg->amper < 0)? -vg->amper : vg->amper, 'A', 15);
-            lcd_printfln("%s", lcd_line);
+    uint8_t rows;
+
+    if (busy_flag_used && !lcd_bus_busy_flag_used()) {
+        // the flag timed out, with RW tied low whatever went out while
+        // polling is lost: glyphs and rows are sent again
+        gfx_init();
+        main_state.screen = 0;
+        status_state.screen = 0;
+        memset(shown, 0, sizeof(shown));
+    }
+    busy_flag_used = lcd_bus_busy_flag_used();
+
+    gfx_begin_frame();
+
+    uint32_t consumed_w = (vg->power_cw > 0) ? vg->power_cw / 100 : 0;
+    spark_sum_w += (consumed_w > UINT16_MAX) ? UINT16_MAX : consumed_w;
+    if (++spark_ticks == UI_SPARK_MS / UI_TICK_MS) {
+        gfx_spark_push(&power_spark, spark_sum_w / spark_ticks);
+        spark_sum_w = 0;
+        spark_ticks = 0;
+    }
+
+    present_update(vg, &presented);
+    vg = &presented;
+
+    _attach(&main_state, alarm ? &alarm_screen
+        : charging ? &charge_screen : &screens[mode]);
+    rows = _update_screen(&main_state, vg);
+
+    if (main_state.screen->status_row) {
+        if (vg->motherboard_offline) {
+            _attach(&status_state, &status_screens[2]);
         } else {
-            lcd_printfln("%.1fV %d%% %dC", 
-                    vg->batt_v, vg->batt_perc, vg->ambient_temp);
+            _attach(&status_state, &status_screens[current ? 0 : 1]);
         }
+        rows |= _update_screen(&status_state, vg);
     } else {
-        lcd_println("OFFLINE!", 1);
+        status_state.screen = 0;
     }
 
-    lcd_set_cursor(0, 0);
-
-    switch (mode)
-    {
-    case DM_TRIP1:
-        _displ_trip(vg->speed_kmh, vg->trip1_m, 1);
-        break;
-    case DM_TRIP2:
-        _displ_trip(vg->speed_kmh, vg->trip2_m, 2);
-        break;
-    case DM_TEMP:
-        lcd_printfln("%dC %dC %dC %dC", vg->ambient_temp
-            , (vg->moto_temp < 0) ? 0 : vg->moto_temp
-            , (vg->driver_temp < 0) ? 0 : vg->driver_temp
-            , (vg->batt_temp < 0) ? 0 : vg->batt_temp);
-        break;
-    case DM_POWER:
-        lcd_printfln("-%.1fWh +%.1fWh", vg->consumed_Wh, vg->brake_Wh);
-        break;
-    case DM_POWER2:
-        clean_line_buffer();
-        float a = (vg->amper < 0) ? -vg->amper : vg->amper;
-        unit_2_line(a * vg->batt_v, 'W', 5);
-        unit_2_line(vg->Wh_km, 'W', 11);
-        lcd_line[12] = 'h'; lcd_line[13] = '/'; lcd_line[14] = 'k'; lcd_line[15] = 'm';
-        if (vg->amper < 0) lcd_line[0] = '+';
-        lcd_printfln("%s", lcd_line);
-        // lcd_printfln("%dW %.1fW/km", (int32_t)(vg->amper * vg->batt_v), vg->Wh_km);
-        break;
-    case DM_DEFAULT:
-    default:
-        _displ_trip(vg->speed_kmh, vg->total_m, 0);
-        break;
+    for (uint8_t r = 0; r < UI_ROWS; ++r) {
+        // glyph bitmaps are already uploaded, unchanged text is not resent
+        if ((rows & (1 << r)) && memcmp(shown[r], lines[r], MAX_LINE) != 0) {
+            memcpy(shown[r], lines[r], MAX_LINE);
+            lines[r][MAX_LINE] = '\0';
+            _print_row(lines[r], r);
+        }
     }
 }
 
 void ui_welcome_screen_blk_1(void)
 {
     lcd_backlight_on();
-    lcd_println("Rafal Rowniak", 0);
-    lcd_println("  rrowniak.com", 1);
-    HAL_Delay(700);
+    _print_row("Rafal Rowniak", 0);
+    _print_row("  rrowniak.com", 1);
+    HAL_Delay(UI_WELCOME_SCREEN_MS);
     
     beep_on();
-    HAL_Delay(100);
+    HAL_Delay(UI_WELCOME_BEEP_MS);
     beep_off();
 }
 
 void ui_welcome_screen_blk_2(void)
 {
 
-    lcd_println("     BOROWY", 0);
-    lcd_println("ver: " VERSION, 1);
-    HAL_Delay(700);
+    _print_row("     BOROWY", 0);
+    _print_row("ver: " VERSION, 1);
+    HAL_Delay(UI_WELCOME_SCREEN_MS);
     lcd_backlight_off();
 }
 
+static void _print_setup_value(uint32_t v)
+{
+    char b[MAX_LINE + 1] = "  ";
+
+    b[2 + fmt_uint(b + 2, v)] = '\0';
+    _print_row(b, 1);
+}
+
 static uint32_t _ask_user_for_blk_jump_by(uint32_t def, 
     uint32_t min, uint32_t max, uint32_t jump_by, const char* msg)
 {
     uint32_t v = def;
     uint8_t refresh = 1;
 
-    lcd_println(msg, 0);
-    lcd_set_cursor(0, 1);
-    lcd_printfln("  %d", v);
+    _print_row(msg, 0);
+    _print_setup_value(v);
 
     HAL_Delay(200);
 
@@ -220,8 +593,7 @@ static uint32_t _ask_user_for_blk_jump_by(uint32_t def,
         }
 
         if (refresh) {
-            lcd_set_cursor(0, 1);
-            lcd_printfln("  %d", v);
+            _print_setup_value(v);
             refresh = 0;
         }
 
@@ -241,8 +613,8 @@ static uint32_t _ask_user_for_blk(uint32_t def,
 
 void ui_initial_setup(struct vehicle_conf* vc)
 {
-    lcd_println("INITIAL SETUP", 0);
-    lcd_println("PRESS MAIN KEY", 1);
+    _print_row("INITIAL SETUP", 0);
+    _print_row("PRESS MAIN KEY", 1);
     while (!get_n_reset_btn_released(BUTTON_3));
     HAL_Delay(200);
 
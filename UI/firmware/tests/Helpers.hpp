@@ -16,7 +16,8 @@ void dump_lcd()
     std::cout << hd44780_get_frame() << std::endl;
 }
 
-CanMessage BuildElectricMsg(uint32_t voltage, int32_t current)
+CanMessage BuildElectricMsg(uint32_t voltage, int32_t current,
+    uint16_t faults = 0)
 {
     CanMessage msg;
 
@@ -27,7 +28,7 @@ CanMessage BuildElectricMsg(uint32_t voltage, int32_t current)
     el->timestamp = HAL_GetTick() % MAX_TIMESTAMP;
     el->voltage = voltage;
     el->current = convert_to_14bit(current);
-    el->faults = 0;
+    el->faults = faults;
     el->seq_id = electric_seq_id++;
 
     return msg;
@@ -0,0 +1,111 @@
+#ifndef __RIDE_LOG_DECODER_HPP__
+#define __RIDE_LOG_DECODER_HPP__
+
+// host side of the ride log: the USART1 export back into the EEPROM
+// image, and the image into rides of 1 Hz samples
+
+#include "ridelog.h"
+#include "export.h"
+#include "crc.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+struct LogPoint
+{
+    // seconds since the boot of the ride
+    uint32_t t;
+    struct ridelog_sample s;
+};
+
+typedef std::vector<LogPoint> LogRide;
+
+// the frames of one EXPORT_RIDE_LOG dump, returns the number of blocks
+// received or -1 without the closing frame; a block whose frame fails
+// the CRC stays zeroed and does not decode
+static int ParseRideLogExport(const std::vector<uint8_t>& wire,
+    std::vector<uint8_t>& image)
+{
+    int blocks = 0;
+    size_t i = 0;
+
+    image.clear();
+    while (i + EXPORT_HEADER + 2 <= wire.size()) {
+        if (wire[i] != EXPORT_SYNC_1 || wire[i + 1] != EXPORT_SYNC_2) {
+            ++i;
+            continue;
+        }
+        uint8_t type = wire[i + 2];
+        uint16_t idx = wire[i + 3] | wire[i + 4] << 8;
+        uint8_t len = wire[i + 5];
+        size_t end = i + EXPORT_HEADER + len;
+        if (len > EXPORT_MAX_PAYLOAD || end + 2 > wire.size()) {
+            ++i;
+            continue;
+        }
+        uint16_t crc = wire[end] | wire[end + 1] << 8;
+        if (type != EXPORT_RIDE_LOG
+            || crc != crc16(CRC16_INIT, &wire[i + 2], EXPORT_HEADER - 2 + len)) {
+            // resynchronises on the next sync bytes
+            ++i;
+            continue;
+        }
+        if (len == 0) {
+            image.resize(idx * RIDELOG_BLOCK);
+            return blocks;
+        }
+        if (len == RIDELOG_BLOCK) {
+            if (image.size() < (idx + 1u) * RIDELOG_BLOCK) {
+                image.resize((idx + 1) * RIDELOG_BLOCK);
+            }
+            std::copy(&wire[i + EXPORT_HEADER], &wire[end],
+                image.begin() + idx * RIDELOG_BLOCK);
+            ++blocks;
+        }
+        i = end + 2;
+    }
+    return -1;
+}
+
+// the blocks in seq order; a block starting before the previous one
+// ended starts a new ride
+static std::vector<LogRide> DecodeRideLog(const std::vector<uint8_t>& image)
+{
+    struct Block
+    {
+        uint32_t seq;
+        uint32_t t_s;
+        std::vector<struct ridelog_sample> s;
+    };
+    std::vector<Block> blocks;
+    std::vector<LogRide> rides;
+
+    for (size_t off = 0; off + RIDELOG_BLOCK <= image.size();
+        off += RIDELOG_BLOCK) {
+        Block b;
+        b.s.resize(RIDELOG_MAX_SAMPLES);
+        int n = ridelog_block_decode(&image[off], &b.seq, &b.t_s, b.s.data(),
+            RIDELOG_MAX_SAMPLES);
+        if (n > 0) {
+            b.s.resize(n);
+            blocks.push_back(b);
+        }
+    }
+    std::sort(blocks.begin(), blocks.end(),
+        [](const Block& a, const Block& b) { return a.seq < b.seq; });
+
+    uint32_t end_t = 0;
+    for (const Block& b : blocks) {
+        if (rides.empty() || b.t_s < end_t) {
+            rides.emplace_back();
+        }
+        for (size_t k = 0; k < b.s.size(); ++k) {
+            rides.back().push_back({ b.t_s + (uint32_t)k, b.s[k] });
+        }
+        end_t = b.t_s + b.s.size();
+    }
+    return rides;
+}
+
+#endif // __RIDE_LOG_DECODER_HPP__
\ No newline at end of file
@@ -0,0 +1,121 @@
+#include "alarm.h"
+#include "buzzer.h"
+
+// the motor at 1 Hz frames: `c_min` C/min from `from` with the
+// 1 C steps and a flickering LSB of the sensor
+static int16_t MotorReading(int s, int from, int c_min)
+{
+    return from + s * c_min / 60 + ((s % 7 == 3) ? 1 : 0);
+}
+
+BOOST_AUTO_TEST_CASE(alarm_predict_test)
+{
+    struct alarm al;
+    struct vehicle_conf conf;
+    struct vehicle_gauges g = {};
+    int warn_s = -1, hot_s = -1;
+
+    init_vehicle_conf(&conf);
+    conf.moto_t_alarm_c = 90;
+    conf.drv_t_alarm_c = 90;
+    conf.batt_t_alarm_c = 0;
+    alarm_init(&al);
+    g.driver_temp = 40;
+    g.batt_temp = 99;
+
+    // a long climb at 6 C/min from 60 C
+    for (int s = 0; s < 600 && hot_s < 0; ++s) {
+        g.moto_temp = MotorReading(s, 60, 6);
+        uint8_t rose = alarm_update(&al, &g, &conf, s * 1000);
+        if ((rose & 1) && al.rows[0].level == ALARM_WARN) {
+            warn_s = s;
+        }
+        if ((rose & 1) && al.rows[0].level == ALARM_HOT) {
+            hot_s = s;
+        }
+        BOOST_TEST((rose & ~1) == 0);
+    }
+    BOOST_TEST_MESSAGE("6 C/min climb: warned " << hot_s - warn_s
+        << " s before the limit, slope " << alarm_slope_cmin(&al, 0)
+        << " C/min");
+    BOOST_TEST(warn_s >= 0);
+    BOOST_TEST(hot_s - warn_s >= 30);
+    BOOST_TEST(alarm_worst(&al) == 0);
+    BOOST_TEST(alarm_faults(&al) == 1 << ALARM_FAULT_BIT);
+    // the pack has no limit set
+    BOOST_TEST(al.rows[2].level == ALARM_OK);
+
+    // hovering at the limit: a level change at the crossings only
+    int changes = 0;
+    for (int s = 0; s < 600; ++s) {
+        uint8_t prev = al.rows[0].level;
+        g.moto_temp = 89 + (s / 3) % 3;
+        alarm_update(&al, &g, &conf, (1000 + s) * 1000);
+        changes += (al.rows[0].level != prev);
+    }
+    BOOST_TEST(changes == 0);
+
+    // cooled down
+    for (int s = 0; s < 300; ++s) {
+        g.moto_temp = std::max(60, 89 - s / 2);
+        alarm_update(&al, &g, &conf, (2000 + s) * 1000);
+    }
+    BOOST_TEST(alarm_worst(&al) == -1);
+
+    // a failed sensor is no alarm
+    g.moto_temp = -232;
+    BOOST_TEST(alarm_update(&al, &g, &conf, 3000000) == 0);
+}
+
+BOOST_AUTO_TEST_CASE(buzzer_pattern_test)
+{
+    std::string heard;
+
+    buzzer_init();
+    buzzer_play(BUZ_WARN);
+    // a lower one waits its turn
+    buzzer_play(BUZ_REMINDER);
+    for (int t = 0; t < 30; ++t) {
+        heard += buzzer_on() ? '#' : '.';
+        buzzer_tick();
+    }
+    BOOST_TEST(heard == "#####.....#####...............");
+    BOOST_TEST(buzzer_playing() == BUZ_NONE);
+
+    // the alarm repeats every 2 s until stopped
+    buzzer_play(BUZ_ALARM);
+    int on = 0;
+    for (int t = 0; t < 500; ++t) {
+        on += buzzer_on();
+        buzzer_tick();
+    }
+    BOOST_TEST(on == 5 * 30);
+    BOOST_TEST(buzzer_playing() == BUZ_ALARM);
+    buzzer_stop(BUZ_WARN);
+    BOOST_TEST(buzzer_playing() == BUZ_ALARM);
+    buzzer_stop(BUZ_ALARM);
+    BOOST_TEST(!buzzer_on());
+}
+
+BOOST_AUTO_TEST_CASE(alarm_logic_test)
+{
+    logic_init();
+    ui_set_display_mode(DM_DEFAULT);
+    for (int i = 0; i < 10; ++i) {
+        HAL_Tick += 100;
+        InsertCanMessage(BuildTempMsg(95, 40, 25));
+        logic_update();
+    }
+    BOOST_TEST(buzzer_playing() == BUZ_ALARM);
+    BOOST_TEST(hd44780_get_line1().find("Motor   HOT!") == 0);
+    BOOST_TEST(hd44780_get_line2().find("max 90C") == 0);
+
+    // the motor cooled down, the view is back
+    for (int i = 0; i < 10; ++i) {
+        HAL_Tick += 100;
+        InsertCanMessage(BuildTempMsg(60, 40, 25));
+        logic_update();
+    }
+    BOOST_TEST(buzzer_playing() != BUZ_ALARM);
+    BOOST_TEST(hd44780_get_line1().find("km/h") != std::string::npos);
+}
\ No newline at end of file
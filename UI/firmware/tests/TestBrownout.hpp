@@ -0,0 +1,224 @@
+#include "state.h"
+#include "journal.h"
+
+static struct vehicle_runtime bo_inflight;
+static struct vehicle_runtime bo_durable;
+
+static void BrownoutSaved(void* ctx, int err)
+{
+    (void)ctx;
+    if (!err) {
+        bo_durable = bo_inflight;
+    }
+}
+
+// main loop passes every ms until the recovery gets through, returns ms
+static uint32_t RecoverCommit(void)
+{
+    uint32_t start = HAL_Tick;
+    recover_vehicle_runtime_commit();
+    while (vehicle_runtime_committed() && HAL_Tick - start < 1000) {
+        HAL_Tick += 1;
+        recover_vehicle_runtime_commit();
+    }
+    return HAL_Tick - start;
+}
+
+static bool SameRuntime(const struct vehicle_runtime& a,
+    const struct vehicle_runtime& b)
+{
+    return std::memcmp(JournalImage(a).b, JournalImage(b).b,
+        PERSIST_RUNTIME_SIZE) == 0;
+}
+
+// the power goes at random points of riding with queued saves in any
+// state; what the boot loads must be the last prepared runtime, or when
+// the commit itself is cut, the last one fully written before
+BOOST_AUTO_TEST_CASE(brownout_commit_test)
+{
+    struct vehicle_runtime vr, loaded, prepared;
+    int commits = 0, cut = 0, dips = 0, in_flight = 0;
+
+    std::srand(41);
+    eeprom_async_init();
+    fake_defer = 0;
+    if (load_vehicle_runtime(&vr)) {
+        init_vehicle_runtime(&vr);
+    }
+    BOOST_TEST(save_vehicle_runtime(&vr) == 0);
+    bo_durable = vr;
+
+    for (int trial = 0, i = 0; trial < 1000; ++trial) {
+        int steps = 1 + std::rand() % 20;
+        for (int k = 0; k < steps; ++k, ++i) {
+            HAL_Tick += 100;
+            JournalRide(vr, i);
+            prepare_vehicle_runtime_commit(&vr);
+            prepared = vr;
+
+            if (std::rand() % 4 == 0 && !vehicle_runtime_journal()->pending) {
+                bo_inflight = vr;
+                save_vehicle_runtime_async(&vr, BrownoutSaved, NULL);
+            }
+
+            // the bus is slow at times, transfers stay in flight
+            fake_defer = std::rand() % 2;
+            for (int p = std::rand() % 8; p > 0; --p) {
+                eeprom_async_poll();
+                if (std::rand() % 2) {
+                    FakeBusFinish();
+                }
+                HAL_Tick += 1;
+            }
+        }
+        in_flight += fake_xfer_active;
+
+        // the supply fails, sometimes during the commit itself
+        bool cut_now = std::rand() % 5 == 0;
+        fake_now_budget = cut_now ? std::rand() % 59 : -1;
+        int ret = commit_vehicle_runtime();
+        fake_now_budget = -1;
+        BOOST_TEST(ret == (cut_now ? 1 : 0));
+        ++commits;
+        cut += cut_now;
+
+        if (!cut_now && std::rand() % 3 == 0) {
+            // only a dip, the ride goes on
+            ++dips;
+            RecoverCommit();
+            bo_durable = prepared;
+            continue;
+        }
+
+        // power off and boot
+        fake_defer = 0;
+        fake_xfer_active = 0;
+        fake_cycle = 0;
+        RecoverCommit();
+        BOOST_TEST(load_vehicle_runtime(&loaded) == 0);
+        if (cut_now) {
+            BOOST_TEST((SameRuntime(loaded, bo_durable)
+                || SameRuntime(loaded, bo_inflight)));
+        } else {
+            BOOST_TEST(SameRuntime(loaded, prepared));
+        }
+        vr = loaded;
+        bo_durable = loaded;
+        bo_inflight = loaded;
+    }
+
+    BOOST_TEST_MESSAGE("brown-out: " << commits << " commits, " << dips
+        << " dips, " << cut << " cut short, " << in_flight
+        << " with a queued write on the bus");
+}
+
+static int bo_failed;
+
+static void BrownoutFailed(void* ctx, int err)
+{
+    (void)ctx;
+    bo_failed += err;
+}
+
+// saves still queued at the commit fail through their callbacks, none of
+// them stays pending and refuses the saves after the dip
+BOOST_AUTO_TEST_CASE(brownout_requeue_test)
+{
+    struct vehicle_runtime vr;
+    struct trip_summary live[2] = {}, live_back[2];
+    struct trip_archive ta, ta_back;
+
+    eeprom_async_init();
+    fake_defer = 0;
+    if (load_vehicle_runtime(&vr)) {
+        init_vehicle_runtime(&vr);
+    }
+    init_trip_archive(&ta);
+    ta.trips[0].seq = ta.next_seq++;
+    ta.trips[0].trip = 1;
+    ta.count = 1;
+    live[0].dist_m = 1000;
+    live[1].dist_m = 2000;
+
+    // the bus hangs with both saves queued when the supply dips
+    fake_defer = 1;
+    bo_failed = 0;
+    BOOST_TEST(save_trip_live_async(live, BrownoutFailed, NULL) == 0);
+    BOOST_TEST(save_trip_async(&ta, BrownoutFailed, NULL) == 0);
+    eeprom_async_poll();
+    prepare_vehicle_runtime_commit(&vr);
+    BOOST_TEST(commit_vehicle_runtime() == 0);
+    RecoverCommit();
+    BOOST_TEST(bo_failed == 2);
+
+    // the same saves go through after the recovery
+    fake_defer = 0;
+    fake_xfer_active = 0;
+    live[0].dist_m = 1100;
+    ta.trips[0].dist_m = 3000;
+    BOOST_TEST(save_trip_live_async(live, NULL, NULL) == 0);
+    BOOST_TEST(save_trip_async(&ta, NULL, NULL) == 0);
+    EeDrain();
+
+    BOOST_TEST(load_trip_live(live_back) == 0);
+    BOOST_TEST(live_back[0].dist_m == 1100u);
+    BOOST_TEST(live_back[1].dist_m == 2000u);
+    BOOST_TEST(load_trip_archive(&ta_back) == 0);
+    BOOST_TEST(ta_back.count >= 1);
+    BOOST_TEST(ta_back.trips[ta_back.count - 1].dist_m == 3000u);
+}
+
+// the EEPROM NACKs through the write cycle of the commit: the journal is
+// only reopened once it answers, never from a ring it could not read
+BOOST_AUTO_TEST_CASE(brownout_write_cycle_test)
+{
+    struct vehicle_runtime vr, loaded;
+
+    eeprom_async_init();
+    fake_defer = 0;
+    fake_cycle = 0;
+    if (load_vehicle_runtime(&vr)) {
+        init_vehicle_runtime(&vr);
+    }
+    for (int i = 0; i < 5; ++i) {
+        JournalRide(vr, i);
+        BOOST_TEST(save_vehicle_runtime_async(&vr, NULL, NULL) == 0);
+        EeDrain();
+    }
+
+    // the supply dips and the commit write cycle is still running
+    JournalRide(vr, 5);
+    prepare_vehicle_runtime_commit(&vr);
+    uint32_t seq = vehicle_runtime_journal()->next_seq;
+    BOOST_TEST(commit_vehicle_runtime() == 0);
+    recover_vehicle_runtime_commit();
+    BOOST_TEST(vehicle_runtime_committed() != 0);
+    BOOST_TEST(RecoverCommit() >= (uint32_t)FAKE_TWC_MS - 1);
+    BOOST_TEST(vehicle_runtime_journal()->next_seq == seq + 1);
+
+    // the device answers the first probe and drops off the bus
+    JournalRide(vr, 6);
+    prepare_vehicle_runtime_commit(&vr);
+    seq = vehicle_runtime_journal()->next_seq;
+    BOOST_TEST(commit_vehicle_runtime() == 0);
+    HAL_Tick += FAKE_TWC_MS;
+    fake_probe_acks = 1;
+    recover_vehicle_runtime_commit();
+    BOOST_TEST(vehicle_runtime_committed() != 0);
+    // closed rather than restarted at seq 0
+    BOOST_TEST(save_vehicle_runtime_async(&vr, NULL, NULL) == 1);
+    BOOST_TEST(commit_vehicle_runtime() == 1);
+
+    fake_probe_acks = -1;
+    RecoverCommit();
+    BOOST_TEST(vehicle_runtime_committed() == 0);
+    BOOST_TEST(vehicle_runtime_journal()->next_seq == seq + 1);
+
+    // the saves after it are the newest ones at the next boot
+    JournalRide(vr, 7);
+    BOOST_TEST(save_vehicle_runtime_async(&vr, NULL, NULL) == 0);
+    EeDrain();
+    fake_cycle = 0;
+    BOOST_TEST(load_vehicle_runtime(&loaded) == 0);
+    BOOST_TEST(SameRuntime(loaded, vr));
+}
\ No newline at end of file
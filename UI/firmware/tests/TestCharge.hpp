@@ -0,0 +1,127 @@
+#include "charge.h"
+
+// 100 ms electric frames with the 1 s tick of the logic
+struct ChargeBench
+{
+    struct charge c;
+    int frames = 0;
+    int claimed = 0;
+    double wh = 0;
+
+    void Frame(uint16_t speed_dkmh, double volts, double amps)
+    {
+        claimed += charge_sample(&c, speed_dkmh, std::lround(volts * 10),
+            std::lround(amps * 10), 100);
+        if (amps < 0 && speed_dkmh == 0) {
+            wh -= volts * amps * 0.1 / 3600;
+        }
+        if (++frames % 10 == 0) {
+            charge_tick(&c);
+        }
+    }
+
+    void Run(int s, uint16_t speed_dkmh, double volts, double amps)
+    {
+        for (int i = 0; i < s * 10; ++i) {
+            Frame(speed_dkmh, volts, amps);
+        }
+    }
+};
+
+BOOST_AUTO_TEST_CASE(charge_session_test)
+{
+    static ChargeBench b;
+    struct charge_session none = {};
+
+    charge_init(&b.c, &none);
+    // a ride with regeneration, then the stop with the speed lagging
+    for (int min = 0; min < 5; ++min) {
+        b.Run(55, 250, 80, 12);
+        b.Run(5, 250, 81, -10);
+    }
+    b.Run(3, 0, 81, -8);
+    b.Run(30, 0, 80, 0);
+    BOOST_TEST(b.claimed == 30);
+    BOOST_TEST(b.c.state == CHARGE_IDLE);
+    BOOST_TEST(!b.c.closed);
+    // was regeneration after all, 648 W for 3 s
+    BOOST_TEST(charge_take_returned_mWs(&b.c) == 1944000u);
+    BOOST_TEST(charge_take_returned_mWs(&b.c) == 0u);
+
+    // 4 A constant current 70 -> 84 V in 90 minutes, the constant
+    // voltage tail, unplugged
+    b.claimed = 0;
+    b.wh = 0;
+    int predicted = 0;
+    for (int s = 0; s < 90 * 60; ++s) {
+        b.Run(1, 0, 70 + 14.0 * s / 5400, -4);
+        if (s == 45 * 60) {
+            // what is left of the constant current phase, 4 A for 45 min
+            predicted = charge_minutes_to_full(&b.c, 3000, 840);
+        }
+    }
+    BOOST_TEST(b.c.state == CHARGE_ON);
+    BOOST_TEST(charge_current_da(&b.c) == 40);
+    for (int s = 0; s < 30 * 60; ++s) {
+        b.Run(1, 0, 84, -4 * std::exp(-s / 600.0) - 0.5);
+    }
+    b.Run(60, 0, 83, 0);
+    BOOST_TEST(b.c.closed);
+    BOOST_TEST(b.c.state == CHARGE_IDLE);
+    // the charger's from the first frame
+    BOOST_TEST(charge_take_returned_mWs(&b.c) == 0u);
+
+    const struct charge_session s1 = b.c.last;
+    BOOST_TEST_MESSAGE("charge: " << s1.duration_s << " s, " << s1.start_dv
+        << " -> " << s1.end_dv << " dV, " << s1.dWh_in / 10.0 << " Wh ("
+        << b.wh << " Wh), " << s1.mAh_in << " mAh; full predicted in "
+        << predicted << " min at the half");
+    BOOST_TEST(s1.seq == 1);
+    BOOST_TEST(s1.start_dv == 700);
+    BOOST_TEST(s1.end_dv == 830);
+    BOOST_TEST(std::abs(s1.dWh_in / 10.0 - b.wh) < b.wh / 200);
+    BOOST_TEST(std::abs((int)s1.duration_s - 120 * 60 - 30) <= 2);
+    BOOST_TEST(std::abs(predicted - 45) <= 1);
+    BOOST_TEST(b.claimed == 120 * 60 * 10);
+
+    // the pack relaxing after a ride is no charge
+    b.c.closed = 0;
+    b.Run(200, 300, 74, 20);
+    for (int s = 0; s < 30 * 60; ++s) {
+        b.Run(1, 0, 75 + 1.5 * (1 - std::exp(-s / 120.0)), 0);
+    }
+    BOOST_TEST(b.c.state == CHARGE_IDLE);
+
+    // a charger behind the current sensor: 0.2 V per 5 minutes
+    double v = 76.5;
+    for (int s = 0; s < 60 * 60; ++s) {
+        v += 0.2 / 300;
+        b.Run(1, 0, v, 0);
+    }
+    BOOST_TEST(b.c.state == CHARGE_ON);
+    BOOST_TEST(!b.c.by_current);
+    uint16_t min = charge_minutes_to_full(&b.c, 0, 840);
+    BOOST_TEST_MESSAGE("voltage only: " << v << " V, full in " << min
+        << " min");
+    BOOST_TEST(std::abs(min - (84 - v) / 0.2 * 5) <= 6);
+    b.Run(10 * 60, 0, v, 0);
+    BOOST_TEST(b.c.closed);
+    BOOST_TEST(b.c.last.seq == 2);
+    BOOST_TEST(b.c.last.dWh_in == 0);
+    BOOST_TEST(b.c.last.total_mAh == s1.mAh_in);
+    BOOST_TEST(b.c.last.duration_s >= 60 * 60);
+
+    // the newest one and the totals across a reboot
+    std::vector<uint8_t> erased(0x0400, 0xff);
+    eeprom_24lc256_write(0x0400 * 12, erased.data(), erased.size());
+    struct charge_session back;
+    BOOST_TEST(load_charge_last(&back) == 1);
+    eeprom_async_init();
+    BOOST_TEST(save_charge_async(&s1, NULL, NULL) == 0);
+    EeDrain();
+    BOOST_TEST(save_charge_async(&b.c.last, NULL, NULL) == 0);
+    EeDrain();
+    BOOST_TEST(load_charge_last(&back) == 0);
+    BOOST_TEST(back.seq == 2);
+    BOOST_TEST(back.total_dWh == s1.dWh_in);
+}
\ No newline at end of file
@@ -0,0 +1,56 @@
+#include "distance.h"
+
+static uint64_t ExactMeters(const struct vehicle_conf& vc, uint64_t pulses)
+{
+    return pulses * vc.dist_p_rev_mm / vc.pulse_p_rev / 1000;
+}
+
+BOOST_AUTO_TEST_CASE(distance_100000km_test)
+{
+    struct vehicle_conf vc;
+    struct distance d;
+    init_vehicle_conf(&vc);
+    distance_init(&d, &vc);
+
+    // 100 000 km in uneven pulse deltas, one per motion frame
+    const uint64_t target_m = 100000ULL * 1000;
+    uint64_t pulses = 0;
+    uint64_t trip_start = 0;
+    uint32_t delta = 0;
+
+    while (ExactMeters(vc, pulses) < target_m) {
+        delta = (delta * 7 + 13) % 41;
+        distance_add(&d, delta);
+        pulses += delta;
+
+        if (trip_start == 0 && ExactMeters(vc, pulses) >= target_m / 2) {
+            // trip 1 reset half way
+            distance_set(&d, DIST_TRIP1, 0);
+            trip_start = pulses;
+        }
+    }
+
+    BOOST_TEST_MESSAGE("100000 km == " << pulses << " pulses");
+    BOOST_TEST(distance_m(&d, DIST_TOTAL) == ExactMeters(vc, pulses));
+    BOOST_TEST(distance_m(&d, DIST_TRIP2) == ExactMeters(vc, pulses));
+    BOOST_TEST(distance_m(&d, DIST_TRIP1) == ExactMeters(vc, pulses - trip_start));
+    BOOST_TEST(distance_mm(&d, DIST_TOTAL) == pulses * vc.dist_p_rev_mm / vc.pulse_p_rev);
+}
+
+BOOST_AUTO_TEST_CASE(distance_restore_test)
+{
+    struct vehicle_conf vc;
+    struct distance d;
+    init_vehicle_conf(&vc);
+    distance_init(&d, &vc);
+
+    // restoring from the persisted pulses and adding deltas is exact,
+    // far beyond where pulses * dist_p_rev_mm overflows 32 bits
+    const uint32_t saved = 3000000000u;
+    distance_set(&d, DIST_TOTAL, saved);
+    for (int i = 0; i < 1000; ++i) {
+        distance_add(&d, 3);
+    }
+
+    BOOST_TEST(distance_m(&d, DIST_TOTAL) == ExactMeters(vc, saved + 3000ULL));
+}
\ No newline at end of file
@@ -0,0 +1,203 @@
+#include "eeprom_async.h"
+
+#include <lrr_eeprom_24LC256.h>
+
+// the 24LC256 as the engine sees it: the data goes to the blocking
+// driver's fake, after each page write the device NACKs for its write
+// cycle; transfers complete at once, as if the bus was infinitely fast
+#define FAKE_TWC_MS 5
+
+static uint32_t fake_cycle_end_ms;
+static uint8_t fake_cycle;
+static int fake_page_writes;
+static int fake_nacked;
+// writes stay on the bus until FakeBusFinish()
+static int fake_defer;
+static uint16_t fake_xfer_addr;
+static uint8_t fake_xfer_d[EEPROM_ASYNC_PAGE];
+static uint16_t fake_xfer_s;
+static uint8_t fake_xfer_active;
+// bytes of the next eeprom_port_write_now() before the power is gone
+static int fake_now_budget = -1;
+// address probes ACKed before the device stops answering, -1 == all
+static int fake_probe_acks = -1;
+
+static uint8_t FakeBusy(void)
+{
+    if (fake_cycle && HAL_GetTick() - fake_cycle_end_ms < 0x80000000u) {
+        fake_cycle = 0;
+    }
+    return fake_cycle;
+}
+
+extern "C" HAL_StatusTypeDef eeprom_port_write(uint16_t addr,
+    const uint8_t* d, uint16_t s)
+{
+    if (FakeBusy()) {
+        ++fake_nacked;
+        return HAL_ERROR;
+    }
+    // the device wraps a write within its page
+    BOOST_TEST(addr / EEPROM_ASYNC_PAGE == (addr + s - 1) / EEPROM_ASYNC_PAGE);
+    if (fake_defer) {
+        fake_xfer_addr = addr;
+        std::memcpy(fake_xfer_d, d, s);
+        fake_xfer_s = s;
+        fake_xfer_active = 1;
+        return HAL_OK;
+    }
+    eeprom_24lc256_write(addr, d, s);
+    ++fake_page_writes;
+    fake_cycle = 1;
+    fake_cycle_end_ms = HAL_GetTick() + FAKE_TWC_MS;
+    eeprom_async_xfer_done(1);
+    return HAL_OK;
+}
+
+extern "C" HAL_StatusTypeDef eeprom_port_read(uint16_t addr, uint8_t* d,
+    uint16_t s)
+{
+    if (FakeBusy()) {
+        ++fake_nacked;
+        return HAL_ERROR;
+    }
+    eeprom_24lc256_read(addr, d, s);
+    eeprom_async_xfer_done(1);
+    return HAL_OK;
+}
+
+extern "C" uint8_t eeprom_port_ready(void)
+{
+    if (fake_probe_acks == 0) {
+        return 0;
+    }
+    if (fake_probe_acks > 0) {
+        --fake_probe_acks;
+    }
+    return !FakeBusy();
+}
+
+static void FakeBusFinish(void)
+{
+    if (fake_xfer_active) {
+        fake_xfer_active = 0;
+        eeprom_24lc256_write(fake_xfer_addr, fake_xfer_d, fake_xfer_s);
+        ++fake_page_writes;
+        fake_cycle = 1;
+        fake_cycle_end_ms = HAL_GetTick() + FAKE_TWC_MS;
+        eeprom_async_xfer_done(1);
+    }
+}
+
+extern "C" HAL_StatusTypeDef eeprom_port_write_now(uint16_t addr,
+    const uint8_t* d, uint16_t s)
+{
+    // a transfer cut before its STOP condition writes nothing
+    fake_xfer_active = 0;
+    // blocking, the write cycle is waited out
+    fake_cycle = 0;
+
+    BOOST_TEST(addr / EEPROM_ASYNC_PAGE == (addr + s - 1) / EEPROM_ASYNC_PAGE);
+    if (fake_now_budget >= 0 && fake_now_budget < s) {
+        // the page gets written partially as the supply collapses
+        eeprom_24lc256_write(addr, d, fake_now_budget);
+        return HAL_ERROR;
+    }
+    eeprom_24lc256_write(addr, d, s);
+    ++fake_page_writes;
+    fake_cycle = 1;
+    fake_cycle_end_ms = HAL_GetTick() + FAKE_TWC_MS;
+    return HAL_OK;
+}
+
+static int ee_done;
+static int ee_err;
+
+static void EeDone(void* ctx, int err)
+{
+    (void)ctx;
+    ++ee_done;
+    ee_err |= err;
+}
+
+// main loop passes every 100 us until the queue is empty, returns ms
+static uint32_t EeDrain(void)
+{
+    uint32_t start = HAL_Tick;
+    for (int us = 0; !eeprom_async_idle() && us < 1000000; us += 100) {
+        HAL_Tick = start + us / 1000;
+        eeprom_async_poll();
+    }
+    return HAL_Tick - start;
+}
+
+BOOST_AUTO_TEST_CASE(eeprom_async_pages_test)
+{
+    uint8_t out[200], in[200] = {};
+
+    for (int i = 0; i < 200; ++i) {
+        out[i] = i * 7;
+    }
+
+    eeprom_async_init();
+    fake_page_writes = 0;
+    fake_nacked = 0;
+    ee_done = 0;
+    ee_err = 0;
+
+    // 24 + 64 + 64 + 48 bytes; the read waits for the last write cycle
+    BOOST_TEST(eeprom_async_write(0x7000 + 40, out, 200, EeDone, NULL) == 0);
+    BOOST_TEST(eeprom_async_read(0x7000 + 40, in, 200, EeDone, NULL) == 0);
+    BOOST_TEST(ee_done == 0);
+
+    uint32_t ms = EeDrain();
+    BOOST_TEST_MESSAGE("200 B over " << fake_page_writes << " pages written"
+        " and read back in " << ms << " ms, main loop never blocked");
+
+    BOOST_TEST(ee_done == 2);
+    BOOST_TEST(ee_err == 0);
+    BOOST_TEST(fake_page_writes == 4);
+    BOOST_TEST(fake_nacked == 0);
+    BOOST_TEST(std::memcmp(in, out, 200) == 0);
+    // ACK polling ends each cycle within a poll of the device being ready
+    BOOST_TEST(ms <= 4 * FAKE_TWC_MS + 1);
+}
+
+BOOST_AUTO_TEST_CASE(eeprom_async_queue_test)
+{
+    uint8_t b = 0;
+
+    eeprom_async_init();
+    for (int i = 0; i < EEPROM_ASYNC_QUEUE; ++i) {
+        BOOST_TEST(eeprom_async_write(0x7000, &b, 1, NULL, NULL) == 0);
+    }
+    BOOST_TEST(eeprom_async_write(0x7000, &b, 1, NULL, NULL) == 1);
+    EeDrain();
+    BOOST_TEST(eeprom_async_idle());
+}
+
+BOOST_AUTO_TEST_CASE(eeprom_async_runtime_test)
+{
+    struct vehicle_runtime vr, loaded;
+
+    eeprom_async_init();
+    init_vehicle_runtime(&vr);
+    load_vehicle_runtime(&loaded);
+
+    vr.total.dist_pulses = 123456;
+    vr.pow_consumed_mah = 777;
+    ee_done = 0;
+    ee_err = 0;
+    BOOST_TEST(save_vehicle_runtime_async(&vr, EeDone, NULL) == 0);
+    // one save at a time, the next stop tries again
+    BOOST_TEST(save_vehicle_runtime_async(&vr, EeDone, NULL) == 1);
+    // the queue took a copy
+    vr.pow_consumed_mah = 0;
+    EeDrain();
+    BOOST_TEST(ee_done == 1);
+    BOOST_TEST(ee_err == 0);
+
+    BOOST_TEST(load_vehicle_runtime(&loaded) == 0);
+    BOOST_TEST(loaded.total.dist_pulses == 123456u);
+    BOOST_TEST(loaded.pow_consumed_mah == 777);
+}
\ No newline at end of file
@@ -0,0 +1,120 @@
+#include "energy.h"
+
+#include <cmath>
+
+// 84 V battery, current swinging into regeneration: I = A + B sin(wt)
+static const double EN_A = 100;
+static const double EN_B = 150;
+static const double EN_PERIOD = 37;
+static const double EN_W = 2 * M_PI / EN_PERIOD;
+
+BOOST_AUTO_TEST_CASE(energy_accuracy_benchmark)
+{
+    struct energy e;
+    energy_init(&e);
+
+    // what logic.c used to do
+    float consumed_Ws = 0, recovered_Ws = 0;
+    float consumed_Wh = 0, recovered_Wh = 0;
+    // the same trapezoids summed in long double
+    long double ref_consumed = 0;
+
+    // ~4 h of whole periods
+    const int periods = 389;
+    const double T = periods * EN_PERIOD;
+
+    // analytic energy in Wh, sin(wt) > -A/B on (-alpha, pi + alpha)
+    double alpha = std::asin(EN_A / EN_B);
+    double exact_consumed = 84.0 * periods
+        * (EN_A * (M_PI + 2 * alpha) + 2 * EN_B * std::cos(alpha))
+        / EN_W / 10 / 3600;
+    double exact_net = 84.0 * EN_A / 10 * T / 3600;
+    double exact_recovered = exact_consumed - exact_net;
+
+    uint32_t ms = 0;
+    uint32_t fold_ms = 0;
+    uint32_t seed = 1;
+    int32_t prev_mw = 84 * (int32_t)EN_A * 100;
+
+    energy_sample(&e, 840, (int16_t)EN_A, 0);
+
+    while (true) {
+        // 50 ms frames with +-3 ms jitter
+        seed = seed * 1103515245 + 12345;
+        uint32_t dt = 47 + (seed >> 16) % 7;
+        if (ms + dt > T * 1000) {
+            break;
+        }
+        ms += dt;
+
+        int16_t da = (int16_t)std::lround(EN_A + EN_B * std::sin(EN_W * ms / 1000.0));
+        int32_t mw = 840 * da * 10;
+
+        energy_sample(&e, 840, da, dt);
+
+        if (prev_mw >= 0 && mw >= 0) {
+            ref_consumed += (long double)(prev_mw + mw) * dt / 2000;
+        }
+        prev_mw = mw;
+
+        float Ws = (float)da * 840 * dt / 100000.0;
+        if (da > 0) {
+            consumed_Ws += Ws;
+        } else {
+            recovered_Ws -= Ws;
+        }
+        if (ms - fold_ms >= 10000) {
+            fold_ms = ms;
+            consumed_Wh += consumed_Ws / 3600.0;
+            recovered_Wh += recovered_Ws / 3600.0;
+            consumed_Ws = 0;
+            recovered_Ws = 0;
+        }
+    }
+    consumed_Wh += consumed_Ws / 3600.0;
+    recovered_Wh += recovered_Ws / 3600.0;
+
+    double new_consumed = energy_consumed_mWs(&e) / 3600000.0;
+    double new_recovered = energy_recovered_mWs(&e) / 3600000.0;
+
+    BOOST_TEST_MESSAGE("4 h consumed Wh exact: " << exact_consumed
+        << " integer trapezoid: " << new_consumed
+        << " float rectangle: " << consumed_Wh);
+    BOOST_TEST_MESSAGE("4 h recovered Wh exact: " << exact_recovered
+        << " integer trapezoid: " << new_recovered
+        << " float rectangle: " << recovered_Wh);
+    BOOST_TEST_MESSAGE("4 h net Wh exact: " << exact_net
+        << " integer trapezoid: " << new_consumed - new_recovered
+        << " float rectangle: " << consumed_Wh - recovered_Wh);
+
+    // the accumulators lose nothing, the trapezoids that cross zero
+    // are split and excluded from the reference
+    BOOST_TEST((double)ref_consumed / 3600000 <= new_consumed);
+    BOOST_TEST(std::fabs(new_consumed - exact_consumed) < 0.1);
+    BOOST_TEST(std::fabs(new_recovered - exact_recovered) < 0.1);
+    BOOST_TEST(std::fabs(new_consumed - new_recovered - exact_net) / exact_net < 1e-5);
+    BOOST_TEST(e.gap_ms == 0);
+}
+
+BOOST_AUTO_TEST_CASE(energy_zero_crossing_and_gap_test)
+{
+    struct energy e;
+    energy_init(&e);
+
+    // 84 V, +10 A -> -10 A in 1 s: 210 Ws out, 210 Ws back
+    energy_sample(&e, 840, 100, 0);
+    energy_sample(&e, 840, -100, 1000);
+    BOOST_TEST(energy_consumed_mWs(&e) == 210000);
+    BOOST_TEST(energy_recovered_mWs(&e) == 210000);
+
+    // samples 5 s apart are not connected
+    energy_sample(&e, 840, 100, 5000);
+    BOOST_TEST(energy_consumed_mWs(&e) == 210000);
+    BOOST_TEST(e.gap_ms == 5000);
+
+    // 84 V, 10 A for 1 h: 840 Wh + the 210 Ws above
+    for (int i = 0; i < 72000; ++i) {
+        energy_sample(&e, 840, 100, 50);
+    }
+    BOOST_TEST(energy_to_dWh(energy_consumed_mWs(&e)) == 8401);
+}
\ No newline at end of file
@@ -0,0 +1,115 @@
+#include "faultlog.h"
+#include "logic.h"
+#include "ui.h"
+
+static struct faultlog test_fl;
+
+// the queue runs until the boot scan is through
+static void FaultLogOpen(struct faultlog* fl)
+{
+    BOOST_TEST(open_fault_log(fl) == 0);
+    for (int i = 0; i < 100 && !fl->opened; ++i) {
+        faultlog_poll(fl, HAL_Tick);
+        EeDrain();
+    }
+    BOOST_TEST(fl->opened);
+}
+
+static void FaultLogErase(void)
+{
+    std::vector<uint8_t> erased(FAULTLOG_SLOTS * FAULTLOG_RECORD, 0xff);
+
+    eeprom_async_init();
+    open_fault_log(&test_fl);
+    eeprom_24lc256_write(test_fl.base, erased.data(), erased.size());
+    eeprom_async_init();
+}
+
+BOOST_AUTO_TEST_CASE(faultlog_debounce_test)
+{
+    int raw_changes = 0;
+    uint16_t prev = 0;
+
+    FaultLogErase();
+    FaultLogOpen(&test_fl);
+    fake_page_writes = 0;
+
+    // 10 minutes of electric messages at 10 Hz: a loose battery sensor
+    // connector glitching for 1 or 2 messages now and then, the amp
+    // sensor out for a minute twice, the harness of the temperature
+    // sensors pulled off the last 30 s
+    for (int t = 0; t < 6000; ++t) {
+        uint16_t bits = 0;
+        if (t % 37 < 2) {
+            bits |= BCP_FAULT_BATT_T_SENS;
+        }
+        if ((t >= 1000 && t < 1600) || (t >= 3000 && t < 3600)) {
+            bits |= BCP_FAULT_AMP_SENS;
+        }
+        if (t >= 5700) {
+            bits |= BCP_FAULT_MOTO_T_SENS | BCP_FAULT_BATT_T_SENS
+                | BCP_FAULT_DRV_T_SENS;
+        }
+        raw_changes += __builtin_popcount(bits ^ prev);
+        prev = bits;
+
+        faultlog_update(&test_fl, bits, FAULT_MB_MASK, 1000 + t / 100, t / 10);
+        HAL_Tick += 100;
+        faultlog_poll(&test_fl, HAL_Tick);
+        EeDrain();
+    }
+    faultlog_flush(&test_fl);
+    faultlog_poll(&test_fl, HAL_Tick);
+    EeDrain();
+
+    BOOST_TEST_MESSAGE("fault bit changes: " << raw_changes << " events: "
+        << test_fl.events << " page writes: " << fake_page_writes);
+    // the glitches are not events, 2 onsets + 2 clears + 3 onsets are,
+    // the last 3 in one write
+    BOOST_TEST(test_fl.events == 7);
+    BOOST_TEST(test_fl.stat[0].count == 2);
+    BOOST_TEST(test_fl.stat[1].count == 1);
+    BOOST_TEST(test_fl.stat[2].count == 1);
+    BOOST_TEST(test_fl.stat[3].count == 1);
+    BOOST_TEST(test_fl.lost == 0);
+    BOOST_TEST(fake_page_writes == 5);
+
+    // a reboot with the sensors still off
+    struct faultlog fl;
+    fl.base = test_fl.base;
+    FaultLogOpen(&fl);
+    BOOST_TEST(fl.next_seq == test_fl.next_seq);
+    uint16_t harness = BCP_FAULT_MOTO_T_SENS | BCP_FAULT_BATT_T_SENS
+        | BCP_FAULT_DRV_T_SENS;
+    BOOST_TEST(fl.active == harness);
+    BOOST_TEST(fl.stat[0].count == 2);
+    BOOST_TEST(fl.stat[0].last_hm == 1030);
+    BOOST_TEST(fl.stat[3].count == 1);
+    for (int t = 0; t < 50; ++t) {
+        faultlog_update(&fl, harness, FAULT_MB_MASK, 1060, t / 10);
+    }
+    BOOST_TEST(fl.events == 0);
+}
+
+BOOST_AUTO_TEST_CASE(faultlog_logic_test)
+{
+    FaultLogErase();
+    logic_init();
+    // the main loop spins while the fault log is read
+    for (int i = 0; i < 200; ++i) {
+        HAL_Tick += 1;
+        logic_update();
+    }
+    for (int i = 0; i < 30; ++i) {
+        HAL_Tick += 100;
+        InsertCanMessage(BuildElectricMsg(800, 20, BCP_FAULT_BATT_T_SENS));
+        logic_update();
+    }
+    ui_set_display_mode(DM_FAULTS);
+    HAL_Tick += 100;
+    logic_update();
+
+    BOOST_TEST(hd44780_get_line1().find("Batt Tsens") == 0);
+    BOOST_TEST(hd44780_get_line1().find("x1") != std::string::npos);
+    BOOST_TEST(hd44780_get_line2().find("ON") == 0);
+}
\ No newline at end of file
@@ -0,0 +1,84 @@
+#include "fmt.h"
+
+#include <string>
+
+// fmt_unit into a blank line, unit in the last column
+static std::string Unit(uint32_t v, uint8_t dp)
+{
+    char line[6] = "     ";
+    fmt_unit(line, 4, v, dp, 'W');
+    return line;
+}
+
+static std::string Int(int32_t v)
+{
+    char buf[12];
+    return std::string(buf, fmt_int(buf, v));
+}
+
+static std::string Fixed(uint32_t v, uint8_t dp, uint8_t prec)
+{
+    char buf[16];
+    return std::string(buf, fmt_fixed(buf, v, dp, prec));
+}
+
+BOOST_AUTO_TEST_CASE(fmt_div_round_test)
+{
+    // x.5 goes to the even neighbour, both ways
+    BOOST_TEST(fmt_div_round(5, 10) == 0u);
+    BOOST_TEST(fmt_div_round(15, 10) == 2u);
+    BOOST_TEST(fmt_div_round(25, 10) == 2u);
+    BOOST_TEST(fmt_div_round(35, 10) == 4u);
+    BOOST_TEST(fmt_div_round(7, 2) == 4u);
+    BOOST_TEST(fmt_div_round(9, 2) == 4u);
+    // everything else to the nearest
+    BOOST_TEST(fmt_div_round(24, 10) == 2u);
+    BOOST_TEST(fmt_div_round(26, 10) == 3u);
+    BOOST_TEST(fmt_div_round(0, 7) == 0u);
+    BOOST_TEST(fmt_div_round(10, 3) == 3u);
+    BOOST_TEST(fmt_div_round(11, 3) == 4u);
+    // no overflow at the top of the range
+    BOOST_TEST(fmt_div_round(0xffffffffu, 2) == 0x80000000u);
+    BOOST_TEST(fmt_div_round(0xfffffffeu, 4) == 0x40000000u);
+
+    // what "%.1f" prints
+    BOOST_TEST(Fixed(845, 2, 1) == "8.4");
+    BOOST_TEST(Fixed(855, 2, 1) == "8.6");
+    BOOST_TEST(Fixed(995, 2, 1) == "10.0");
+    BOOST_TEST(Fixed(841, 1, 2) == "84.10");
+    BOOST_TEST(Fixed(7, 0, 0) == "7");
+}
+
+BOOST_AUTO_TEST_CASE(fmt_int_test)
+{
+    BOOST_TEST(Int(0) == "0");
+    BOOST_TEST(Int(42) == "42");
+    BOOST_TEST(Int(-1) == "-1");
+    BOOST_TEST(Int(-305) == "-305");
+    BOOST_TEST(Int(INT32_MAX) == "2147483647");
+    BOOST_TEST(Int(INT32_MIN) == "-2147483648");
+}
+
+BOOST_AUTO_TEST_CASE(fmt_unit_test)
+{
+    BOOST_TEST(Unit(0, 0) == "   0W");
+    BOOST_TEST(Unit(9, 2) == "   0W");
+    BOOST_TEST(Unit(9, 1) == " 0.9W");
+    BOOST_TEST(Unit(84, 1) == " 8.4W");
+    BOOST_TEST(Unit(841, 1) == "84.1W");
+    BOOST_TEST(Unit(840, 0) == " 840W");
+
+    // the k switch, whole units
+    BOOST_TEST(Unit(999, 0) == " 999W");
+    BOOST_TEST(Unit(1000, 0) == "1.0kW");
+    BOOST_TEST(Unit(1049, 0) == "1.0kW");
+    BOOST_TEST(Unit(1051, 0) == "1.1kW");
+    // and with a decimal place, 999.5 rounds to even 1000
+    BOOST_TEST(Unit(9994, 1) == " 999W");
+    BOOST_TEST(Unit(9995, 1) == "1.0kW");
+    // 9.95k rounds to 10k, never "10.0k"
+    BOOST_TEST(Unit(9949, 0) == "9.9kW");
+    BOOST_TEST(Unit(9950, 0) == " 10kW");
+    BOOST_TEST(Unit(67000, 0) == " 67kW");
+    BOOST_TEST(Unit(999499, 0) == "999kW");
+}
\ No newline at end of file
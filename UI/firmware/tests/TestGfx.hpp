@@ -0,0 +1,231 @@
+#include "logic.h"
+#include "ui.h"
+#include "ui_layout.h"
+#include "lcd_bus.h"
+#include "lcd_gfx.h"
+#include "Helpers.hpp"
+
+#include <lrr_hd44780.h>
+
+// the controller behind lcd_bus: the address counter walks DDRAM or CGRAM,
+// the DDRAM rows are mirrored into the puppet the text checks read
+static uint8_t fake_lcd_addr;
+static uint8_t fake_lcd_cgram;
+static char fake_lcd_ddram[UI_ROWS][UI_COLS + 1];
+// bytes written to the CGRAM and the DDRAM
+static uint32_t fake_cgram_writes;
+static uint32_t fake_ddram_writes;
+// what lcd_bus_busy_flag_used() reports
+static uint8_t fake_busy_flag;
+
+static void FakeLcdShow(uint8_t row)
+{
+    lcd_println(fake_lcd_ddram[row], row);
+}
+
+extern "C" void lcd_bus_init(void)
+{
+    fake_lcd_addr = 0;
+    fake_lcd_cgram = 0;
+}
+
+extern "C" uint8_t lcd_bus_busy_flag_used(void)
+{
+    return fake_busy_flag;
+}
+
+extern "C" void lcd_bus_cmd(uint8_t cmd)
+{
+    if (cmd & LCD_CMD_DDRAM_ADDR) {
+        fake_lcd_cgram = 0;
+        fake_lcd_addr = cmd & ~LCD_CMD_DDRAM_ADDR;
+    } else if (cmd & LCD_CMD_CGRAM_ADDR) {
+        fake_lcd_cgram = 1;
+        fake_lcd_addr = cmd & ~LCD_CMD_CGRAM_ADDR;
+    } else if (cmd == LCD_CMD_CLEAR) {
+        fake_lcd_cgram = 0;
+        fake_lcd_addr = 0;
+        for (uint8_t r = 0; r < UI_ROWS; ++r) {
+            std::memset(fake_lcd_ddram[r], ' ', UI_COLS);
+            fake_lcd_ddram[r][UI_COLS] = '\0';
+            FakeLcdShow(r);
+        }
+    }
+}
+
+extern "C" void lcd_bus_data(uint8_t data)
+{
+    uint8_t a = fake_lcd_addr++;
+
+    if (fake_lcd_cgram) {
+        ++fake_cgram_writes;
+        return;
+    }
+    ++fake_ddram_writes;
+    uint8_t row = a >= LCD_ROW1_ADDR;
+    uint8_t col = a - (row ? LCD_ROW1_ADDR : 0);
+    if (col < UI_COLS) {
+        fake_lcd_ddram[row][col] = data;
+        FakeLcdShow(row);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(battery_bar_incremental_glyphs_test)
+{
+    logic_init();
+    ui_set_display_mode(DM_BAR);
+
+    // the percentage comes from the charge counter, set it directly
+    struct vehicle_gauges g = {};
+    g.batt_dv = 725;
+    g.amper_da = 10;
+    g.power_cw = 7250;
+
+    // --------------------------------------------------------------
+    // 42% => 4 full blocks + 1/5 of a block
+    g.batt_perc = 42;
+    ui_update(&g);
+    std::string line = hd44780_get_line1();
+    BOOST_TEST(line.substr(0, 4) == std::string(4, '\xFF'));
+    BOOST_TEST(line[4] >= 8);
+    BOOST_TEST(line[4] < 16);
+    BOOST_TEST(line.substr(5, 5) == "     ");
+    BOOST_TEST(line.substr(10) == " 72.5W");
+
+    uint32_t uploads = gfx_glyph_uploads();
+    // --------------------------------------------------------------
+    // the same frame again, nothing to upload
+    ui_update(&g);
+    BOOST_TEST(uploads == gfx_glyph_uploads());
+    // --------------------------------------------------------------
+    // 2% => the same partial glyph is reused
+    g.batt_perc = 2;
+    ui_update(&g);
+    line = hd44780_get_line1();
+    BOOST_TEST(line[0] >= 8);
+    BOOST_TEST(uploads == gfx_glyph_uploads());
+    // --------------------------------------------------------------
+    // 10% => exactly one full block
+    g.batt_perc = 10;
+    ui_update(&g);
+    line = hd44780_get_line1();
+    BOOST_TEST(line.substr(0, 10) == std::string(1, '\xFF') + "         ");
+    BOOST_TEST(uploads == gfx_glyph_uploads());
+}
+
+BOOST_AUTO_TEST_CASE(power_sparkline_test)
+{
+    logic_init();
+    ui_set_display_mode(DM_SPARK);
+
+    // a point per UI_SPARK_MS
+    for (int i = 1; i <= 10; ++i) {
+        for (int t = 0; t < UI_SPARK_MS / UI_TICK_MS; ++t) {
+            HAL_Tick += UI_TICK_MS;
+            InsertCanMessage(BuildElectricMsg(800, i * 10));
+            logic_update();
+        }
+    }
+
+    // heights 1..8 => at most 7 distinct glyphs
+    std::string line = hd44780_get_line1();
+    BOOST_TEST(line[9] == '\xFF');
+    BOOST_TEST(line.substr(10) == "  800W");
+    uint32_t uploads = gfx_glyph_uploads();
+
+    // scrolling a constant signal needs no new glyphs
+    for (int i = 0; i < 10 * UI_SPARK_MS / UI_TICK_MS; ++i) {
+        HAL_Tick += UI_TICK_MS;
+        InsertCanMessage(BuildElectricMsg(800, 100));
+        logic_update();
+    }
+    line = hd44780_get_line1();
+    BOOST_TEST(line.substr(0, 10) == std::string(10, '\xFF'));
+    BOOST_TEST(uploads == gfx_glyph_uploads());
+
+    // a quiet tick is averaged into the open point, nothing scrolls yet
+    HAL_Tick += UI_TICK_MS;
+    InsertCanMessage(BuildElectricMsg(800, 0));
+    logic_update();
+    line = hd44780_get_line1();
+    BOOST_TEST(line.substr(0, 10) == std::string(10, '\xFF'));
+}
+
+
+// what reaches the CGRAM per frame, counted on the bus
+BOOST_AUTO_TEST_CASE(glyph_upload_bound_test)
+{
+    logic_init();
+    struct vehicle_gauges g = {};
+    g.batt_dv = 725;
+
+    // a sweep of the bar changes at most its partial block a frame
+    ui_set_display_mode(DM_BAR);
+    uint32_t uploads = gfx_glyph_uploads();
+    uint32_t writes = fake_cgram_writes;
+    for (int pass = 0; pass < 2; ++pass) {
+        for (int perc = 0; perc <= 100; ++perc) {
+            g.batt_perc = perc;
+            uint32_t before = fake_cgram_writes;
+            ui_update(&g);
+            BOOST_TEST(fake_cgram_writes - before <= (uint32_t)GFX_GLYPH_ROWS);
+            // the redraw of the same frame
+            before = fake_cgram_writes;
+            ui_update(&g);
+            BOOST_TEST(fake_cgram_writes == before);
+        }
+    }
+    // the five partial blocks, the sweep back reuses them
+    BOOST_TEST(fake_cgram_writes - writes <= 2u * 4 * GFX_GLYPH_ROWS);
+
+    // a changing sparkline never uploads more than all the slots a frame
+    ui_set_display_mode(DM_SPARK);
+    std::srand(5);
+    for (int point = 0; point < 40; ++point) {
+        g.power_cw = (std::rand() % 2000) * 100;
+        int uploading = 0;
+        for (int t = 0; t < UI_SPARK_MS / UI_TICK_MS; ++t) {
+            uint32_t before = fake_cgram_writes;
+            ui_update(&g);
+            uint32_t frame = fake_cgram_writes - before;
+            BOOST_TEST(frame <= (uint32_t)GFX_GLYPHS * GFX_GLYPH_ROWS);
+            uploading += frame > 0;
+        }
+        // only the frame scrolling in a new point
+        BOOST_TEST(uploading <= 1);
+    }
+
+    // and the uploads the gfx counts are the ones on the bus
+    BOOST_TEST(fake_cgram_writes - writes
+        == (gfx_glyph_uploads() - uploads) * GFX_GLYPH_ROWS);
+}
+
+BOOST_AUTO_TEST_CASE(busy_flag_fallback_redraw_test)
+{
+    fake_busy_flag = 1;
+    logic_init();
+    ui_set_display_mode(DM_BAR);
+
+    struct vehicle_gauges g = {};
+    g.batt_dv = 725;
+    g.batt_perc = 42;
+    ui_update(&g);
+    ui_update(&g);
+    std::string line = hd44780_get_line1();
+
+    // the flag times out: the partial block and both rows go out again
+    fake_busy_flag = 0;
+    uint32_t cgram = fake_cgram_writes;
+    uint32_t ddram = fake_ddram_writes;
+    ui_update(&g);
+    BOOST_TEST(fake_cgram_writes - cgram == (uint32_t)GFX_GLYPH_ROWS);
+    BOOST_TEST(fake_ddram_writes - ddram == 2u * UI_COLS);
+    BOOST_TEST(hd44780_get_line1() == line);
+
+    // once
+    cgram = fake_cgram_writes;
+    ddram = fake_ddram_writes;
+    ui_update(&g);
+    BOOST_TEST(fake_cgram_writes == cgram);
+    BOOST_TEST(fake_ddram_writes == ddram);
+}
\ No newline at end of file
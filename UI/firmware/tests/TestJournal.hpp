@@ -0,0 +1,159 @@
+#include "journal.h"
+#include "crc.h"
+#include "persist.h"
+
+#include <cstring>
+#include <cstdlib>
+
+// EEPROM of the journal tests, writes past `budget` bytes are lost as
+// at a power cut
+static uint8_t journal_mem[4096];
+static int journal_write_budget = -1;
+static int journal_reads;
+static int journal_page_writes[4096 / JOURNAL_HW_PAGE];
+
+static HAL_StatusTypeDef JournalRead(uint16_t addr, uint8_t* d, uint16_t s)
+{
+    ++journal_reads;
+    std::memcpy(d, journal_mem + addr, s);
+    return HAL_OK;
+}
+
+static HAL_StatusTypeDef JournalWrite(uint16_t addr, const uint8_t* d,
+    uint16_t s)
+{
+    // the journal splits at the page boundary
+    BOOST_TEST(addr / JOURNAL_HW_PAGE == (addr + s - 1) / JOURNAL_HW_PAGE);
+    ++journal_page_writes[addr / JOURNAL_HW_PAGE];
+    for (uint16_t i = 0; i < s; ++i) {
+        if (journal_write_budget == 0) {
+            return HAL_ERROR;
+        }
+        if (journal_write_budget > 0) {
+            --journal_write_budget;
+        }
+        journal_mem[addr + i] = d[i];
+    }
+    return HAL_OK;
+}
+
+static void JournalErase(void)
+{
+    std::memset(journal_mem, 0xff, sizeof(journal_mem));
+    std::memset(journal_page_writes, 0, sizeof(journal_page_writes));
+    journal_write_budget = -1;
+}
+
+// a stop of a ride: the odometer, time and charge move on
+static void JournalRide(struct vehicle_runtime& vr, int i)
+{
+    vr.total.dist_pulses += 1000 + i % 700;
+    vr.total.travel_time_s += 300 + i % 100;
+    vr.pow_consumed_mah += 50;
+    vr.cycle_mah = (vr.cycle_mah + 50) % 48000;
+    if (i % 50 == 0) {
+        vr.trip1.dist_pulses = vr.total.dist_pulses;
+        vr.current_display_mode = i % 7;
+    }
+}
+
+struct JournalImage
+{
+    uint8_t b[PERSIST_RUNTIME_SIZE];
+
+    explicit JournalImage(const struct vehicle_runtime& vr)
+    {
+        persist_encode_runtime(&vr, b);
+    }
+};
+
+BOOST_AUTO_TEST_CASE(journal_crc_test)
+{
+    const uint8_t check[] = "123456789";
+    BOOST_TEST(crc16(CRC16_INIT, check, 9) == 0x29b1);
+}
+
+BOOST_AUTO_TEST_CASE(journal_roundtrip_test)
+{
+    struct journal j;
+    struct vehicle_runtime vr;
+    uint8_t loaded[PERSIST_RUNTIME_SIZE];
+    const int saves = 3200;
+
+    JournalErase();
+    init_vehicle_runtime(&vr);
+    journal_init(&j, 0, 32, PERSIST_RUNTIME_SIZE, JournalRead, JournalWrite);
+    BOOST_TEST(journal_open(&j, loaded) == 1);
+
+    for (int i = 1; i <= saves; ++i) {
+        JournalRide(vr, i);
+        BOOST_TEST(journal_append(&j, JournalImage(vr).b) == 0);
+
+        if (i % 97 == 0 || i == saves) {
+            struct journal k;
+            journal_init(&k, 0, 32, PERSIST_RUNTIME_SIZE, JournalRead,
+                JournalWrite);
+            journal_reads = 0;
+            BOOST_TEST(journal_open(&k, loaded) == 0);
+            BOOST_TEST(std::memcmp(loaded, JournalImage(vr).b,
+                PERSIST_RUNTIME_SIZE) == 0);
+            BOOST_TEST(k.next_seq == j.next_seq);
+            // 2 reads a record: slots 0 and 1, up to 2 probes in each of
+            // the 5 search steps, the newest, a chain of 16 back and forth
+            BOOST_TEST(journal_reads
+                <= 2 * (2 + 2 * 5 + 1 + 2 * JOURNAL_FULL_EVERY));
+        }
+    }
+
+    // an unchanged image is not written again
+    BOOST_TEST(journal_append(&j, JournalImage(vr).b) == 0);
+    BOOST_TEST(j.next_seq == (uint32_t)saves);
+
+    int max_page = 0;
+    for (int w : journal_page_writes) {
+        max_page = std::max(max_page, w);
+    }
+    BOOST_TEST_MESSAGE("journal: " << saves << " saves, " << j.full_writes
+        << " full " << j.delta_writes << " delta, "
+        << j.bytes_written / saves << " B/save vs " << PERSIST_RUNTIME_SIZE
+        << " B, worst slot " << journal_max_slot_writes(&j)
+        << " writes, worst page " << max_page << " writes");
+    BOOST_TEST(journal_max_slot_writes(&j) == (uint32_t)saves / 32);
+    BOOST_TEST(max_page <= saves / 32);
+    BOOST_TEST(j.bytes_written < saves * PERSIST_RUNTIME_SIZE / 2);
+}
+
+BOOST_AUTO_TEST_CASE(journal_power_cut_test)
+{
+    struct vehicle_runtime vr, prev;
+    uint8_t loaded[PERSIST_RUNTIME_SIZE];
+
+    JournalErase();
+    init_vehicle_runtime(&vr);
+    std::srand(7);
+
+    for (int i = 1; i <= 500; ++i) {
+        struct journal j;
+        journal_init(&j, 0, 32, PERSIST_RUNTIME_SIZE, JournalRead,
+            JournalWrite);
+        if (i > 1) {
+            BOOST_TEST(journal_open(&j, loaded) == 0);
+            BOOST_TEST(std::memcmp(loaded, JournalImage(prev).b,
+                PERSIST_RUNTIME_SIZE) == 0);
+            persist_decode_runtime(&vr, loaded, PERSIST_RUNTIME_SIZE);
+        }
+
+        // every third save the power goes somewhere within the record
+        prev = vr;
+        JournalRide(vr, i);
+        if (i % 3 == 0) {
+            journal_write_budget = std::rand() % 20;
+            BOOST_TEST(journal_append(&j, JournalImage(vr).b) == 1);
+            journal_write_budget = -1;
+            vr = prev;
+        } else {
+            BOOST_TEST(journal_append(&j, JournalImage(vr).b) == 0);
+            prev = vr;
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,165 @@
+#include "lcd_bus.h"
+#include "bench.h"
+#include "main.h"
+
+#include <lrr_usart.h>
+
+// the pins lcd_bus drives and the HD44780 behind them
+static struct {
+    // RW reaches the controller, otherwise it is tied low
+    bool rw_wired;
+    // reads reporting busy after every byte written
+    uint32_t busy_reads;
+    uint32_t busy_left;
+    uint32_t data_mode;
+    uint32_t data_pull;
+    GPIO_PinState rw;
+    GPIO_PinState e;
+    uint32_t nibbles;
+    // D7 reads and E pulses taken as writes by the controller
+    uint32_t reads;
+    uint32_t writes;
+} fake_bus;
+
+static void FakeBusGpioInit(GPIO_TypeDef*, GPIO_InitTypeDef* init)
+{
+    if (init->Pin & LCD_D7_Pin) {
+        fake_bus.data_mode = init->Mode;
+        fake_bus.data_pull = init->Pull;
+    }
+}
+
+static void FakeBusWritePin(GPIO_TypeDef*, uint16_t pin, GPIO_PinState s)
+{
+    if (pin == LCD_RW_Pin) {
+        fake_bus.rw = s;
+    } else if (pin == LCD_E_Pin) {
+        bool falling = fake_bus.e == GPIO_PIN_SET && s == GPIO_PIN_RESET;
+        bool write = !fake_bus.rw_wired || fake_bus.rw == GPIO_PIN_RESET;
+        fake_bus.e = s;
+        // the controller latches on the falling edge, a byte every two
+        if (falling && write) {
+            ++fake_bus.writes;
+            if (++fake_bus.nibbles % 2 == 0) {
+                fake_bus.busy_left = fake_bus.busy_reads;
+            }
+        }
+    }
+}
+
+static GPIO_PinState FakeBusReadPin(GPIO_TypeDef*, uint16_t pin)
+{
+    BOOST_TEST(pin == LCD_D7_Pin);
+    BOOST_TEST(fake_bus.data_mode == (uint32_t)GPIO_MODE_INPUT);
+    BOOST_TEST(fake_bus.e == GPIO_PIN_SET);
+    ++fake_bus.reads;
+
+    if (!fake_bus.rw_wired) {
+        // nobody drives the bus
+        return fake_bus.data_pull == GPIO_PULLUP ? GPIO_PIN_SET : GPIO_PIN_RESET;
+    }
+    if (fake_bus.busy_left) {
+        --fake_bus.busy_left;
+        return GPIO_PIN_SET;
+    }
+    return GPIO_PIN_RESET;
+}
+
+// the real lcd_bus.c against the pins above, apart from the fake the UI
+// tests link
+namespace real_lcd_bus {
+// used before its definition, would resolve to the fake otherwise
+void lcd_bus_reset_stats(void);
+#define HAL_GPIO_Init FakeBusGpioInit
+#define HAL_GPIO_WritePin FakeBusWritePin
+#define HAL_GPIO_ReadPin FakeBusReadPin
+#include "../Src/lcd_bus.c"
+#undef HAL_GPIO_Init
+#undef HAL_GPIO_WritePin
+#undef HAL_GPIO_ReadPin
+}
+
+static void FakeBusReset(bool rw_wired, uint32_t busy_reads)
+{
+    fake_bus = {};
+    fake_bus.rw_wired = rw_wired;
+    fake_bus.busy_reads = busy_reads;
+    real_lcd_bus::lcd_bus_init();
+    real_lcd_bus::lcd_bus_use_busy_flag(1);
+}
+
+BOOST_AUTO_TEST_CASE(lcd_bus_ready_test)
+{
+    FakeBusReset(true, 3);
+
+    real_lcd_bus::lcd_bus_cmd(LCD_CMD_DDRAM_ADDR);
+    for (int i = 0; i < 16; ++i) {
+        real_lcd_bus::lcd_bus_data('a' + i);
+    }
+    real_lcd_bus::lcd_bus_cmd(LCD_CMD_CLEAR);
+
+    const struct lcd_bus_stats* st = real_lcd_bus::lcd_bus_get_stats();
+    BOOST_TEST(st->commands == 18u);
+    BOOST_TEST(st->timeouts == 0u);
+    // 3 busy reads and the ready one, never the worst case
+    BOOST_TEST(fake_bus.reads == 18u * 4);
+    BOOST_TEST(st->actual_us < st->assumed_us);
+    BOOST_TEST(st->max_actual_us < LCD_CMD_US);
+    BOOST_TEST(real_lcd_bus::lcd_bus_busy_flag_used() == 1);
+    // the bus is handed back as outputs
+    BOOST_TEST(fake_bus.data_mode == (uint32_t)GPIO_MODE_OUTPUT_PP);
+    BOOST_TEST(fake_bus.rw == GPIO_PIN_RESET);
+}
+
+BOOST_AUTO_TEST_CASE(lcd_bus_stuck_busy_test)
+{
+    // RW tied low: the pulled up D7 floats busy
+    FakeBusReset(false, 0);
+
+    for (int i = 0; i < LCD_BUS_MAX_TIMEOUTS - 1; ++i) {
+        BOOST_TEST(real_lcd_bus::lcd_bus_wait_ready(LCD_CMD_US) == 0);
+        BOOST_TEST(real_lcd_bus::lcd_bus_busy_flag_used() == 1);
+    }
+    // every read is two pulses, the controller stays on byte boundaries
+    BOOST_TEST(fake_bus.writes % 2 == 0u);
+
+    real_lcd_bus::lcd_bus_data('x');
+    BOOST_TEST(real_lcd_bus::lcd_bus_busy_flag_used() == 0);
+    BOOST_TEST(real_lcd_bus::lcd_bus_get_stats()->timeouts
+        == (uint32_t)LCD_BUS_MAX_TIMEOUTS);
+
+    // fixed delays from now on, the bus is not read anymore
+    uint32_t reads = fake_bus.reads;
+    uint32_t actual = real_lcd_bus::lcd_bus_get_stats()->actual_us;
+    real_lcd_bus::lcd_bus_cmd(LCD_CMD_CLEAR);
+    BOOST_TEST(fake_bus.reads == reads);
+    BOOST_TEST(real_lcd_bus::lcd_bus_get_stats()->actual_us - actual
+        >= (uint32_t)LCD_CLEAR_HOME_US);
+}
+
+BOOST_AUTO_TEST_CASE(lcd_bus_recovered_flag_test)
+{
+    // busy for longer than any command
+    FakeBusReset(true, 100000);
+
+    for (int i = 0; i < LCD_BUS_MAX_TIMEOUTS - 1; ++i) {
+        real_lcd_bus::lcd_bus_data('x');
+    }
+    BOOST_TEST(real_lcd_bus::lcd_bus_get_stats()->timeouts
+        == (uint32_t)LCD_BUS_MAX_TIMEOUTS - 1);
+
+    // one ready command starts the count over
+    fake_bus.busy_reads = 0;
+    real_lcd_bus::lcd_bus_data('x');
+    fake_bus.busy_reads = 100000;
+    for (int i = 0; i < LCD_BUS_MAX_TIMEOUTS - 1; ++i) {
+        real_lcd_bus::lcd_bus_data('x');
+    }
+    BOOST_TEST(real_lcd_bus::lcd_bus_busy_flag_used() == 1);
+    BOOST_TEST(real_lcd_bus::lcd_bus_get_stats()->timeouts
+        == 2u * (LCD_BUS_MAX_TIMEOUTS - 1));
+
+    // and the next one in a row switches the flag off
+    real_lcd_bus::lcd_bus_data('x');
+    BOOST_TEST(real_lcd_bus::lcd_bus_busy_flag_used() == 0);
+}
\ No newline at end of file
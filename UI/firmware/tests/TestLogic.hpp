@@ -54,12 +54,13 @@ BOOST_AUTO_TEST_CASE(electric_static_test, * utf::tolerance(0.01))
               //----------------
     BOOST_TEST("84.0V 100%  800A" == hd44780_get_line2());
     // --------------------------------------------------------------
+    // the charge is counted, a sagging voltage does not change it
     InsertCanMessage(BuildElectricMsg(640, 1200));
     logic_update();
               //----------------
     BOOST_TEST(" 7.7kW    0Wh/km" == hd44780_get_line1());
               //----------------
-    BOOST_TEST("64.0V   0%  120A" == hd44780_get_line2());
+    BOOST_TEST("64.0V 100%  120A" == hd44780_get_line2());
     // --------------------------------------------------------------
     // battery charging
     InsertCanMessage(BuildElectricMsg(600, -1));
@@ -67,21 +68,21 @@ BOOST_AUTO_TEST_CASE(electric_static_test, * utf::tolerance(0.01))
               //----------------
     BOOST_TEST("+ 6.0W    0Wh/km" == hd44780_get_line1());
               //----------------
-    BOOST_TEST("60.0V   0%  0.1A" == hd44780_get_line2());
+    BOOST_TEST("60.0V 100%  0.1A" == hd44780_get_line2());
     // --------------------------------------------------------------
     InsertCanMessage(BuildElectricMsg(645, -9));
     logic_update();
               //----------------
     BOOST_TEST("+58.0W    0Wh/km" == hd44780_get_line1());
               //----------------
-    BOOST_TEST("64.5V   2%  0.9A" == hd44780_get_line2());
+    BOOST_TEST("64.5V 100%  0.9A" == hd44780_get_line2());
     // --------------------------------------------------------------
     InsertCanMessage(BuildElectricMsg(725, -109));
     logic_update();
               //----------------
     BOOST_TEST("+ 790W    0Wh/km" == hd44780_get_line1());
               //----------------
-    BOOST_TEST("72.5V  42% 10.9A" == hd44780_get_line2());
+    BOOST_TEST("72.5V 100% 10.9A" == hd44780_get_line2());
     // --------------------------------------------------------------
 }
 
@@ -112,4 +113,42 @@ BOOST_AUTO_TEST_CASE(electric_Wh_km_c_test, * utf::tolerance(0.01))
 
               //----------------
     BOOST_TEST("    0W 63.7Wh/km" == hd44780_get_line1());
+}
+BOOST_AUTO_TEST_CASE(motion_restart_test)
+{
+    logic_init();
+    ui_set_display_mode(DM_TRIP1);
+
+    // 1.830 m == 16 pulses, 16 pulses per 0.5 s
+    HAL_Tick = 13;
+    uint32_t pulses = 0;
+
+    for (int i = 0; i < 200; ++i) {
+        InsertCanMessage(BuildMotionMsg(pulses));
+        logic_update();
+        HAL_Tick += 500;
+        pulses += 16;
+    }
+              //----------------
+    BOOST_TEST("13 km/h  0.3km-1" == hd44780_get_line1());
+
+    // the motherboard restarts, its counter starts over
+    pulses = 0;
+    for (int i = 0; i < 200; ++i) {
+        pulses += 16;
+        InsertCanMessage(BuildMotionMsg(pulses));
+        logic_update();
+        HAL_Tick += 500;
+    }
+    // the distance goes on instead of jumping by the wrapped counter
+              //----------------
+    BOOST_TEST("13 km/h  0.7km-1" == hd44780_get_line1());
+
+    // a corrupted counter jumps by far more than the wheel can turn
+    InsertCanMessage(BuildMotionMsg(pulses + 1000000));
+    logic_update();
+    HAL_Tick += 500;
+    InsertCanMessage(BuildMotionMsg(pulses + 1000016));
+    logic_update();
+    BOOST_TEST(hd44780_get_line1().substr(9) == "0.7km-1");
 }
\ No newline at end of file
@@ -0,0 +1,118 @@
+#include "persist.h"
+#include "journal.h"
+
+BOOST_AUTO_TEST_CASE(persist_roundtrip_test)
+{
+    struct vehicle_conf vc, vc2;
+    struct vehicle_runtime vr, vr2;
+    struct rint_history rh, rh2;
+    uint8_t b[64];
+
+    // the padding is compared too
+    std::memset(&vc, 0, sizeof(vc));
+    std::memset(&vc2, 0, sizeof(vc2));
+    std::memset(&rh2, 0, sizeof(rh2));
+    init_vehicle_conf(&vc);
+    vc.batt_p = 255;
+    vc.cell_cap_mah = 65535;
+    vc.reverse_curr = 1;
+    vc.dist_p_rev_mm = 2234;
+    vc.drv_t_alarm_c = 77;
+    BOOST_TEST(persist_encode_conf(&vc, b) == PERSIST_CONF_SIZE);
+    BOOST_TEST(persist_decode_conf(&vc2, b, PERSIST_CONF_SIZE) == 0);
+    BOOST_TEST(std::memcmp(&vc, &vc2, sizeof(vc)) == 0);
+
+    init_vehicle_runtime(&vr);
+    vr.last_batt_mv = 41550;
+    vr.full_batt_charge_cycles = 321;
+    vr.current_display_mode = 9;
+    vr.total.dist_pulses = 0xfedcba98;
+    vr.total.consumed_mah = 0x01020304;
+    vr.trip1.travel_time_s = 86400;
+    vr.trip2.max_speed_kmh = 45;
+    vr.pow_consumed_mah = 150000;
+    vr.cycle_mah = 480000;
+    vr.avg_dWh_km = 142;
+    BOOST_TEST(persist_encode_runtime(&vr, b) == PERSIST_RUNTIME_SIZE);
+    BOOST_TEST(persist_decode_runtime(&vr2, b, PERSIST_RUNTIME_SIZE) == 0);
+    BOOST_TEST(std::memcmp(&vr, &vr2, sizeof(vr)) == 0);
+
+    init_rint_history(&rh);
+    for (int i = 0; i < RINT_HISTORY; ++i) {
+        rh.mohm[i] = 60 + i * 1000;
+    }
+    rh.count = RINT_HISTORY;
+    BOOST_TEST(persist_encode_rint(&rh, b) == PERSIST_RINT_SIZE);
+    BOOST_TEST(persist_decode_rint(&rh2, b, PERSIST_RINT_SIZE) == 0);
+    BOOST_TEST(std::memcmp(&rh, &rh2, sizeof(rh)) == 0);
+
+    // a flipped bit is not taken for the current format
+    b[5] ^= 0x10;
+    BOOST_TEST(persist_decode_rint(&rh2, b, PERSIST_RINT_SIZE) == 1);
+
+    // nor for a raw struct, and neither is an erased page
+    BOOST_TEST(persist_encode_conf(&vc, b) == PERSIST_CONF_SIZE);
+    b[7] ^= 0x01;
+    BOOST_TEST(persist_decode_conf(&vc2, b, PERSIST_CONF_SIZE) == 1);
+    std::memset(b, 0xff, sizeof(b));
+    BOOST_TEST(persist_decode_conf(&vc2, b, PERSIST_CONF_SIZE) == 1);
+    BOOST_TEST(persist_decode_rint(&rh2, b, PERSIST_RINT_SIZE) == 1);
+
+    // one write cycle each, a journal record included
+    BOOST_TEST(PERSIST_RUNTIME_SIZE + JOURNAL_HEADER + 2 <= JOURNAL_HW_PAGE);
+    BOOST_TEST(PERSIST_CONF_SIZE <= JOURNAL_HW_PAGE);
+    BOOST_TEST(PERSIST_RINT_SIZE <= JOURNAL_HW_PAGE);
+}
+
+BOOST_AUTO_TEST_CASE(persist_legacy_test)
+{
+    // vehicle_conf as stored by the firmwares writing raw structs
+    const uint8_t conf[PERSIST_LEGACY_CONF_SIZE + 1] = {
+        17, 20, 0x22, 0x0b, 0x68, 0x10, 0x80, 0x0c, 1, 0xee,
+        16, 0, 0x26, 0x07, 90, 60, 85, 0xee, 0xff
+    };
+    struct vehicle_conf vc;
+    BOOST_TEST(persist_decode_conf(&vc, conf, sizeof(conf)) == 0);
+    BOOST_TEST(vc.batt_p == 17);
+    BOOST_TEST(vc.batt_s == 20);
+    BOOST_TEST(vc.cell_cap_mah == 2850);
+    BOOST_TEST(vc.cell_mv_max == 4200);
+    BOOST_TEST(vc.cell_mv_min == 3200);
+    BOOST_TEST(vc.reverse_curr == 1);
+    BOOST_TEST(vc.pulse_p_rev == 16);
+    BOOST_TEST(vc.dist_p_rev_mm == 1830);
+    BOOST_TEST(vc.moto_t_alarm_c == 90);
+    BOOST_TEST(vc.batt_t_alarm_c == 60);
+    BOOST_TEST(vc.drv_t_alarm_c == 85);
+
+    // vehicle_runtime before cycle_mah and avg_dWh_km, padding 0xee
+    uint8_t rt[PERSIST_LEGACY_RUNTIME_SIZE];
+    std::memset(rt, 0xee, sizeof(rt));
+    const uint8_t head[] = { 0x4e, 0xa2, 0xf4, 0x01, 0x07, 0x00, 3 };
+    std::memcpy(rt, head, sizeof(head));
+    for (int t = 0; t < 3; ++t) {
+        uint8_t* p = rt + 8 + 16 * t;
+        const uint8_t trip[] = {
+            (uint8_t)(0x10 + t), 0x27, 0, 0, 0x3c, 0, 0, 0, (uint8_t)(30 + t)
+        };
+        std::memcpy(p, trip, sizeof(trip));
+        const uint8_t mah[] = { 0xe8, 0x03, 0, (uint8_t)t };
+        std::memcpy(p + 12, mah, sizeof(mah));
+    }
+    struct vehicle_runtime vr;
+    BOOST_TEST(persist_decode_runtime(&vr, rt, sizeof(rt)) == 0);
+    BOOST_TEST(vr.last_batt_mv == 41550);
+    BOOST_TEST(vr.pow_consumed_mah == 500);
+    BOOST_TEST(vr.full_batt_charge_cycles == 7);
+    BOOST_TEST(vr.current_display_mode == 3);
+    BOOST_TEST(vr.total.dist_pulses == 0x2710u);
+    BOOST_TEST(vr.trip2.dist_pulses == 0x2712u);
+    BOOST_TEST(vr.trip1.travel_time_s == 60u);
+    BOOST_TEST(vr.trip1.max_speed_kmh == 31);
+    BOOST_TEST(vr.trip2.consumed_mah == 0x020003e8u);
+    BOOST_TEST(vr.cycle_mah == 0);
+    BOOST_TEST(vr.avg_dWh_km == 0);
+
+    // and of an unknown size
+    BOOST_TEST(persist_decode_runtime(&vr, rt, 40) == 1);
+}
\ No newline at end of file
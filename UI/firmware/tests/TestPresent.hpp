@@ -0,0 +1,80 @@
+#include "ui.h"
+#include "present.h"
+
+#include <cstdlib>
+
+// what the display shows, whole km/h
+static int DisplayedKmh(uint16_t dkmh)
+{
+    return (dkmh + 5) / 10;
+}
+
+// speed as it comes from the motherboard every 500 ms, with +-1 km/h noise
+static uint16_t NoisySpeed(int tick, uint16_t base)
+{
+    static const int8_t noise[] = { 0, 1, -1, 1, 0, -1, 1, -1, 0, 1 };
+    return base + 10 * noise[(tick / 5) % 10];
+}
+
+BOOST_AUTO_TEST_CASE(present_flicker_test)
+{
+    struct vehicle_gauges raw = {};
+    struct vehicle_gauges shown = {};
+    int raw_changes = 0;
+    int shown_changes = 0;
+
+    present_init();
+    raw.speed_dkmh = 250;
+    present_update(&raw, &shown);
+
+    // 60 s of UI ticks
+    for (int tick = 0; tick < 600; ++tick) {
+        int prev_raw = DisplayedKmh(raw.speed_dkmh);
+        int prev_shown = DisplayedKmh(shown.speed_dkmh);
+
+        raw.speed_dkmh = NoisySpeed(tick, 250);
+        present_update(&raw, &shown);
+
+        raw_changes += (DisplayedKmh(raw.speed_dkmh) != prev_raw);
+        shown_changes += (DisplayedKmh(shown.speed_dkmh) != prev_shown);
+        BOOST_TEST(std::abs(shown.speed_dkmh - 250) <= 10);
+    }
+
+    BOOST_TEST_MESSAGE("speed changes/min raw: " << raw_changes
+        << " shown: " << shown_changes);
+    BOOST_TEST(shown_changes * 4 < raw_changes);
+}
+
+BOOST_AUTO_TEST_CASE(present_latency_test)
+{
+    struct vehicle_gauges raw = {};
+    struct vehicle_gauges shown = {};
+
+    present_init();
+    raw.speed_dkmh = 200;
+    raw.batt_dv = 800;
+    present_update(&raw, &shown);
+
+    // a real step is shown on the next tick
+    raw.speed_dkmh = 300;
+    present_update(&raw, &shown);
+    BOOST_TEST(shown.speed_dkmh == 300);
+
+    // small steps settle without overshoot
+    raw.speed_dkmh = 320;
+    int ticks = 0;
+    while (DisplayedKmh(shown.speed_dkmh) != 32 && ticks < 50) {
+        present_update(&raw, &shown);
+        BOOST_TEST(shown.speed_dkmh <= 320);
+        ++ticks;
+    }
+    BOOST_TEST_MESSAGE("2 km/h step settled after " << ticks * UI_TICK_MS << " ms");
+    BOOST_TEST(ticks * UI_TICK_MS <= 1500);
+
+    // a slow ramp is followed within one digit
+    for (int tick = 0; tick < 100; ++tick) {
+        raw.batt_dv = 800 - tick / 10;
+        present_update(&raw, &shown);
+        BOOST_TEST(std::abs(shown.batt_dv - raw.batt_dv) <= 2);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,173 @@
+#include "profile.h"
+
+// road load of the test bike, W at v km/h
+static double RoadWatts(double kmh)
+{
+    double v = kmh / 3.6;
+    return 120 + 0.3 * v * v * v;
+}
+
+// the data frames of an EXPORT_PROFILE dump, -1 without the closing frame
+static int ParseProfileExport(const std::vector<uint8_t>& wire,
+    std::vector<std::vector<uint8_t>>& rows)
+{
+    size_t i = 0;
+
+    rows.clear();
+    while (i + EXPORT_HEADER + 2 <= wire.size()) {
+        uint8_t len = wire[i + 5];
+        size_t end = i + EXPORT_HEADER + len;
+        if (wire[i] != EXPORT_SYNC_1 || wire[i + 1] != EXPORT_SYNC_2
+            || wire[i + 2] != EXPORT_PROFILE || end + 2 > wire.size()
+            || (wire[end] | wire[end + 1] << 8)
+                != crc16(CRC16_INIT, &wire[i + 2], EXPORT_HEADER - 2 + len)) {
+            ++i;
+            continue;
+        }
+        if (len == 0) {
+            return rows.size();
+        }
+        rows.emplace_back(&wire[i + EXPORT_HEADER], &wire[end]);
+        i = end + 2;
+    }
+    return -1;
+}
+
+BOOST_AUTO_TEST_CASE(profile_histogram_test)
+{
+    static struct profile p;
+    const double speeds[] = { 17, 27, 37 };
+    uint64_t ridden_ms = 0;
+
+    profile_init(&p);
+    // 20 minutes at each speed, 100 ms frames, 84 V
+    for (double kmh : speeds) {
+        double w = RoadWatts(kmh);
+        for (int ms = 0; ms < 20 * 60000; ms += 100) {
+            profile_sample(&p, kmh * 10, w / 8.4, 45, 25, w * 100, 100);
+            ridden_ms += 100;
+        }
+    }
+    // parked, and a gap in the frames
+    for (int i = 0; i < 1000; ++i) {
+        profile_sample(&p, 0, 3, 45, 25, 25, 100);
+    }
+    profile_sample(&p, 250, 100, 45, 25, 8400, 5000);
+    BOOST_TEST(p.dirty == 1);
+
+    uint64_t speed_ms = 0, current_ms = 0, temp_ms = 0;
+    for (int i = 0; i < PROFILE_SPEEDS; ++i) {
+        speed_ms += p.speed_ms[i];
+    }
+    for (int i = 0; i < PROFILE_CURRENTS; ++i) {
+        current_ms += p.current_ms[i];
+    }
+    for (int m = 0; m < PROFILE_MOTO_BANDS; ++m) {
+        for (int b = 0; b < PROFILE_BATT_BANDS; ++b) {
+            temp_ms += p.temp_ms[m][b];
+        }
+    }
+    BOOST_TEST(speed_ms == ridden_ms);
+    BOOST_TEST(current_ms == ridden_ms);
+    BOOST_TEST(temp_ms == ridden_ms);
+    BOOST_TEST(p.temp_ms[2][2] == ridden_ms);
+
+    for (double kmh : speeds) {
+        uint8_t bin = kmh * 10 / PROFILE_SPEED_DKMH;
+        double wh_km = RoadWatts(kmh) / kmh;
+        BOOST_TEST_MESSAGE(kmh << " km/h: " << profile_dWh_km(&p, bin) / 10.0
+            << " Wh/km, the road takes " << wh_km);
+        BOOST_TEST(std::abs(profile_dWh_km(&p, bin) - wh_km * 10) <= 1);
+    }
+    // 1.8 and 2.9 A share the 0 - 5 A bin, 5.3 A is in the next one
+    BOOST_TEST(p.current_ms[4] == 2 * 20 * 60000);
+    BOOST_TEST(p.current_ms[5] == 20 * 60000);
+
+    // across a reboot
+    static struct profile back;
+    eeprom_async_init();
+    BOOST_TEST(save_profile_async(&p, NULL, NULL) == 0);
+    EeDrain();
+    BOOST_TEST(load_profile(&back) == 0);
+    BOOST_TEST(std::memcmp(back.speed_mWs, p.speed_mWs,
+        offsetof(struct profile, dirty)) == 0);
+
+    // and on the PC, a frame per row
+    fake_wire.clear();
+    BOOST_TEST(profile_export_start() == 0);
+    BOOST_TEST(profile_export_start() == 1);
+    std::vector<std::vector<uint8_t>> rows;
+    uint32_t start = HAL_Tick;
+    while (ParseProfileExport(fake_wire, rows) < 0 && HAL_Tick - start < 5000) {
+        HAL_Tick += 1;
+        profile_export_poll(&p);
+    }
+    BOOST_TEST_MESSAGE("profile export: " << fake_wire.size() << " B in "
+        << HAL_Tick - start << " ms at 9600 baud");
+    BOOST_TEST(rows.size() == 20);
+    const std::vector<uint8_t>& r = rows[5];
+    BOOST_TEST(r.size() == 2 + 24);
+    BOOST_TEST(r[0] == 0);
+    BOOST_TEST(r[1] == 5);
+    uint64_t mm = 0;
+    for (int i = 0; i < 8; ++i) {
+        mm |= (uint64_t)r[2 + 8 + i] << (8 * i);
+    }
+    BOOST_TEST(mm == p.speed_mm[5]);
+    BOOST_TEST(rows[12][0] == 1);
+    BOOST_TEST(rows[19][0] == 2);
+    BOOST_TEST(rows[19][1] == PROFILE_MOTO_BANDS - 1);
+    BOOST_TEST(profile_export_start() == 0);
+    for (int i = 0; i < 5000; ++i) {
+        HAL_Tick += 1;
+        profile_export_poll(&p);
+    }
+}
+
+// the copies take turns, a torn one leaves the previous save
+BOOST_AUTO_TEST_CASE(profile_copies_test)
+{
+    static struct profile p, back;
+    static uint8_t image[PROFILE_SIZE];
+    const uint16_t copy_1 = 0x0400 * 11;
+    const uint16_t copy_2 = 0x0400 * 10 + 128;
+
+    // nothing saved yet, a bare image is no copy either
+    std::vector<uint8_t> erased(0x0400 - 128, 0xff);
+    eeprom_24lc256_write(copy_2, erased.data(), erased.size());
+    eeprom_24lc256_write(copy_1, erased.data(), erased.size());
+    BOOST_TEST(load_profile(&back) == 1);
+    profile_init(&p);
+    p.speed_ms[0] = 1;
+    profile_encode(&p, image);
+    eeprom_24lc256_write(copy_1, image, sizeof(image));
+    BOOST_TEST(load_profile(&back) == 1);
+
+    // each save is the newest of the two
+    eeprom_async_init();
+    for (uint64_t ms = 2; ms <= 4; ++ms) {
+        p.speed_ms[0] = ms;
+        BOOST_TEST(save_profile_async(&p, NULL, NULL) == 0);
+        EeDrain();
+        BOOST_TEST(load_profile(&back) == 0);
+        BOOST_TEST(back.speed_ms[0] == ms);
+    }
+
+    // the power went in the middle of the last copy
+    uint8_t b = 0;
+    eeprom_24lc256_read(copy_2 + 300, &b, 1);
+    b ^= 0x5a;
+    eeprom_24lc256_write(copy_2 + 300, &b, 1);
+    BOOST_TEST(load_profile(&back) == 0);
+    BOOST_TEST(back.speed_ms[0] == 3u);
+
+    // and the next save goes to the torn copy again
+    p.speed_ms[0] = 5;
+    BOOST_TEST(save_profile_async(&p, NULL, NULL) == 0);
+    EeDrain();
+    eeprom_24lc256_read(copy_1 + 300, &b, 1);
+    b ^= 0x5a;
+    eeprom_24lc256_write(copy_1 + 300, &b, 1);
+    BOOST_TEST(load_profile(&back) == 0);
+    BOOST_TEST(back.speed_ms[0] == 5u);
+}
\ No newline at end of file
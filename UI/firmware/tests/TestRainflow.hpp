@@ -0,0 +1,151 @@
+#include "rainflow.h"
+#include "persist.h"
+
+#include <vector>
+
+typedef std::vector<std::vector<int>> Histogram;
+
+// charge in permille at 1 Hz: rides with regeneration bumps and noise,
+// then a partial or a full charge, `days` times
+static std::vector<uint16_t> ChargeProfile(int days)
+{
+    std::vector<uint16_t> p;
+    int soc = 1000;
+
+    for (int day = 0; day < days; ++day) {
+        int rides = 1 + std::rand() % 3;
+        for (int r = 0; r < rides; ++r) {
+            int target = soc - 50 - std::rand() % 300;
+            target = (target < 50) ? 50 : target;
+            while (soc > target) {
+                soc -= std::rand() % 3;
+                if (std::rand() % 200 == 0) {
+                    // a descent
+                    soc += 5 + std::rand() % 20;
+                }
+                p.push_back(soc + std::rand() % 5);
+            }
+            // parked
+            for (int i = 0; i < 600; ++i) {
+                p.push_back(soc + std::rand() % 5);
+            }
+        }
+        int full = (std::rand() % 4) ? 1000 : soc + (1000 - soc) / 2;
+        while (soc < full) {
+            soc = (soc + 2 > full) ? full : soc + 2;
+            p.push_back(soc);
+        }
+    }
+    return p;
+}
+
+static void RefCount(Histogram& h, int a, int b, int halves)
+{
+    h[rainflow_depth_bin(std::abs(a - b))][rainflow_mean_bin((a + b) / 2)]
+        += halves;
+}
+
+// the reversals of the whole history at once: a point is one when the
+// signal moves RAINFLOW_GATE away from it before passing it
+static std::vector<int> RefReversals(const std::vector<uint16_t>& p)
+{
+    std::vector<int> r;
+    size_t i = 0;
+    int dir = 0;
+
+    r.push_back(p[0]);
+    for (++i; i < p.size() && dir == 0; ++i) {
+        if (std::abs(p[i] - r[0]) >= RAINFLOW_GATE) {
+            dir = (p[i] > r[0]) ? 1 : -1;
+            r.push_back(p[i]);
+        }
+    }
+    for (; i < p.size(); ++i) {
+        int x = p[i];
+        if ((x - r.back()) * dir > 0) {
+            r.back() = x;
+        } else if (std::abs(x - r.back()) >= RAINFLOW_GATE) {
+            dir = -dir;
+            r.push_back(x);
+        }
+    }
+    return r;
+}
+
+// ASTM E1049 three point counting, the start and the leftovers as halves
+static Histogram RefRainflow(const std::vector<int>& reversals)
+{
+    Histogram h(RAINFLOW_DEPTHS, std::vector<int>(RAINFLOW_MEANS, 0));
+    std::vector<int> s;
+
+    for (int x : reversals) {
+        s.push_back(x);
+        while (s.size() >= 3) {
+            size_t n = s.size();
+            int x_range = std::abs(s[n - 1] - s[n - 2]);
+            int y_range = std::abs(s[n - 2] - s[n - 3]);
+            if (x_range < y_range) {
+                break;
+            }
+            if (n == 3) {
+                RefCount(h, s[0], s[1], 1);
+                s.erase(s.begin());
+            } else {
+                RefCount(h, s[n - 3], s[n - 2], 2);
+                s.erase(s.begin() + n - 3, s.begin() + n - 1);
+            }
+        }
+    }
+    for (size_t i = 1; i < s.size(); ++i) {
+        RefCount(h, s[i - 1], s[i], 1);
+    }
+    return h;
+}
+
+BOOST_AUTO_TEST_CASE(rainflow_reference_test)
+{
+    struct rainflow rf;
+    uint8_t cycles[PERSIST_CYCLES_SIZE];
+    uint8_t reversals[PERSIST_REVERSALS_SIZE];
+    int max_stack = 0;
+
+    std::srand(48);
+    std::vector<uint16_t> p = ChargeProfile(365);
+
+    std::memset(&rf, 0, sizeof(rf));
+    for (size_t i = 0; i < p.size(); ++i) {
+        rainflow_sample(&rf, p[i]);
+        max_stack = std::max<int>(max_stack, rf.count);
+        if (i % 50000 == 0) {
+            // a power cycle now and then
+            persist_encode_cycles(&rf, cycles);
+            persist_encode_reversals(&rf, reversals);
+            std::memset(&rf, 0xaa, sizeof(rf));
+            BOOST_TEST(persist_decode_cycles(&rf, cycles, sizeof(cycles)) == 0);
+            BOOST_TEST(persist_decode_reversals(&rf, reversals,
+                sizeof(reversals)) == 0);
+        }
+    }
+    // the overflow rule would break the equivalence
+    BOOST_TEST(max_stack < RAINFLOW_STACK);
+
+    // closed cycles and the residue as halves against the reference
+    Histogram h(RAINFLOW_DEPTHS, std::vector<int>(RAINFLOW_MEANS, 0));
+    int closed = 0;
+    for (int d = 0; d < RAINFLOW_DEPTHS; ++d) {
+        for (int m = 0; m < RAINFLOW_MEANS; ++m) {
+            h[d][m] = rf.half[d][m];
+            closed += rf.half[d][m] / 2;
+        }
+    }
+    for (int i = 1; i < rf.count; ++i) {
+        RefCount(h, rf.stack[i - 1], rf.stack[i], 1);
+    }
+    std::vector<int> r = RefReversals(p);
+    BOOST_TEST(h == RefRainflow(r));
+
+    BOOST_TEST_MESSAGE(p.size() << " samples, " << r.size() << " reversals, "
+        << closed << " cycles closed, " << rainflow_cycles(&rf, 600)
+        << " of them 60 % deep or more; stack up to " << max_stack);
+    BOOST_TEST(rainflow_cycles(&rf, 0) == closed);
+}
\ No newline at end of file
@@ -0,0 +1,118 @@
+#include "range.h"
+#include "soc.h"
+#include "energy.h"
+#include "rolling.h"
+
+#include <cmath>
+#include <vector>
+
+// rested cell voltage for a charge level, inverse of soc_ocv_permille()
+static uint16_t RangeCellMv(const struct soc* s, uint16_t permille)
+{
+    uint16_t lo = s->cell_mv_min, hi = s->cell_mv_max;
+    while (lo < hi) {
+        uint16_t mid = (lo + hi) / 2;
+        if (soc_ocv_permille(s, mid) < permille) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// full pack ridden at 25 km/h until empty, the consumption swinging
+// +-40 % around `base` Wh/km every 6 km; returns mean and max error
+// of the prediction against the actual remaining distance, in %
+static void RangeReplay(double base, double& mean_err, double& max_err)
+{
+    struct vehicle_conf vc;
+    struct vehicle_runtime vr;
+    struct soc s;
+    struct energy e;
+    struct rolling roll;
+    struct range r;
+
+    init_vehicle_conf(&vc);
+    init_vehicle_runtime(&vr);
+    soc_init(&s, &vc);
+    soc_restore(&s, &vr);
+    energy_init(&e);
+    rolling_init(&roll);
+    range_init(&r);
+
+    const double mm_s = 25 / 3.6 * 1000;
+    double mm = 0;
+    uint32_t ms = 0;
+    std::vector<std::pair<double, uint32_t>> predictions;
+
+    soc_sample(&s, 20 * RangeCellMv(&s, 1000) / 100, 0, 0);
+
+    while (soc_permille(&s) > 0) {
+        ms += 500;
+        mm += mm_s / 2;
+
+        double wh_km = base * (1 + 0.4 * std::sin(2 * M_PI * mm / 6e6));
+        double watts = wh_km * 25;
+        double volts = 20 * RangeCellMv(&s, soc_permille(&s)) / 1000.0 - 0.1 * watts / 75;
+        uint16_t dv = (uint16_t)std::lround(volts * 10);
+        int16_t da = (int16_t)std::lround(watts / volts * 10);
+
+        soc_sample(&s, dv, da, 500);
+        energy_sample(&e, dv, da, 500);
+
+        int64_t net = energy_consumed_mWs(&e) - energy_recovered_mWs(&e);
+        if (ms % 1000 == 0) {
+            rolling_update(&roll, (uint64_t)mm, net, ms);
+        }
+        uint32_t ride_m = (uint32_t)(mm / 1000);
+        uint16_t ride = (ride_m >= 1000) ? energy_dWh_km(net, ride_m) : 0;
+
+        range_update(&r, soc_remaining_mWh(&s),
+            range_blend(rolling_dWh_km(&roll, ROLL_5KM), ride, 0), ms);
+
+        if (ms % 60000 == 0) {
+            predictions.push_back(std::make_pair(mm, range_m(&r)));
+        }
+    }
+
+    double total = mm;
+    double sum = 0;
+    int n = 0;
+    max_err = 0;
+    for (auto& p : predictions) {
+        if (p.first < total * 0.1 || p.first > total * 0.9) {
+            continue;
+        }
+        double actual_m = (total - p.first) / 1000;
+        double err = std::fabs(p.second - actual_m) / actual_m * 100;
+        sum += err;
+        max_err = std::max(max_err, err);
+        ++n;
+    }
+    mean_err = sum / n;
+
+    BOOST_TEST_MESSAGE(base << " Wh/km ride of " << total / 1e6
+        << " km, range error mean " << mean_err << " % max " << max_err << " %");
+}
+
+BOOST_AUTO_TEST_CASE(range_replay_test)
+{
+    double mean_err, max_err;
+
+    RangeReplay(14, mean_err, max_err);
+    BOOST_TEST(mean_err < 5);
+    BOOST_TEST(max_err < 15);
+
+    RangeReplay(25, mean_err, max_err);
+    BOOST_TEST(mean_err < 5);
+    BOOST_TEST(max_err < 15);
+}
+
+BOOST_AUTO_TEST_CASE(range_blend_test)
+{
+    BOOST_TEST(range_blend(0, 0, 0) == RANGE_DEFAULT_DWH_KM);
+    BOOST_TEST(range_blend(300, 0, 0) == 300);
+    BOOST_TEST(range_blend(300, 150, 150) == 225);
+    BOOST_TEST(range_blend(0, 150, 250) == 200);
+}
\ No newline at end of file
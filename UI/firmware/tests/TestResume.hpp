@@ -0,0 +1,117 @@
+#include "resume.h"
+#include "logic.h"
+
+// the backup domain, survives logic_init() like a warm reset does
+static uint16_t fake_bkp[RESUME_REGS];
+
+void bkp_init(void)
+{
+}
+
+uint16_t bkp_read(uint8_t reg)
+{
+    return fake_bkp[reg];
+}
+
+void bkp_write(uint8_t reg, uint16_t v)
+{
+    fake_bkp[reg] = v;
+}
+
+// VDD and VBAT gone, the backup domain is reset
+static void FakePowerOn()
+{
+    std::memset(fake_bkp, 0, sizeof(fake_bkp));
+}
+
+BOOST_AUTO_TEST_CASE(resume_snapshot_test)
+{
+    struct resume in = {}, out = {};
+
+    FakePowerOn();
+    BOOST_TEST(resume_load(&out) == 1);
+
+    in.display_mode = DM_TRIP2;
+    in.batt_perc = 73;
+    in.ambient_temp = -12;
+    in.batt_dv = 792;
+    in.total_m = 12345678;
+    in.trip1_m = 4321;
+    in.trip2_m = 98765;
+    resume_store(&in);
+    BOOST_TEST(resume_load(&out) == 0);
+    BOOST_TEST(out.display_mode == DM_TRIP2);
+    BOOST_TEST(out.batt_perc == 73);
+    BOOST_TEST(out.ambient_temp == -12);
+    BOOST_TEST(out.batt_dv == 792);
+    BOOST_TEST(out.total_m == 12345678u);
+    BOOST_TEST(out.trip1_m == 4321u);
+    BOOST_TEST(out.trip2_m == 98765u);
+
+    // any register off is a cold boot
+    for (int i = 0; i < RESUME_REGS; ++i) {
+        fake_bkp[i] ^= 0x0100;
+        BOOST_TEST(resume_load(&out) == 1);
+        fake_bkp[i] ^= 0x0100;
+    }
+    BOOST_TEST(resume_load(&out) == 0);
+}
+
+// runs the main loop until the first gauge frame, ms since t0
+static uint32_t BootToFirstGauge(uint32_t t0)
+{
+    for (int i = 0; i < 100 && logic_first_gauge_ms() == UINT32_MAX; ++i) {
+        HAL_Tick += 10;
+        logic_update();
+    }
+    BOOST_TEST(logic_first_gauge_ms() != UINT32_MAX);
+    return logic_first_gauge_ms() - t0;
+}
+
+BOOST_AUTO_TEST_CASE(resume_boot_test)
+{
+    // power-on: the welcome screens, the fake's HAL_Delay() returns at
+    // once so they are added on top
+    FakePowerOn();
+    uint32_t t0 = HAL_Tick;
+    logic_init();
+    BOOST_TEST(logic_first_gauge_ms() == UINT32_MAX);
+    uint32_t cold_ms = BootToFirstGauge(t0) + UI_WELCOME_MS;
+
+    // ride a bit
+    for (int i = 0; i < 20; ++i) {
+        HAL_Tick += 100;
+        InsertCanMessage(BuildElectricMsg(812, 50));
+        InsertCanMessage(BuildMotionMsg(2000 * i));
+        logic_update();
+    }
+    // parked, the speed is 0 again
+    for (int i = 0; i < 30; ++i) {
+        HAL_Tick += 100;
+        InsertCanMessage(BuildMotionMsg(2000 * 19));
+        logic_update();
+    }
+    // the screen of the mode the logic keeps, the tests set others
+    struct resume rs;
+    BOOST_TEST(resume_load(&rs) == 0);
+    ui_set_display_mode((enum display_mode)rs.display_mode);
+    HAL_Tick += 100;
+    logic_update();
+    std::string line1 = hd44780_get_line1();
+    std::string line2 = hd44780_get_line2();
+
+    // a reset: the gauges are drawn by logic_init(), before the EEPROM
+    t0 = HAL_Tick;
+    logic_init();
+    BOOST_TEST(logic_first_gauge_ms() == t0);
+    uint32_t warm_ms = BootToFirstGauge(t0);
+    BOOST_TEST(line1 == hd44780_get_line1());
+    BOOST_TEST(line2 == hd44780_get_line2());
+
+    BOOST_TEST_MESSAGE("boot to first gauge, cold: " << cold_ms
+        << " ms warm: " << warm_ms << " ms");
+    BOOST_TEST(warm_ms + UI_WELCOME_MS <= cold_ms);
+
+    ui_set_display_mode(DM_DEFAULT);
+    FakePowerOn();
+}
\ No newline at end of file
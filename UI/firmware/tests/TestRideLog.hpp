@@ -0,0 +1,178 @@
+#include "ridelog.h"
+#include "export.h"
+#include "logic.h"
+#include "RideLogDecoder.hpp"
+
+// the USART1 at 9600 baud: a frame keeps the port busy for its bytes
+static std::vector<uint8_t> fake_wire;
+static std::vector<uint8_t> fake_rx;
+static uint32_t fake_tx_end_ms;
+
+extern "C" HAL_StatusTypeDef export_port_send(const uint8_t* d, uint16_t s)
+{
+    if (export_port_busy()) {
+        return HAL_BUSY;
+    }
+    fake_wire.insert(fake_wire.end(), d, d + s);
+    // 10 bits a byte
+    fake_tx_end_ms = HAL_GetTick() + (s * 10 * 1000 + 9599) / 9600;
+    return HAL_OK;
+}
+
+extern "C" uint8_t export_port_busy(void)
+{
+    return HAL_GetTick() - fake_tx_end_ms >= 0x80000000u;
+}
+
+extern "C" uint8_t export_port_getc(uint8_t* c)
+{
+    if (fake_rx.empty()) {
+        return 0;
+    }
+    *c = fake_rx.front();
+    fake_rx.erase(fake_rx.begin());
+    return 1;
+}
+
+// a 10 minute loop: 30 s up to 45 km/h, cruise, 20 s braking, 60 s stop
+static struct ridelog_sample RideSecond(int t, double& wh)
+{
+    struct ridelog_sample s = {};
+    int c = t % 600;
+    int kmh = (c < 30) ? c * 3 / 2 : (c < 520) ? 45 + std::rand() % 3 - 1
+        : (c < 540) ? (540 - c) * 45 / 20 : 0;
+    int amp = (c < 30) ? 25 + std::rand() % 5 : (c < 520) ? 9 + std::rand() % 5
+        : (c < 540) ? -(std::rand() % 6) : 0;
+
+    s.speed_kmh = kmh;
+    s.amper_a = amp;
+    s.batt_dv = 820 - t / 90 - amp / 3;
+    s.moto_temp = 25 + std::min(t / 120, 40);
+    s.driver_temp = 25 + std::min(t / 200, 25);
+    s.batt_temp = 22 + std::min(t / 600, 10);
+    s.ambient_temp = 18;
+    wh += s.batt_dv / 10.0 * amp / 3600;
+    s.consumed_wh = (wh > 0) ? (uint32_t)wh : 0;
+    return s;
+}
+
+static bool SameSample(const struct ridelog_sample& a,
+    const struct ridelog_sample& b)
+{
+    return a.speed_kmh == b.speed_kmh && a.amper_a == b.amper_a
+        && a.batt_dv == b.batt_dv && a.moto_temp == b.moto_temp
+        && a.driver_temp == b.driver_temp && a.batt_temp == b.batt_temp
+        && a.ambient_temp == b.ambient_temp
+        && a.consumed_wh == b.consumed_wh;
+}
+
+// runs the export to the end, returns its duration in ms
+static uint32_t RideLogExport(struct ridelog* rl)
+{
+    uint32_t start = HAL_Tick;
+
+    fake_wire.clear();
+    BOOST_TEST(ridelog_export_start(rl) == 0);
+    for (int i = 0; rl->exporting && i < 1000000; ++i) {
+        HAL_Tick += 1;
+        eeprom_async_poll();
+        ridelog_poll(rl);
+    }
+    BOOST_TEST(!rl->exporting);
+    return HAL_Tick - start;
+}
+
+static struct ridelog test_rl;
+
+BOOST_AUTO_TEST_CASE(ridelog_ride_test)
+{
+    std::vector<struct ridelog_sample> ride;
+    double wh = 0;
+
+    std::srand(43);
+    eeprom_async_init();
+    open_ride_log(&test_rl);
+    // a virgin area
+    std::vector<uint8_t> erased(test_rl.pages * RIDELOG_BLOCK, 0xff);
+    eeprom_24lc256_write(test_rl.base, erased.data(), erased.size());
+    BOOST_TEST(open_ride_log(&test_rl) == 1);
+
+    // 3 hours, more than the ring holds
+    for (int t = 0; t < 3 * 3600; ++t) {
+        ride.push_back(RideSecond(t, wh));
+        ridelog_sample(&test_rl, &ride.back());
+        HAL_Tick += 1000;
+        EeDrain();
+    }
+    uint32_t export_ms = RideLogExport(&test_rl);
+    EeDrain();
+
+    std::vector<uint8_t> image;
+    BOOST_TEST(ParseRideLogExport(fake_wire, image) == test_rl.pages);
+    std::vector<LogRide> rides = DecodeRideLog(image);
+    BOOST_TEST(rides.size() == 1u);
+
+    // the newest seconds, up to the last one, as they were logged
+    const LogRide& r = rides.back();
+    BOOST_TEST(r.back().t == ride.size() - 1);
+    bool same = true;
+    for (const LogPoint& p : r) {
+        same &= SameSample(p.s, ride[p.t]);
+    }
+    BOOST_TEST(same);
+
+    double riding_h = r.size() / 3600.0;
+    BOOST_TEST_MESSAGE("ride log: " << test_rl.pages << " blocks hold "
+        << riding_h << " h of riding, "
+        << test_rl.pages * RIDELOG_BLOCK / (double)r.size()
+        << " B/s vs 13 B/s packed; parked "
+        << test_rl.pages * RIDELOG_MAX_SAMPLES / 3600.0 << " h; export "
+        << fake_wire.size() << " B in " << export_ms / 1000.0 << " s");
+    BOOST_TEST(riding_h > 1.0);
+    BOOST_TEST(test_rl.blocks_dropped == 0u);
+
+    // a reboot continues the ring, the export shows two rides
+    uint32_t next_seq = test_rl.next_seq;
+    BOOST_TEST(open_ride_log(&test_rl) == 0);
+    BOOST_TEST(test_rl.next_seq == next_seq);
+    for (int t = 0; t < 100; ++t) {
+        ridelog_sample(&test_rl, &ride[t]);
+        HAL_Tick += 1000;
+        EeDrain();
+    }
+    ridelog_flush(&test_rl);
+    EeDrain();
+    RideLogExport(&test_rl);
+    // a frame damaged on the wire loses its block only
+    fake_wire[EXPORT_MAX_FRAME * 5 + 20] ^= 0x10;
+    BOOST_TEST(ParseRideLogExport(fake_wire, image) == test_rl.pages - 1);
+    rides = DecodeRideLog(image);
+    BOOST_TEST(rides.size() == 2u);
+    BOOST_TEST(rides.back().size() == 100u);
+    BOOST_TEST(rides.back().front().t == 0u);
+    BOOST_TEST(SameSample(rides.back().back().s, ride[99]));
+}
+
+BOOST_AUTO_TEST_CASE(ridelog_command_test)
+{
+    // the logic logs once a second and exports on an 'L' byte
+    logic_init();
+    for (int i = 0; i < 20; ++i) {
+        HAL_Tick += 100;
+        InsertCanMessage(BuildElectricMsg(800, 20));
+        logic_update();
+    }
+    fake_wire.clear();
+    fake_rx.push_back(EXPORT_RIDE_LOG);
+    for (int i = 0; i < 100000; ++i) {
+        HAL_Tick += 1;
+        logic_update();
+    }
+
+    std::vector<uint8_t> image;
+    BOOST_TEST(ParseRideLogExport(fake_wire, image) > 0);
+    std::vector<LogRide> rides = DecodeRideLog(image);
+    BOOST_TEST(!rides.empty());
+    BOOST_TEST(rides.back().back().s.batt_dv == 800);
+    BOOST_TEST(rides.back().back().s.amper_a == 2);
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+#include "rint.h"
+
+#include <cstdlib>
+
+// pack with a slowly falling OCV, current stepping between 0 and 40 A
+static void RintRide(struct rint* r, int samples, double mohm, uint32_t& seed)
+{
+    for (int k = 0; k < samples; ++k) {
+        seed = seed * 1103515245 + 12345;
+        int16_t da = (int16_t)((seed >> 16) % 400);
+        double ocv = 800 - k * 0.001;
+        uint16_t dv = (uint16_t)std::lround(ocv - mohm * da / 1000);
+        rint_sample(r, dv, da);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(rint_known_pack_test)
+{
+    struct rint r;
+    uint32_t seed = 7;
+    rint_init(&r);
+
+    // steady current tells nothing
+    for (int k = 0; k < 100; ++k) {
+        rint_sample(&r, 780, 100);
+    }
+    BOOST_TEST(!rint_valid(&r));
+
+    RintRide(&r, 2000, 85, seed);
+    BOOST_TEST_MESSAGE("85 mOhm pack estimated: " << rint_mohm(&r) << " mOhm");
+    BOOST_TEST(rint_valid(&r));
+    BOOST_TEST(std::abs(rint_mohm(&r) - 85) <= 3);
+
+    // 30 A sag of 2.55 V compensated
+    BOOST_TEST(std::abs(rint_compensate_dv(&r, 775, 300) - 800) <= 2);
+
+    // an aged pack, the forgetting window follows
+    RintRide(&r, 3000, 140, seed);
+    BOOST_TEST_MESSAGE("140 mOhm pack estimated: " << rint_mohm(&r) << " mOhm");
+    BOOST_TEST(std::abs(rint_mohm(&r) - 140) <= 4);
+}
+
+BOOST_AUTO_TEST_CASE(rint_history_test)
+{
+    struct rint_history h;
+    init_rint_history(&h);
+
+    rint_history_put(&h, 80, 1);
+    rint_history_put(&h, 82, 0);
+    BOOST_TEST(h.count == 1);
+    BOOST_TEST(h.mohm[0] == 82);
+
+    for (int ride = 0; ride < RINT_HISTORY + 3; ++ride) {
+        rint_history_put(&h, 100 + ride, 1);
+    }
+    BOOST_TEST(h.count == RINT_HISTORY);
+    BOOST_TEST(h.mohm[0] == 103);
+    BOOST_TEST(h.mohm[RINT_HISTORY - 1] == 100 + RINT_HISTORY + 2);
+}
\ No newline at end of file
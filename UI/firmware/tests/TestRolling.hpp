@@ -0,0 +1,92 @@
+#include "rolling.h"
+
+#include <cstdlib>
+
+BOOST_AUTO_TEST_CASE(rolling_windows_test)
+{
+    struct rolling r;
+    rolling_init(&r);
+
+    // 20 km/h, updated once a second
+    const uint32_t mm_s = 5556;
+    uint64_t mm = 0;
+    int64_t mWs = 0;
+    uint32_t ms = 0;
+
+    rolling_update(&r, mm, mWs, ms);
+    BOOST_TEST(rolling_dWh_km(&r, ROLL_1KM) == 0);
+
+    // 6 km at 10 Wh/km (200 W)
+    while (mm < 6000000) {
+        mm += mm_s;
+        mWs += 200000;
+        ms += 1000;
+        rolling_update(&r, mm, mWs, ms);
+    }
+    BOOST_TEST(std::abs(rolling_dWh_km(&r, ROLL_1KM) - 100) <= 1);
+    BOOST_TEST(std::abs(rolling_dWh_km(&r, ROLL_5KM) - 100) <= 1);
+    BOOST_TEST(std::abs(rolling_dWh_km(&r, ROLL_10MIN) - 100) <= 1);
+    BOOST_TEST(std::abs(rolling_avg_dkmh(&r) - 200) <= 1);
+
+    // 1 km at 30 Wh/km (600 W), the 1 km window follows right away
+    uint64_t start = mm;
+    while (mm < start + 1000000) {
+        mm += mm_s;
+        mWs += 600000;
+        ms += 1000;
+        rolling_update(&r, mm, mWs, ms);
+    }
+    BOOST_TEST_MESSAGE("1k: " << rolling_dWh_km(&r, ROLL_1KM)
+        << " 5k: " << rolling_dWh_km(&r, ROLL_5KM)
+        << " 10min: " << rolling_dWh_km(&r, ROLL_10MIN));
+    BOOST_TEST(std::abs(rolling_dWh_km(&r, ROLL_1KM) - 300) <= 5);
+    // (4 * 10 + 30) / 5
+    BOOST_TEST(std::abs(rolling_dWh_km(&r, ROLL_5KM) - 140) <= 5);
+    // 180 s at 600 W + 420 s at 200 W over 10 minutes at 20 km/h
+    BOOST_TEST(std::abs(rolling_dWh_km(&r, ROLL_10MIN) - 160) <= 5);
+
+    // standing still for 10 minutes, the distance windows keep their values
+    for (int i = 0; i < 600; ++i) {
+        ms += 1000;
+        rolling_update(&r, mm, mWs, ms);
+    }
+    BOOST_TEST(std::abs(rolling_dWh_km(&r, ROLL_1KM) - 300) <= 5);
+    BOOST_TEST(rolling_dWh_km(&r, ROLL_10MIN) == 0);
+    BOOST_TEST(rolling_avg_dkmh(&r) == 0);
+}
+
+BOOST_AUTO_TEST_CASE(rolling_jump_test)
+{
+    struct rolling r;
+    rolling_init(&r);
+
+    uint64_t mm = 0;
+    int64_t mWs = 0;
+    uint32_t ms = 0;
+
+    // 2 km at 10 Wh/km
+    rolling_update(&r, mm, mWs, ms);
+    for (int i = 0; i < 360; ++i) {
+        mm += 5555;
+        mWs += 200000;
+        ms += 1000;
+        rolling_update(&r, mm, mWs, ms);
+    }
+    BOOST_TEST(std::abs(rolling_dWh_km(&r, ROLL_5KM) - 100) <= 1);
+
+    // a bogus total far beyond the window empties it in one step
+    mm += 1ULL << 50;
+    ms += 1000;
+    rolling_update(&r, mm, mWs, ms);
+    BOOST_TEST(r.dist_count == 0);
+    BOOST_TEST(rolling_dWh_km(&r, ROLL_5KM) == 0);
+
+    // and the next kilometer is measured from there
+    for (int i = 0; i < 180; ++i) {
+        mm += 5555;
+        mWs += 600000;
+        ms += 1000;
+        rolling_update(&r, mm, mWs, ms);
+    }
+    BOOST_TEST(std::abs(rolling_dWh_km(&r, ROLL_1KM) - 300) <= 5);
+}
\ No newline at end of file
@@ -0,0 +1,102 @@
+#include "soc.h"
+
+BOOST_AUTO_TEST_CASE(soc_coulomb_counting_test)
+{
+    struct vehicle_conf vc;
+    struct vehicle_runtime vr;
+    struct soc s;
+    init_vehicle_conf(&vc);
+    init_vehicle_runtime(&vr);
+    soc_init(&s, &vc);
+    soc_restore(&s, &vr);
+
+    // 20s pack resting at 3.77 V/cell => 50 %
+    soc_sample(&s, 754, 0, 0);
+    BOOST_TEST(soc_percent(&s) == 50);
+
+    // 20 A for 30 min with the voltage sagging to 3.2 V/cell:
+    // 10 Ah of the 17 * 2.85 Ah pack
+    for (int i = 0; i < 36000; ++i) {
+        soc_sample(&s, 640, 200, 50);
+    }
+    BOOST_TEST(soc_permille(&s) == 500 - 10000 * 1000 / (17 * 2850));
+
+    // the state survives a power cycle
+    soc_store(&s, &vr);
+    BOOST_TEST(vr.pow_consumed_mah == 17 * 2850 / 2 + 10000);
+    soc_init(&s, &vc);
+    soc_restore(&s, &vr);
+    BOOST_TEST(soc_permille(&s) == 500 - 10000 * 1000 / (17 * 2850));
+
+    // a loaded first sample does not anchor
+    soc_sample(&s, 700, 100, 0);
+    BOOST_TEST(soc_permille(&s) == 500 - 10000 * 1000 / (17 * 2850));
+
+    // 10 minutes of rest at 3.67 V/cell re-anchor to 30 %
+    for (int i = 0; i < 12000; ++i) {
+        soc_sample(&s, 734, 0, 50);
+    }
+    BOOST_TEST(soc_percent(&s) == 30);
+}
+
+BOOST_AUTO_TEST_CASE(soc_cycles_test)
+{
+    struct vehicle_conf vc;
+    struct vehicle_runtime vr;
+    struct soc s;
+    init_vehicle_conf(&vc);
+    init_vehicle_runtime(&vr);
+    soc_init(&s, &vc);
+    soc_restore(&s, &vr);
+
+    // two full discharges with a charge in between, 100 As per sample
+    soc_sample(&s, 840, 0, 0);
+    for (int cycle = 0; cycle < 2; ++cycle) {
+        for (int i = 0; i <= 17 * 2850 * 36 / 1000; ++i) {
+            soc_sample(&s, 700, 1000, 1000);
+        }
+        BOOST_TEST(soc_percent(&s) == 0);
+        for (int i = 0; i <= 17 * 2850 * 36 / 1000; ++i) {
+            soc_sample(&s, 800, -1000, 1000);
+        }
+        BOOST_TEST(soc_percent(&s) == 100);
+    }
+
+    soc_store(&s, &vr);
+    BOOST_TEST(vr.full_batt_charge_cycles == 2);
+}
+
+BOOST_AUTO_TEST_CASE(soc_ocv_config_test)
+{
+    struct vehicle_conf vc;
+    struct vehicle_runtime vr;
+    struct soc s;
+    init_vehicle_conf(&vc);
+    init_vehicle_runtime(&vr);
+
+    // Li-ion, the curve ends at the configured voltages
+    soc_init(&s, &vc);
+    BOOST_TEST(soc_ocv_permille(&s, 3200) == 0);
+    BOOST_TEST(soc_ocv_permille(&s, 3770) == 500);
+    BOOST_TEST(soc_ocv_permille(&s, 4200) == 1000);
+    BOOST_TEST(soc_ocv_permille(&s, 4140) == 950);
+
+    // LiFePO4 does not fit it, linear over the configured range
+    vc.cell_mv_max = 3650;
+    vc.cell_mv_min = 2500;
+    soc_init(&s, &vc);
+    soc_restore(&s, &vr);
+    BOOST_TEST(soc_ocv_permille(&s, 2500) == 0);
+    BOOST_TEST(soc_ocv_permille(&s, 3075) == 500);
+    BOOST_TEST(soc_ocv_permille(&s, 3650) == 1000);
+
+    // 20s resting at 3.2 V/cell
+    soc_sample(&s, 640, 0, 0);
+    BOOST_TEST(soc_percent(&s) == 61);
+
+    // the energy follows the same line
+    soc_init(&s, &vc);
+    soc_sample(&s, 730, 0, 0);
+    BOOST_TEST(soc_permille(&s) == 1000);
+    BOOST_TEST(soc_remaining_mWh(&s) == 17u * 2850 * 20 * 3075 / 1000);
+}
\ No newline at end of file
@@ -0,0 +1,124 @@
+#include "speed.h"
+
+#include <cmath>
+#include <vector>
+
+// 1.830 m == 16 pulses
+static const double SIM_MM_PP = 1830.0 / 16;
+
+// true speed in m/s: accelerate to ~38 km/h, cruise, brake, stop
+static double SimSpeed(double t)
+{
+    if (t < 2) return 0;
+    if (t < 9) return (t - 2) * 1.5;
+    if (t < 20) return 10.5;
+    if (t < 25) return 10.5 - (t - 20) * 2.1;
+    return 0;
+}
+
+struct SpeedStats
+{
+    // mean error while accelerating => lag, km/h
+    double accel_bias;
+    // rms error while cruising => noise, km/h
+    double cruise_rms;
+    // first report of 0 after the stop, s
+    double stop_t;
+};
+
+BOOST_AUTO_TEST_CASE(speed_estimator_benchmark)
+{
+    struct vehicle_conf vc;
+    struct speed_est se;
+    init_vehicle_conf(&vc);
+    speed_init(&se, &vc);
+
+    // wheel position integrated with 1 ms steps
+    std::vector<uint32_t> pulses;
+    double mm = 0;
+    for (int ms = 0; ms <= 30000; ++ms) {
+        pulses.push_back((uint32_t)(mm / SIM_MM_PP));
+        mm += SimSpeed(ms / 1000.0);
+    }
+
+    SpeedStats est = {0, 0, 0};
+    SpeedStats legacy = {0, 0, 0};
+    int accel_n = 0;
+    int cruise_n = 0;
+    uint32_t prev = 0;
+
+    speed_update(&se, 0, 0);
+
+    for (int ms = 500; ms <= 30000; ms += 500) {
+        double t = ms / 1000.0;
+        double truth = SimSpeed(t) * 3.6;
+        uint32_t delta_mm = (pulses[ms] - prev) * vc.dist_p_rev_mm / vc.pulse_p_rev;
+        double old_kmh = 36 * delta_mm / (10 * 500);
+
+        speed_update(&se, pulses[ms], 500);
+        prev = pulses[ms];
+
+        double new_kmh = speed_dkmh(&se) / 10.0;
+
+        if (t > 3 && t < 9) {
+            est.accel_bias += new_kmh - truth;
+            legacy.accel_bias += old_kmh - truth;
+            ++accel_n;
+        }
+        if (t > 11 && t < 20) {
+            est.cruise_rms += (new_kmh - truth) * (new_kmh - truth);
+            legacy.cruise_rms += (old_kmh - truth) * (old_kmh - truth);
+            ++cruise_n;
+            BOOST_TEST(speed_confidence(&se) > 80);
+        }
+        if (t >= 25 && est.stop_t == 0 && speed_dkmh(&se) < 5) {
+            est.stop_t = t;
+        }
+        if (t >= 25 && legacy.stop_t == 0 && old_kmh == 0) {
+            legacy.stop_t = t;
+        }
+    }
+
+    est.accel_bias /= accel_n;
+    legacy.accel_bias /= accel_n;
+    est.cruise_rms = std::sqrt(est.cruise_rms / cruise_n);
+    legacy.cruise_rms = std::sqrt(legacy.cruise_rms / cruise_n);
+
+    BOOST_TEST_MESSAGE("accel bias km/h  legacy: " << legacy.accel_bias
+        << " estimator: " << est.accel_bias);
+    BOOST_TEST_MESSAGE("cruise rms km/h  legacy: " << legacy.cruise_rms
+        << " estimator: " << est.cruise_rms);
+    BOOST_TEST_MESSAGE("stop reported at legacy: " << legacy.stop_t
+        << " s estimator: " << est.stop_t << " s");
+
+    BOOST_TEST(std::fabs(est.accel_bias) < std::fabs(legacy.accel_bias) / 2);
+    BOOST_TEST(est.cruise_rms < legacy.cruise_rms / 2);
+    BOOST_TEST(est.stop_t <= legacy.stop_t);
+    BOOST_TEST(speed_dkmh(&se) == 0);
+    BOOST_TEST(speed_confidence(&se) == 100);
+}
+
+BOOST_AUTO_TEST_CASE(speed_stop_timeout_test)
+{
+    struct vehicle_conf vc;
+    struct speed_est se;
+    init_vehicle_conf(&vc);
+    speed_init(&se, &vc);
+
+    // 16 pulses / 500 ms == 13.2 km/h
+    uint32_t p = 0;
+    speed_update(&se, p, 0);
+    for (int i = 0; i < 20; ++i) {
+        p += 16;
+        speed_update(&se, p, 500);
+    }
+    BOOST_TEST(std::abs(speed_dkmh(&se) - 132) <= 1);
+
+    // pulses stop, the speed is bounded by one pulse per idle time
+    speed_update(&se, p, 500);
+    BOOST_TEST(speed_dkmh(&se) <= 9);
+    BOOST_TEST(speed_confidence(&se) < 50);
+    speed_update(&se, p, 500);
+    speed_update(&se, p, 500);
+    BOOST_TEST(speed_dkmh(&se) == 0);
+}
\ No newline at end of file
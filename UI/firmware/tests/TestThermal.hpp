@@ -0,0 +1,86 @@
+#include "thermal.h"
+
+#include <cmath>
+
+// the motor as the model sees it, but hotter and with a slower sensor
+struct FakeMotor
+{
+    double tw = 20;
+    double tc = 20;
+    double g = 1.6 * THERMAL_G_DEF / double(1 << 24);
+
+    void Run(double amps, double ambient, double dt_s)
+    {
+        tw += dt_s * (g * amps * amps - (tw - ambient) / THERMAL_TAU_W_S);
+        tc += dt_s * (tw - tc) / 240;
+    }
+};
+
+// 5 minutes at `hi` A, 5 minutes at `lo` A: climbs and descents
+static double HillyAmps(int ms, double hi, double lo)
+{
+    return (ms / 300000) % 2 ? lo : hi;
+}
+
+BOOST_AUTO_TEST_CASE(thermal_observer_test)
+{
+    struct thermal th;
+    FakeMotor m;
+    double sensor_err2 = 0, model_err2 = 0;
+    int n = 0;
+
+    thermal_init(&th, 20);
+    thermal_measure(&th, 20);
+    // 90 minutes: 50 ms current samples, 1 s steps, 5 s readings
+    for (int ms = 0; ms < 90 * 60000; ms += 50) {
+        double amps = HillyAmps(ms, 50, 5);
+        m.Run(amps, 20, 0.05);
+        thermal_current(&th, amps * 10, 50);
+        if (ms % 1000 == 950) {
+            thermal_step(&th, 1000);
+        }
+        if (ms % 5000 == 4950) {
+            thermal_measure(&th, std::lround(m.tc));
+        }
+        // after the first half hour of calibration
+        if (ms >= 30 * 60000 && ms % 1000 == 950) {
+            sensor_err2 += (m.tc - m.tw) * (m.tc - m.tw);
+            model_err2 += (thermal_winding_c(&th) - m.tw)
+                * (thermal_winding_c(&th) - m.tw);
+            ++n;
+        }
+    }
+
+    double sensor_rms = std::sqrt(sensor_err2 / n);
+    double model_rms = std::sqrt(model_err2 / n);
+    BOOST_TEST_MESSAGE("winding " << m.tw << " C, case " << m.tc
+        << " C; rms error of the case sensor " << sensor_rms
+        << " C, of the model " << model_rms << " C, gain "
+        << th.g / double(THERMAL_G_DEF));
+    BOOST_TEST(model_rms * 3 < sensor_rms);
+    BOOST_TEST(std::abs(th.g - 1.6 * THERMAL_G_DEF) < 0.2 * THERMAL_G_DEF);
+
+    // a rest at the top, then a long climb at 35 A and the time to 120 C
+    for (int ms = 0; ms < 11 * 60000; ms += 50) {
+        double amps = ms < 10 * 60000 ? 5 : 35;
+        m.Run(amps, 20, 0.05);
+        thermal_current(&th, amps * 10, 50);
+        if (ms % 1000 == 950) {
+            thermal_step(&th, 1000);
+        }
+        if (ms % 5000 == 4950) {
+            thermal_measure(&th, std::lround(m.tc));
+        }
+    }
+    uint16_t predicted = thermal_time_to(&th, 120);
+    FakeMotor ahead = m;
+    int s = 0;
+    for (; ahead.tw < 120 && s < 20000; ++s) {
+        ahead.Run(35, 20, 1);
+    }
+    BOOST_TEST_MESSAGE("120 C from " << m.tw << " C predicted in " << predicted
+        << " s, reached in " << s << " s");
+    BOOST_TEST(std::abs(predicted - s) < s / 5 + 30);
+    BOOST_TEST(thermal_time_to(&th, 30) == 0);
+    BOOST_TEST(thermal_time_to(&th, 250) == THERMAL_NEVER);
+}
\ No newline at end of file
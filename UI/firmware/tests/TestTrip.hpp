@@ -0,0 +1,196 @@
+#include "trip.h"
+#include "persist.h"
+
+// the summaries of an EXPORT_TRIPS dump, -1 without the closing frame
+static int ParseTripExport(const std::vector<uint8_t>& wire,
+    std::vector<struct trip_summary>& trips)
+{
+    size_t i = 0;
+
+    trips.clear();
+    while (i + EXPORT_HEADER + 2 <= wire.size()) {
+        uint8_t len = wire[i + 5];
+        size_t end = i + EXPORT_HEADER + len;
+        if (wire[i] != EXPORT_SYNC_1 || wire[i + 1] != EXPORT_SYNC_2
+            || wire[i + 2] != EXPORT_TRIPS || end + 2 > wire.size()
+            || (wire[end] | wire[end + 1] << 8)
+                != crc16(CRC16_INIT, &wire[i + 2], EXPORT_HEADER - 2 + len)) {
+            ++i;
+            continue;
+        }
+        if (len == 0) {
+            return trips.size();
+        }
+        struct trip_summary s;
+        BOOST_TEST(persist_decode_trip(&s, &wire[i + EXPORT_HEADER], len) == 0);
+        trips.push_back(s);
+        i = end + 2;
+    }
+    return -1;
+}
+
+BOOST_AUTO_TEST_CASE(trip_summary_test)
+{
+    struct trip t;
+    std::vector<struct trip_frame> frames;
+    uint64_t dist_mm = 0;
+    double wh = 0, regen_wh = 0;
+
+    std::srand(45);
+    trip_start(&t, 1);
+    // 2 hours in frames of about a second: rides and stops
+    for (int i = 0; i < 7200; ++i) {
+        struct trip_frame f = {};
+        int c = i % 900;
+        f.dt_ms = 980 + std::rand() % 41;
+        f.speed_dkmh = (c < 700) ? 200 + std::rand() % 150 : 0;
+        f.amper_da = (c < 650) ? 100 + std::rand() % 100
+            : (c < 700) ? -(std::rand() % 50) : 0;
+        double w = 80.0 * f.amper_da / 10;
+        if (w > 0) {
+            f.consumed_mWs = w * f.dt_ms;
+            wh += w * f.dt_ms / 3600000.0;
+        } else {
+            f.recovered_mWs = -w * f.dt_ms;
+            regen_wh += -w * f.dt_ms / 3600000.0;
+        }
+        dist_mm += (uint64_t)f.speed_dkmh * f.dt_ms / 36;
+        f.dist_m = dist_mm / 1000;
+        f.moto_temp = 30 + i / 200;
+        f.driver_temp = (i == 100) ? 300 : 35;
+        f.batt_temp = (i == 200) ? -300 : 25;
+        trip_update(&t, &f);
+        frames.push_back(f);
+    }
+
+    // the same from all the frames at once
+    uint64_t moving_ms = 0;
+    uint16_t max_dkmh = 0;
+    for (const auto& f : frames) {
+        moving_ms += f.speed_dkmh ? f.dt_ms : 0;
+        max_dkmh = std::max(max_dkmh, f.speed_dkmh);
+    }
+    BOOST_TEST_MESSAGE("trip: " << t.s.dist_m << " m in " << t.s.moving_s
+        << " s, avg " << trip_avg_dkmh(&t.s) / 10.0 << " km/h, "
+        << t.s.consumed_dWh / 10.0 << " Wh, " << t.s.recovered_dWh / 10.0
+        << " Wh back");
+    BOOST_TEST(t.s.dist_m == dist_mm / 1000);
+    BOOST_TEST(t.s.moving_s == moving_ms / 1000);
+    BOOST_TEST(t.s.max_dkmh == max_dkmh);
+    BOOST_TEST(std::abs(t.s.consumed_dWh - wh * 10) <= 1);
+    BOOST_TEST(std::abs(t.s.recovered_dWh - regen_wh * 10) <= 1);
+    BOOST_TEST(trip_avg_dkmh(&t.s) == dist_mm / 1000 * 36 / (moving_ms / 1000));
+    BOOST_TEST(t.s.max_moto_temp == 30 + 7199 / 200);
+    BOOST_TEST(t.s.max_driver_temp == INT8_MAX);
+    BOOST_TEST(t.s.max_batt_temp == 25);
+}
+
+BOOST_AUTO_TEST_CASE(trip_archive_test)
+{
+    struct trip_archive ta;
+    struct trip t;
+    std::vector<struct trip_summary> all;
+
+    // the previous tests left the queue and the trips page in any state
+    eeprom_async_init();
+    std::vector<uint8_t> erased(EEPROM_ASYNC_PAGE * (2 + TRIP_ARCHIVE), 0xff);
+    eeprom_24lc256_write(0x0400 * 9, erased.data(), erased.size());
+    BOOST_TEST(load_trip_archive(&ta) == 0);
+    BOOST_TEST(ta.count == 0);
+
+    // more trips than the archive keeps
+    trip_start(&t, 2);
+    for (int n = 0; n < 20; ++n) {
+        struct trip_frame f = {};
+        f.dist_m = 1000 * (n + 1);
+        f.speed_dkmh = 250;
+        f.dt_ms = 1000;
+        trip_update(&t, &f);
+        trip_archive_put(&ta, &t, 50000 + n);
+        all.push_back(ta.trips[ta.count - 1]);
+        BOOST_TEST(save_trip_async(&ta, NULL, NULL) == 0);
+        EeDrain();
+        BOOST_TEST(t.s.dist_m == 0);
+    }
+    BOOST_TEST(trip_archive_get(&ta, 0)->end_m == 50019);
+    BOOST_TEST(trip_archive_get(&ta, TRIP_ARCHIVE - 1)->seq == 7);
+    BOOST_TEST(trip_archive_get(&ta, TRIP_ARCHIVE) == nullptr);
+
+    // the reboot reads them back in order
+    struct trip_archive back;
+    BOOST_TEST(load_trip_archive(&back) == 0);
+    BOOST_TEST(back.count == TRIP_ARCHIVE);
+    BOOST_TEST(back.next_seq == 21);
+    for (int k = 0; k < TRIP_ARCHIVE; ++k) {
+        BOOST_TEST(back.trips[k].seq == all[20 - TRIP_ARCHIVE + k].seq);
+        BOOST_TEST(back.trips[k].dist_m == all[20 - TRIP_ARCHIVE + k].dist_m);
+        BOOST_TEST(back.trips[k].trip == 2);
+    }
+
+    // and the UART has them oldest first
+    fake_wire.clear();
+    BOOST_TEST(trip_export_start() == 0);
+    BOOST_TEST(trip_export_start() == 1);
+    uint32_t start = HAL_Tick;
+    std::vector<struct trip_summary> exported;
+    while (ParseTripExport(fake_wire, exported) < 0 && HAL_Tick - start < 5000) {
+        HAL_Tick += 1;
+        trip_export_poll(&back);
+    }
+    BOOST_TEST_MESSAGE("trip archive export: " << fake_wire.size()
+        << " B in " << HAL_Tick - start << " ms at 9600 baud");
+    BOOST_TEST(exported.size() == TRIP_ARCHIVE);
+    BOOST_TEST(exported.front().seq == 7);
+    BOOST_TEST(exported.back().end_m == 50019);
+    // the closing frame ended it, another one can start
+    BOOST_TEST(trip_export_start() == 0);
+    for (int i = 0; i < 5000; ++i) {
+        HAL_Tick += 1;
+        trip_export_poll(&back);
+    }
+}
+
+// the stop finds the EEPROM queue full, its saves go out once it drains
+BOOST_AUTO_TEST_CASE(trip_stop_save_retry_test)
+{
+    std::vector<uint8_t> erased(EEPROM_ASYNC_PAGE * 2, 0xff);
+    eeprom_24lc256_write(0x0400 * 9, erased.data(), erased.size());
+
+    logic_init();
+    uint32_t pulses = 0;
+    for (int i = 0; i < 200; ++i) {
+        HAL_Tick += 100;
+        InsertCanMessage(BuildElectricMsg(800, 50));
+        if (i % 5 == 0) {
+            InsertCanMessage(BuildMotionMsg(pulses));
+            pulses += 16;
+        }
+        logic_update();
+    }
+
+    // the bus hangs with the queue full when the vehicle stops
+    uint8_t b = 0;
+    fake_defer = 1;
+    while (eeprom_async_write(0x7fc0, &b, 1, NULL, NULL) == 0) {
+    }
+    // parked long enough for the save
+    for (int i = 0; i < (PARKED_SAVE_S + 5) * 10; ++i) {
+        HAL_Tick += 100;
+        InsertCanMessage(BuildElectricMsg(800, 0));
+        if (i % 5 == 0) {
+            InsertCanMessage(BuildMotionMsg(pulses));
+        }
+        logic_update();
+    }
+    struct trip_summary live[2];
+    BOOST_TEST(load_trip_live(live) == 1);
+
+    fake_defer = 0;
+    FakeBusFinish();
+    for (int i = 0; i < 3000; ++i) {
+        HAL_Tick += 1;
+        logic_update();
+    }
+    BOOST_TEST(load_trip_live(live) == 0);
+    BOOST_TEST(live[0].dist_m > 0u);
+}
\ No newline at end of file
@@ -5,3 +5,28 @@
 #include <boost/test/unit_test.hpp>
 
 #include "TestLogic.hpp"
+#include "TestGfx.hpp"
+#include "TestLcdBus.hpp"
+#include "TestPresent.hpp"
+#include "TestFmt.hpp"
+#include "TestSpeed.hpp"
+#include "TestDistance.hpp"
+#include "TestEnergy.hpp"
+#include "TestRolling.hpp"
+#include "TestSoc.hpp"
+#include "TestRint.hpp"
+#include "TestRange.hpp"
+#include "TestJournal.hpp"
+#include "TestEeprom.hpp"
+#include "TestPersist.hpp"
+#include "TestBrownout.hpp"
+
+#include "TestResume.hpp"
+#include "TestRideLog.hpp"
+#include "TestFaultLog.hpp"
+#include "TestTrip.hpp"
+#include "TestAlarm.hpp"
+#include "TestThermal.hpp"
+#include "TestRainflow.hpp"
+#include "TestProfile.hpp"
+#include "TestCharge.hpp"
\ No newline at end of file
@@ -79,6 +79,15 @@ static inline uint32_t convert_to_11bit(int32_t v)
     return ret;
 }
 
+// bcp_msg_electric.faults, set for as long as the fault is present
+// current sensor zero out of range at the power-up calibration
+#define BCP_FAULT_AMP_SENS      0x001
+// neither the KTY83 nor the NTC motor sensor answers
+#define BCP_FAULT_MOTO_T_SENS   0x002
+#define BCP_FAULT_BATT_T_SENS   0x004
+#define BCP_FAULT_DRV_T_SENS    0x008
+#define BCP_FAULT_MASK          0x7ff
+
 #define MAX_TIMESTAMP         0x2000
 struct bcp_msg_electric
 {
@@ -87,6 +96,7 @@ struct bcp_msg_electric
     uint32_t voltage    : 10;
     // 10.8A = 108
     uint32_t current    : 14;
+    // BCP_FAULT_*
     uint32_t faults     : 11;
     uint32_t seq_id     : 8;
 } __attribute__((__packed__));